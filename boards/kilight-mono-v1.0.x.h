@@ -28,28 +28,36 @@
 #define KILIGHT_I2C_BAUD_RATE 400000
 #endif
 
-// Number of outputs. KiLight Mono only has one
+// Number of outputs. KiLight Mono only has one. Every output needs a pin group in SystemPins.
 #ifndef KILIGHT_NUMBER_OF_OUTPUTS
 #define KILIGHT_NUMBER_OF_OUTPUTS 1
 #endif
 
-// Defined if the board has more than one output. KiLight Mono only has one, so it shouldn't be defined
-#if KILIGHT_NUMBER_OF_OUTPUTS > 1 && !defined(KILIGHT_HAS_OUTPUT_B)
-#define KILIGHT_HAS_OUTPUT_B
-#endif
-
 // Clock divider for ADC samples
 #ifndef KILIGHT_ADC_CLKDIV
 #define KILIGHT_ADC_CLKDIV 2
 #endif
 
+// Trigger current samples from the LED PWM rather than free running, so the average doesn't alias against the PWM
+#ifndef KILIGHT_ADC_PWM_SYNCHRONOUS
+#define KILIGHT_ADC_PWM_SYNCHRONOUS 1
+#endif
+
+// Start every external thermometer's conversion at once with a Skip ROM broadcast, rather than one at a time. Needs
+// externally powered thermometers, since they all draw conversion current together.
+#ifndef KILIGHT_ONEWIRE_BROADCAST_CONVERSION
+#define KILIGHT_ONEWIRE_BROADCAST_CONVERSION 1
+#endif
+
 #define PICO_CYW43_ARCH_DEFAULT_COUNTRY_CODE CYW43_COUNTRY_USA
 
 // For board detection
 #define RASPBERRYPI_PICO2_W
 
 // --- RP2350 VARIANT ---
+#ifndef PICO_RP2350A
 #define PICO_RP2350A 1
+#endif
 
 // --- UART ---
 #ifndef PICO_DEFAULT_UART
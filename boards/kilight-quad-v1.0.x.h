@@ -0,0 +1,28 @@
+// -----------------------------------------------------
+// NOTE: THIS HEADER IS ALSO INCLUDED BY ASSEMBLER SO
+//       SHOULD ONLY CONSIST OF PREPROCESSOR DIRECTIVES
+// -----------------------------------------------------
+
+// Four output layout on the RP2350B. Apart from the package, the output count and how current is sampled it's the
+// same as KiLight Mono, so it builds on that board's header. Each output's pins are in SystemPins.
+
+#pragma once
+
+// pico_cmake_set PICO_PLATFORM=rp2350
+// pico_cmake_set PICO_CYW43_SUPPORTED = 1
+
+// --- RP2350 VARIANT ---
+#define PICO_RP2350A 0
+
+// Number of outputs
+#ifndef KILIGHT_NUMBER_OF_OUTPUTS
+#define KILIGHT_NUMBER_OF_OUTPUTS 4
+#endif
+
+// Four outputs plus the fan and its tachometer use all twelve PWM slices, so there's none left to pace
+// PWM-synchronous current sampling
+#ifndef KILIGHT_ADC_PWM_SYNCHRONOUS
+#define KILIGHT_ADC_PWM_SYNCHRONOUS 0
+#endif
+
+#include "kilight-mono-v1.0.x.h"
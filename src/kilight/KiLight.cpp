@@ -32,8 +32,21 @@ namespace kilight {
         m_userInterfaceSubsystem(subsystems(), &m_oneWireSubsystem),
         m_wifiSubsystem(subsystems(), &m_storageSubsystem, &m_userInterfaceSubsystem),
         m_lightSubsystem(subsystems(), &m_storageSubsystem, &m_wifiSubsystem),
-        m_currentMonitorSubsystem(subsystems(), &m_wifiSubsystem, &m_lightSubsystem),
-        m_thermalSubsystem(subsystems(), &m_oneWireSubsystem, &m_wifiSubsystem, &m_lightSubsystem) {
+        m_streamSubsystem(subsystems(), &m_wifiSubsystem, &m_lightSubsystem),
+        m_scheduleSubsystem(subsystems(), &m_storageSubsystem, &m_wifiSubsystem, &m_lightSubsystem),
+        m_historySubsystem(subsystems(), &m_wifiSubsystem),
+        m_currentMonitorSubsystem(subsystems(),
+                                  &m_storageSubsystem,
+                                  &m_wifiSubsystem,
+                                  &m_lightSubsystem,
+                                  &m_historySubsystem),
+        m_thermalSubsystem(subsystems(),
+                           &m_storageSubsystem,
+                           &m_oneWireSubsystem,
+                           &m_wifiSubsystem,
+                           &m_lightSubsystem,
+                           &m_currentMonitorSubsystem,
+                           &m_historySubsystem) {
     }
 
     LogSink const* KiLight::logSink() const {
@@ -12,9 +12,12 @@
 #include "kilight/core/LogSink.h"
 #include "kilight/storage/StorageSubsystem.h"
 #include "kilight/com/WifiSubsystem.h"
+#include "kilight/com/StreamSubsystem.h"
 #include "kilight/hw/OneWireSubsystem.h"
 #include "kilight/output/LightSubsystem.h"
+#include "kilight/output/ScheduleSubsystem.h"
 #include "kilight/status/CurrentMonitorSubsystem.h"
+#include "kilight/status/HistorySubsystem.h"
 #include "kilight/status/ThermalSubsystem.h"
 #include "kilight/ui/UserInterfaceSubsystem.h"
 
@@ -60,6 +63,12 @@ namespace kilight {
 
         output::LightSubsystem m_lightSubsystem;
 
+        com::StreamSubsystem m_streamSubsystem;
+
+        output::ScheduleSubsystem m_scheduleSubsystem;
+
+        status::HistorySubsystem m_historySubsystem;
+
         status::CurrentMonitorSubsystem m_currentMonitorSubsystem;
 
         status::ThermalSubsystem m_thermalSubsystem;
@@ -0,0 +1,103 @@
+/**
+ * JitterBuffer.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <pico/platform.h>
+
+namespace kilight::com {
+
+    template <typename FrameT, uint32_t Capacity>
+    class JitterBuffer final {
+    public:
+        enum class PushResult {
+            Queued,
+            Late,
+            Overflow
+        };
+
+        void clear() {
+            m_front = 0;
+            m_size = 0;
+        }
+
+        [[nodiscard]]
+        bool empty() const {
+            return m_size == 0;
+        }
+
+        [[nodiscard]]
+        uint32_t size() const {
+            return m_size;
+        }
+
+        /**
+         * Queues a frame to be played at its playout time. Frames are expected in playout order, anything that would
+         * play before a frame already queued or already rendered is late and rejected. If the buffer is full the
+         * oldest frame is dropped to make room.
+         *
+         * @param frame Frame to queue
+         * @param lastRenderedTimeUs Playout time of the last frame that was rendered
+         * @return Whether the frame was queued, rejected as late, or queued by dropping the oldest frame
+         */
+        __force_inline PushResult push(FrameT const& frame, uint64_t const lastRenderedTimeUs) {
+            if (frame.playoutTimeUs <= lastRenderedTimeUs
+                || (!empty() && frame.playoutTimeUs <= back().playoutTimeUs)) {
+                return PushResult::Late;
+            }
+
+            PushResult result = PushResult::Queued;
+            if (m_size == Capacity) {
+                m_front = (m_front + 1) % Capacity;
+                --m_size;
+                result = PushResult::Overflow;
+            }
+            m_frames[(m_front + m_size) % Capacity] = frame;
+            ++m_size;
+            return result;
+        }
+
+        /**
+         * Takes the newest frame that is due to be played. Any older frames that are also due were never shown and
+         * are dropped.
+         *
+         * @param nowUs Current time
+         * @param frame Set to the frame to render, if there is one
+         * @param skipped Set to how many due frames were dropped in favour of a newer one
+         * @return true if a frame is due
+         */
+        __force_inline bool popDue(uint64_t const nowUs, FrameT& frame, uint32_t& skipped) {
+            skipped = 0;
+            bool found = false;
+            while (!empty() && m_frames[m_front].playoutTimeUs <= nowUs) {
+                if (found) {
+                    ++skipped;
+                }
+                frame = m_frames[m_front];
+                found = true;
+                m_front = (m_front + 1) % Capacity;
+                --m_size;
+            }
+            return found;
+        }
+
+    private:
+        std::array<FrameT, Capacity> m_frames {};
+
+        uint32_t m_front = 0;
+
+        uint32_t m_size = 0;
+
+        [[nodiscard]]
+        __force_inline FrameT const& back() const {
+            return m_frames[(m_front + m_size - 1) % Capacity];
+        }
+    };
+
+}
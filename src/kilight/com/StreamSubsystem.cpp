@@ -0,0 +1,258 @@
+/**
+ * StreamSubsystem.cpp
+ *
+ * @author Patrick Lavigne
+ */
+
+#include "kilight/com/StreamSubsystem.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include <pico/cyw43_arch.h>
+#include <hardware/timer.h>
+#include <lwip/def.h>
+
+#include <kilight/protocol/SystemState.h>
+
+#include "kilight/conf/WifiConfig.h"
+
+using mpf::core::SubsystemList;
+
+using kilight::conf::getWifiConfig;
+using kilight::core::Alarm;
+using kilight::output::LightSubsystem;
+using kilight::output::render_status_t;
+using kilight::output::rgbcw_color_t;
+using kilight::protocol::SystemState;
+
+namespace kilight::com {
+
+    StreamSubsystem::StreamSubsystem(SubsystemList* const list,
+                                     WifiSubsystem* const wifiSubsystem,
+                                     LightSubsystem* const lightSubsystem) :
+        Subsystem(list),
+        m_wifi(wifiSubsystem),
+        m_lights(lightSubsystem) {
+        assert(m_wifi != nullptr);
+        assert(m_lights != nullptr);
+    }
+
+    void StreamSubsystem::setUp() {
+        cyw43_arch_lwip_begin();
+        m_pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+        if (m_pcb == nullptr) {
+            panic("Failed to create stream UDP PCB, probably out of memory!");
+        }
+
+        if (err_t const err = udp_bind(m_pcb, IP_ANY_TYPE, getWifiConfig().StreamListenPort)) {
+            panic("Failed to bind to UDP port %u, error %d", getWifiConfig().StreamListenPort, err);
+        }
+
+        udp_recv(m_pcb,
+                 [](void* const context, udp_pcb*, pbuf* const packet, ip_addr_t const*, u16_t) {
+                     if (context != nullptr) {
+                         static_cast<StreamSubsystem*>(context)->receivePacket(packet);
+                     }
+                     pbuf_free(packet);
+                 },
+                 this);
+        cyw43_arch_lwip_end();
+
+        INFO("Listening for streamed frames on UDP port {}", getWifiConfig().StreamListenPort);
+
+        m_statsAlarm.setTimeout(PublishStatsEveryMs,
+                                [this](Alarm const&) {
+                                    m_publishStatsPending = true;
+                                });
+    }
+
+    bool StreamSubsystem::hasWork() const {
+        return m_publishStatsPending;
+    }
+
+    void StreamSubsystem::work() {
+        publishStats();
+        m_publishStatsPending = false;
+        m_statsAlarm.setTimeout(PublishStatsEveryMs,
+                                [this](Alarm const&) {
+                                    m_publishStatsPending = true;
+                                });
+    }
+
+    void StreamSubsystem::receivePacket(pbuf* const packet) {
+        ddp_header_t header;
+        if (pbuf_copy_partial(packet, &header, sizeof(header), 0) != sizeof(header)) {
+            return;
+        }
+
+        if ((header.flags & ddp_header_t::VersionMask) != ddp_header_t::Version1) {
+            return;
+        }
+
+        // Only plain data packets carry frames, queries and configuration aren't supported
+        if ((header.flags & (ddp_header_t::FlagQuery | ddp_header_t::FlagReply | ddp_header_t::FlagStorage)) != 0) {
+            return;
+        }
+
+        if (header.destinationId != ddp_header_t::DestinationDefault
+            && header.destinationId != ddp_header_t::DestinationAll) {
+            return;
+        }
+
+        bool const hasTimecode = (header.flags & ddp_header_t::FlagTimecode) != 0;
+        uint16_t const headerSize = sizeof(header) + (hasTimecode ? sizeof(ddp_timecode_t) : 0);
+        if (packet->tot_len < headerSize) {
+            return;
+        }
+
+        ddp_timecode_t timecode = 0;
+        if (hasTimecode) {
+            pbuf_copy_partial(packet, &timecode, sizeof(timecode), sizeof(header));
+            timecode = lwip_ntohl(timecode);
+        }
+
+        uint64_t const nowUs = time_us_64();
+        if (nowUs - m_lastFrameReceivedUs > output::RenderEngine::StreamTimeoutUs) {
+            // New stream (or the old one restarted), so forget everything learned about the sender
+            m_transitFloorValid = false;
+            m_lastSequence = 0;
+        }
+
+        uint32_t const dataOffset = lwip_ntohl(header.dataOffset);
+        uint32_t const dataLength = std::min<uint32_t>(lwip_ntohs(header.dataLength), packet->tot_len - headerSize);
+
+        countLostFrames(header.sequence & ddp_header_t::SequenceMask);
+
+        bool frameDataChanged = false;
+        if (dataOffset < StreamChannelCount) {
+            std::array<uint8_t, StreamChannelCount> channels {};
+            auto const channelsToCopy = static_cast<uint16_t>(std::min(dataLength, StreamChannelCount - dataOffset));
+            pbuf_copy_partial(packet, channels.data(), channelsToCopy, headerSize);
+
+            for (uint32_t index = 0; index < channelsToCopy; ++index) {
+                uint32_t const channel = dataOffset + index;
+                rgbcw_color_t& color = m_assemblingFrame.outputs[channel / StreamChannelsPerOutput];
+                switch (channel % StreamChannelsPerOutput) {
+                case 0:
+                    color.red = channels[index];
+                    break;
+                case 1:
+                    color.green = channels[index];
+                    break;
+                case 2:
+                    color.blue = channels[index];
+                    break;
+                case 3:
+                    color.coldWhite = channels[index];
+                    break;
+                default:
+                    color.warmWhite = channels[index];
+                    break;
+                }
+            }
+            frameDataChanged = channelsToCopy > 0;
+        }
+
+        // Senders push the last packet of a frame, but not all of them bother, so a frame is also complete once the
+        // packet carrying our final channel arrives
+        bool const pushed = (header.flags & ddp_header_t::FlagPush) != 0;
+        if (frameDataChanged && (pushed || dataOffset + dataLength >= StreamChannelCount)) {
+            commitFrame(nowUs, hasTimecode, timecode);
+        }
+    }
+
+    void StreamSubsystem::commitFrame(uint64_t const nowUs, bool const hasTimecode, ddp_timecode_t const timecode) {
+        m_stats.framesReceived = m_stats.framesReceived + 1;
+        m_lastFrameReceivedUs = nowUs;
+        m_assemblingFrame.playoutTimeUs = playoutTimeFor(nowUs, hasTimecode, timecode);
+
+        // The render engine queues it into its jitter buffer on core 1, and decides there if it's too late to show
+        if (!m_lights->submitStreamFrame(m_assemblingFrame)) {
+            m_stats.framesDropped = m_stats.framesDropped + 1;
+        }
+    }
+
+    uint64_t StreamSubsystem::playoutTimeFor(uint64_t const nowUs,
+                                             bool const hasTimecode,
+                                             ddp_timecode_t const timecode) {
+        if (!hasTimecode) {
+            return nowUs + PlayoutDelayUs;
+        }
+
+        auto const senderTimeUs = static_cast<int64_t>((static_cast<uint64_t>(timecode) * 1000000U) >> 16U);
+        int64_t const transitUs = static_cast<int64_t>(nowUs) - senderTimeUs;
+
+        // A big jump means the sender restarted or its timecode wrapped, so start learning its clock again
+        if (m_transitFloorValid
+            && transitUs - m_transitFloorUs > static_cast<int64_t>(output::RenderEngine::StreamTimeoutUs)) {
+            m_transitFloorValid = false;
+        }
+
+        if (!m_transitFloorValid) {
+            m_transitFloorUs = transitUs;
+            m_nextTransitFloorUs = transitUs;
+            m_transitWindowStartUs = nowUs;
+            m_transitFloorValid = true;
+        } else {
+            m_transitFloorUs = std::min(m_transitFloorUs, transitUs);
+            m_nextTransitFloorUs = std::min(m_nextTransitFloorUs, transitUs);
+            if (nowUs - m_transitWindowStartUs >= TransitWindowUs) {
+                m_transitFloorUs = m_nextTransitFloorUs;
+                m_nextTransitFloorUs = transitUs;
+                m_transitWindowStartUs = nowUs;
+            }
+        }
+
+        // The fastest frame seen plays exactly PlayoutDelayUs after it arrived, slower ones get less slack
+        return static_cast<uint64_t>(senderTimeUs + m_transitFloorUs) + PlayoutDelayUs;
+    }
+
+    void StreamSubsystem::countLostFrames(uint8_t const sequence) {
+        // DDP sequence numbers count 1-15 and wrap, 0 means the sender doesn't use them
+        if (sequence != 0 && m_lastSequence != 0) {
+            uint8_t const expected = m_lastSequence % ddp_header_t::SequenceMask + 1;
+            uint8_t const gap = (sequence + ddp_header_t::SequenceMask - expected) % ddp_header_t::SequenceMask;
+            // Anything further ahead is far more likely to be a duplicate or reordered packet than a burst of loss
+            if (gap < ddp_header_t::SequenceMask / 2) {
+                m_stats.framesLost = m_stats.framesLost + gap;
+            }
+        }
+        m_lastSequence = sequence;
+    }
+
+    void StreamSubsystem::publishStats() {
+        render_status_t const status = m_lights->renderStatus();
+
+        uint32_t const framesRendered = status.streamFramesRendered - m_publishedFramesRendered;
+        uint32_t jitterAverageUs = 0;
+        if (framesRendered > 0) {
+            jitterAverageUs = static_cast<uint32_t>((status.streamRenderJitterSumUs - m_publishedJitterSumUs)
+                                                    / framesRendered);
+        }
+        m_publishedFramesRendered = status.streamFramesRendered;
+        m_publishedJitterSumUs = status.streamRenderJitterSumUs;
+
+        // Frames the render engine couldn't take are just as unseen as ones it judged too late
+        uint32_t const framesLate = status.streamFramesLate + m_stats.framesDropped;
+
+        TRACE("Stream: {} received, {} rendered, {} late, {} lost, jitter {}us avg / {}us max",
+              m_stats.framesReceived,
+              status.streamFramesRendered,
+              framesLate,
+              m_stats.framesLost,
+              jitterAverageUs,
+              status.streamRenderJitterMaxUs);
+
+        m_wifi->updateStateData([this, &status, framesLate, jitterAverageUs](SystemState& state) {
+            auto& stream = state.mutable_stream();
+            stream.set_active(status.streaming);
+            stream.set_framesReceived(m_stats.framesReceived);
+            stream.set_framesRendered(status.streamFramesRendered);
+            stream.set_framesLate(framesLate);
+            stream.set_framesLost(m_stats.framesLost);
+            stream.set_renderJitterMaxUs(status.streamRenderJitterMaxUs);
+            stream.set_renderJitterAverageUs(jitterAverageUs);
+        });
+    }
+}
@@ -0,0 +1,101 @@
+/**
+ * StreamSubsystem.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <lwip/udp.h>
+
+#include <mpf/core/Logging.h>
+#include <mpf/core/Subsystem.h>
+
+#include "kilight/com/stream_data.h"
+#include "kilight/com/WifiSubsystem.h"
+#include "kilight/core/Alarm.h"
+#include "kilight/output/LightSubsystem.h"
+
+namespace kilight::com {
+
+    class StreamSubsystem final : public mpf::core::Subsystem {
+        LOGGER(Stream);
+
+    public:
+        // How long after its (sender clock) timestamp a frame is played, to absorb network jitter
+        static constexpr uint32_t PlayoutDelayUs = 25000;
+
+        // The fastest transit time seen is used to map sender time to local time, and is re-learned this often so
+        // the two clocks can drift apart
+        static constexpr uint32_t TransitWindowUs = 2000000;
+
+        static constexpr uint32_t PublishStatsEveryMs = 1000;
+
+        StreamSubsystem(mpf::core::SubsystemList* list,
+                        WifiSubsystem* wifiSubsystem,
+                        output::LightSubsystem* lightSubsystem);
+
+        ~StreamSubsystem() override = default;
+
+        void setUp() override;
+
+        [[nodiscard]]
+        bool hasWork() const override;
+
+        void work() override;
+
+    private:
+        // Rendering stats are counted by the render engine, these are only what's seen on the receiving side
+        struct stream_stats_t {
+            uint32_t volatile framesReceived = 0;
+
+            uint32_t volatile framesDropped = 0;
+
+            uint32_t volatile framesLost = 0;
+        };
+
+        WifiSubsystem* const m_wifi;
+
+        output::LightSubsystem* const m_lights;
+
+        udp_pcb* m_pcb = nullptr;
+
+        core::Alarm m_statsAlarm;
+
+        // Frame currently being assembled from one or more packets, committed when the sender pushes it
+        stream_frame_t m_assemblingFrame {};
+
+        stream_stats_t m_stats {};
+
+        // Totals from the render engine as of the last time stats were published
+        uint64_t m_publishedJitterSumUs = 0;
+
+        uint32_t m_publishedFramesRendered = 0;
+
+        uint64_t m_lastFrameReceivedUs = 0;
+
+        int64_t m_transitFloorUs = 0;
+
+        int64_t m_nextTransitFloorUs = 0;
+
+        uint64_t m_transitWindowStartUs = 0;
+
+        uint8_t m_lastSequence = 0;
+
+        bool m_transitFloorValid = false;
+
+        bool volatile m_publishStatsPending = false;
+
+        void receivePacket(pbuf* packet);
+
+        void commitFrame(uint64_t nowUs, bool hasTimecode, ddp_timecode_t timecode);
+
+        [[nodiscard]]
+        uint64_t playoutTimeFor(uint64_t nowUs, bool hasTimecode, ddp_timecode_t timecode);
+
+        void countLostFrames(uint8_t sequence);
+
+        void publishStats();
+    };
+
+}
@@ -29,6 +29,10 @@ using kilight::protocol::SystemInfo;
 using kilight::protocol::CommandResult;
 using kilight::protocol::GetData;
 using kilight::protocol::WriteOutput;
+using kilight::protocol::EffectCommand;
+using kilight::protocol::FetchHistory;
+using kilight::protocol::PresetCommand;
+using kilight::protocol::ScheduleCommand;
 
 using kilight::conf::getWifiConfig;
 using kilight::storage::StorageSubsystem;
@@ -386,6 +390,74 @@ namespace kilight::com {
             processWrite(session, request.get_writeOutput());
             break;
 
+        case EFFECTCOMMAND:
+            processEffectCommand(session, request.get_effectCommand());
+            break;
+
+        case CONFIGUREOUTPUT:
+            DEBUG("Processing output configuration");
+            processCommand(session, m_configureOutputCallback, request.get_configureOutput());
+            break;
+
+        case CONFIGUREPOWERBUDGET:
+            DEBUG("Processing power budget configuration");
+            processCommand(session, m_configurePowerBudgetCallback, request.get_configurePowerBudget());
+            break;
+
+        case CALIBRATECURRENTMODEL:
+            DEBUG("Processing current model calibration");
+            processCommand(session, m_calibrateCurrentModelCallback, request.get_calibrateCurrentModel());
+            break;
+
+        case CONFIGURETHERMALDERATING:
+            DEBUG("Processing thermal derating configuration");
+            processCommand(session, m_configureThermalDeratingCallback, request.get_configureThermalDerating());
+            break;
+
+        case CONFIGURETHERMALMODEL:
+            DEBUG("Processing thermal model configuration");
+            processCommand(session, m_configureThermalModelCallback, request.get_configureThermalModel());
+            break;
+
+        case CONFIGURETHERMOMETERRESOLUTION:
+            DEBUG("Processing thermometer resolution configuration");
+            processCommand(session,
+                           m_configureThermometerResolutionCallback,
+                           request.get_configureThermometerResolution());
+            break;
+
+        case FETCHHISTORY:
+            processFetchHistory(session, request.get_fetchHistory());
+            break;
+
+        case PRESETCOMMAND:
+            processPresetCommand(session, request.get_presetCommand());
+            break;
+
+        case RECALLPRESET: {
+            // Recalls are kept down to a tag and a slot number, so a whole building can change scene at once
+            DEBUG("Processing preset recall");
+            uint32_t const slot = request.get_recallPreset();
+            processCommand(session, m_recallPresetCallback, slot);
+            break;
+        }
+
+        case TRANSITIONCOMMAND:
+            DEBUG("Processing transition command");
+            processCommand(session, m_transitionCommandCallback, request.get_transitionCommand());
+            break;
+
+        case SCHEDULECOMMAND:
+            processScheduleCommand(session, request.get_scheduleCommand());
+            break;
+
+        case SETTIME: {
+            DEBUG("Processing set time");
+            uint64_t const unixSeconds = request.get_setTime();
+            processCommand(session, m_setTimeCallback, unixSeconds);
+            break;
+        }
+
         default:
             WARN("Invalid request type received: {:d}", static_cast<uint8_t>(request.get_which_request_type()));
             break;
@@ -427,15 +499,111 @@ namespace kilight::com {
     void WifiSubsystem::processWrite(connected_session_t& session,
                                      WriteOutput const & writeRequest) const {
         DEBUG("Processing write request");
+        processCommand(session, m_writeRequestCallback, writeRequest);
+    }
+
+    void WifiSubsystem::processEffectCommand(connected_session_t& session,
+                                             EffectCommand const& effectCommand) const {
+        DEBUG("Processing effect command");
+        if (effectCommand.action() == EffectCommand::Action::Query) {
+            queueEffectProgramReply(session, effectCommand.slot());
+            return;
+        }
+        processCommand(session, m_effectCommandCallback, effectCommand);
+    }
+
+    void WifiSubsystem::queueEffectProgramReply(connected_session_t& session, uint32_t const slot) const {
         Response response;
-        if (m_writeRequestCallback) {
-            response.set_commandResult(m_writeRequestCallback(writeRequest));
+        if (slot >= output::MaxEffectPrograms) {
+            WARN("Invalid effect slot requested: {}", slot);
+            response.mutable_commandResult().set_result(CommandResult::Result::Error);
         } else {
-            response.mutable_commandResult().set_result(CommandResult::Result::OK);
+            response.set_effectProgram(m_storage->pendingData().effects[slot].toEffectProgram());
         }
         queueReply(session, response);
     }
 
+    void WifiSubsystem::processFetchHistory(connected_session_t& session, FetchHistory const& fetchHistory) const {
+        DEBUG("Processing history fetch");
+        FetchHistory remaining = fetchHistory;
+        // Pages go out back to back for as long as the send buffer has room, and the client asks again from wherever
+        // they stopped for the rest
+        for (bool firstPage = true; ; firstPage = false) {
+            Response response;
+            if (!m_fetchHistoryCallback || !m_fetchHistoryCallback(remaining, response.mutable_historyPage())) {
+                response.mutable_commandResult().set_result(CommandResult::Result::Error);
+                queueReply(session, response);
+                return;
+            }
+
+            uint32_t const buckets = response.get_historyPage().average().get_length();
+            if (!firstPage && session.writeBuffer.get_available_size() < response.serialized_size() + 1) {
+                return;
+            }
+            queueReply(session, response);
+
+            if (buckets == 0 || buckets >= remaining.count()) {
+                return;
+            }
+            remaining.set_startBucket(remaining.startBucket() + buckets);
+            remaining.set_count(remaining.count() - buckets);
+        }
+    }
+
+    void WifiSubsystem::processPresetCommand(connected_session_t& session,
+                                             PresetCommand const& presetCommand) const {
+        DEBUG("Processing preset command");
+        switch (presetCommand.action()) {
+        case PresetCommand::Action::Query:
+            queuePresetReply(session, presetCommand.slot());
+            break;
+
+        case PresetCommand::Action::List:
+            queuePresetListReply(session);
+            break;
+
+        default:
+            processCommand(session, m_presetCommandCallback, presetCommand);
+            break;
+        }
+    }
+
+    void WifiSubsystem::queuePresetReply(connected_session_t& session, uint32_t const slot) const {
+        Response response;
+        if (slot >= output::MaxPresets) {
+            WARN("Invalid preset slot requested: {}", slot);
+            response.mutable_commandResult().set_result(CommandResult::Result::Error);
+        } else {
+            response.set_preset(m_storage->pendingData().presets[slot].toPreset());
+        }
+        queueReply(session, response);
+    }
+
+    void WifiSubsystem::queuePresetListReply(connected_session_t& session) const {
+        static_assert(output::MaxPresets <= 32, "Preset list has a bit per slot");
+        uint32_t usedSlots = 0;
+        for (uint8_t slot = 0; slot < output::MaxPresets; ++slot) {
+            if (!m_storage->pendingData().presets[slot].empty()) {
+                usedSlots |= 1U << slot;
+            }
+        }
+        Response response;
+        response.mutable_presetList().set_usedSlots(usedSlots);
+        queueReply(session, response);
+    }
+
+    void WifiSubsystem::processScheduleCommand(connected_session_t& session,
+                                               ScheduleCommand const& scheduleCommand) const {
+        DEBUG("Processing schedule command");
+        if (scheduleCommand.action() == ScheduleCommand::Action::Query) {
+            Response response;
+            response.set_schedule(m_storage->pendingData().schedule.toSchedule());
+            queueReply(session, response);
+            return;
+        }
+        processCommand(session, m_scheduleCommandCallback, scheduleCommand);
+    }
+
     err_t WifiSubsystem::acceptCallback(tcp_pcb* const clientPCB, err_t const err) {
         if (err != ERR_OK || clientPCB == nullptr) {
             ERROR("Failed during TCP accept, error {}", err);
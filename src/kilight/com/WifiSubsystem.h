@@ -19,6 +19,18 @@
 #include <kilight/protocol/Request.h>
 #include <kilight/protocol/Response.h>
 #include <kilight/protocol/OutputIdentifier.h>
+#include <kilight/protocol/EffectCommand.h>
+#include <kilight/protocol/ConfigureOutput.h>
+#include <kilight/protocol/CalibrateCurrentModel.h>
+#include <kilight/protocol/ConfigurePowerBudget.h>
+#include <kilight/protocol/ConfigureThermalDerating.h>
+#include <kilight/protocol/ConfigureThermalModel.h>
+#include <kilight/protocol/ConfigureThermometerResolution.h>
+#include <kilight/protocol/FetchHistory.h>
+#include <kilight/protocol/HistoryPage.h>
+#include <kilight/protocol/PresetCommand.h>
+#include <kilight/protocol/TransitionCommand.h>
+#include <kilight/protocol/ScheduleCommand.h>
 
 #include "kilight/com/ServerReadBuffer.h"
 #include "kilight/conf/HardwareConfig.h"
@@ -76,13 +88,27 @@ namespace kilight::com {
         }
 
         template <typename UpdateFuncT>
-        void updateOutputStateData(protocol::OutputIdentifier const outputId, UpdateFuncT&& updateFunc) {
+        void updateOutputStateData(uint8_t const outputIndex, UpdateFuncT&& updateFunc) {
             cyw43_arch_lwip_begin();
-            if (outputId == protocol::OutputIdentifier::OutputA) {
+            switch (outputIndex) {
+            case 0:
                 updateFunc(m_stateData.mutable_outputA());
-            }
-            if (outputId == protocol::OutputIdentifier::OutputB) {
+                break;
+
+            case 1:
                 updateFunc(m_stateData.mutable_outputB());
+                break;
+
+            case 2:
+                updateFunc(m_stateData.mutable_outputC());
+                break;
+
+            case 3:
+                updateFunc(m_stateData.mutable_outputD());
+                break;
+
+            default:
+                break;
             }
             cyw43_arch_lwip_end();
         }
@@ -92,6 +118,71 @@ namespace kilight::com {
             m_writeRequestCallback = std::forward<CallbackT>(callback);
         }
 
+        template <typename CallbackT>
+        void setEffectCommandCallback(CallbackT&& callback) {
+            m_effectCommandCallback = std::forward<CallbackT>(callback);
+        }
+
+        template <typename CallbackT>
+        void setConfigureOutputCallback(CallbackT&& callback) {
+            m_configureOutputCallback = std::forward<CallbackT>(callback);
+        }
+
+        template <typename CallbackT>
+        void setConfigurePowerBudgetCallback(CallbackT&& callback) {
+            m_configurePowerBudgetCallback = std::forward<CallbackT>(callback);
+        }
+
+        template <typename CallbackT>
+        void setCalibrateCurrentModelCallback(CallbackT&& callback) {
+            m_calibrateCurrentModelCallback = std::forward<CallbackT>(callback);
+        }
+
+        template <typename CallbackT>
+        void setConfigureThermalDeratingCallback(CallbackT&& callback) {
+            m_configureThermalDeratingCallback = std::forward<CallbackT>(callback);
+        }
+
+        template <typename CallbackT>
+        void setConfigureThermalModelCallback(CallbackT&& callback) {
+            m_configureThermalModelCallback = std::forward<CallbackT>(callback);
+        }
+
+        template <typename CallbackT>
+        void setConfigureThermometerResolutionCallback(CallbackT&& callback) {
+            m_configureThermometerResolutionCallback = std::forward<CallbackT>(callback);
+        }
+
+        template <typename CallbackT>
+        void setFetchHistoryCallback(CallbackT&& callback) {
+            m_fetchHistoryCallback = std::forward<CallbackT>(callback);
+        }
+
+        template <typename CallbackT>
+        void setPresetCommandCallback(CallbackT&& callback) {
+            m_presetCommandCallback = std::forward<CallbackT>(callback);
+        }
+
+        template <typename CallbackT>
+        void setRecallPresetCallback(CallbackT&& callback) {
+            m_recallPresetCallback = std::forward<CallbackT>(callback);
+        }
+
+        template <typename CallbackT>
+        void setTransitionCommandCallback(CallbackT&& callback) {
+            m_transitionCommandCallback = std::forward<CallbackT>(callback);
+        }
+
+        template <typename CallbackT>
+        void setScheduleCommandCallback(CallbackT&& callback) {
+            m_scheduleCommandCallback = std::forward<CallbackT>(callback);
+        }
+
+        template <typename CallbackT>
+        void setSetTimeCallback(CallbackT&& callback) {
+            m_setTimeCallback = std::forward<CallbackT>(callback);
+        }
+
     private:
         enum class State {
             Invalid,
@@ -156,6 +247,37 @@ namespace kilight::com {
 
         std::function<protocol::CommandResult(protocol::WriteOutput const&)> m_writeRequestCallback;
 
+        std::function<protocol::CommandResult(protocol::EffectCommand const&)> m_effectCommandCallback;
+
+        std::function<protocol::CommandResult(protocol::ConfigureOutput const&)> m_configureOutputCallback;
+
+        std::function<protocol::CommandResult(protocol::ConfigurePowerBudget const&)> m_configurePowerBudgetCallback;
+
+        std::function<protocol::CommandResult(protocol::CalibrateCurrentModel const&)> m_calibrateCurrentModelCallback;
+
+        std::function<protocol::CommandResult(protocol::ConfigureThermalDerating const&)>
+        m_configureThermalDeratingCallback;
+
+        std::function<protocol::CommandResult(protocol::ConfigureThermalModel const&)> m_configureThermalModelCallback;
+
+        std::function<protocol::CommandResult(protocol::ConfigureThermometerResolution const&)>
+        m_configureThermometerResolutionCallback;
+
+        // Fills in a page of history starting from the requested bucket, false if the request isn't valid
+        std::function<bool(protocol::FetchHistory const&, protocol::HistoryPage&)> m_fetchHistoryCallback;
+
+        std::function<protocol::CommandResult(protocol::PresetCommand const&)> m_presetCommandCallback;
+
+        // Takes the preset slot
+        std::function<protocol::CommandResult(uint32_t const&)> m_recallPresetCallback;
+
+        std::function<protocol::CommandResult(protocol::TransitionCommand const&)> m_transitionCommandCallback;
+
+        std::function<protocol::CommandResult(protocol::ScheduleCommand const&)> m_scheduleCommandCallback;
+
+        // Takes seconds since the Unix epoch
+        std::function<protocol::CommandResult(uint64_t const&)> m_setTimeCallback;
+
         bool volatile m_verifyConnectionNeeded = false;
 
         mpf::types::FixedFormattedString<32> m_mdnsHardwareId{
@@ -191,6 +313,34 @@ namespace kilight::com {
 
         void processWrite(connected_session_t& session, protocol::WriteOutput const& writeRequest) const;
 
+        void processEffectCommand(connected_session_t& session, protocol::EffectCommand const& effectCommand) const;
+
+        void queueEffectProgramReply(connected_session_t& session, uint32_t slot) const;
+
+        void processFetchHistory(connected_session_t& session, protocol::FetchHistory const& fetchHistory) const;
+
+        void processPresetCommand(connected_session_t& session, protocol::PresetCommand const& presetCommand) const;
+
+        void queuePresetReply(connected_session_t& session, uint32_t slot) const;
+
+        void queuePresetListReply(connected_session_t& session) const;
+
+        void processScheduleCommand(connected_session_t& session,
+                                    protocol::ScheduleCommand const& scheduleCommand) const;
+
+        template <typename CommandT>
+        void processCommand(connected_session_t& session,
+                            std::function<protocol::CommandResult(CommandT const&)> const& callback,
+                            CommandT const& command) const {
+            protocol::Response response;
+            if (callback) {
+                response.set_commandResult(callback(command));
+            } else {
+                response.mutable_commandResult().set_result(protocol::CommandResult::Result::OK);
+            }
+            queueReply(session, response);
+        }
+
         err_t acceptCallback(tcp_pcb* clientPCB, err_t error);
 
         err_t receiveCallback(connected_session_t* session, tcp_pcb* tpcb, pbuf* data, err_t error);
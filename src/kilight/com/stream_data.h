@@ -0,0 +1,58 @@
+/**
+ * stream_data.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <mpf/util/macros.h>
+
+#include "kilight/conf/HardwareConfig.h"
+#include "kilight/output/rgbcw_color.h"
+
+namespace kilight::com {
+
+    static constexpr uint8_t StreamOutputCount = conf::HardwareConfig::OutputCount;
+
+    // Each output takes 5 channels of streamed data, in red, green, blue, cold white, warm white order
+    static constexpr uint8_t StreamChannelsPerOutput = 5;
+
+    static constexpr uint32_t StreamChannelCount = StreamOutputCount * StreamChannelsPerOutput;
+
+    // Header of a Distributed Display Protocol packet, all multibyte fields are big-endian
+    struct PACKED ddp_header_t {
+        static constexpr uint8_t VersionMask = 0xC0;
+        static constexpr uint8_t Version1 = 0x40;
+        static constexpr uint8_t FlagTimecode = 0x10;
+        static constexpr uint8_t FlagStorage = 0x08;
+        static constexpr uint8_t FlagReply = 0x04;
+        static constexpr uint8_t FlagQuery = 0x02;
+        static constexpr uint8_t FlagPush = 0x01;
+
+        static constexpr uint8_t SequenceMask = 0x0F;
+
+        static constexpr uint8_t DestinationDefault = 1;
+        static constexpr uint8_t DestinationAll = 255;
+
+        uint8_t flags = 0;
+        uint8_t sequence = 0;
+        uint8_t dataType = 0;
+        uint8_t destinationId = 0;
+        uint32_t dataOffset = 0;
+        uint16_t dataLength = 0;
+    };
+
+    // Sender's timestamp of the frame, in 16.16 fixed point seconds. Only present when FlagTimecode is set.
+    using ddp_timecode_t = uint32_t;
+
+    struct stream_frame_t {
+        std::array<output::rgbcw_color_t, StreamOutputCount> outputs {};
+
+        // When the frame should be shown, in local time_us_64() time
+        uint64_t playoutTimeUs = 0;
+    };
+}
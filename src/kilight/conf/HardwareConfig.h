@@ -7,10 +7,21 @@
 
 #include <cstdint>
 
+#include <pico.h>
+
 namespace kilight::conf {
 
     class HardwareConfig {
     public:
+        // Protocol and save data have room for this many outputs, no matter how many the board actually has
+        static constexpr uint8_t MaxOutputCount = 4;
+
+        // Number of outputs fitted to the board, from its board header
+        static constexpr uint8_t OutputCount = KILIGHT_NUMBER_OF_OUTPUTS;
+
+        static_assert(OutputCount >= 1 && OutputCount <= MaxOutputCount,
+                      "KILIGHT_NUMBER_OF_OUTPUTS must be between 1 and HardwareConfig::MaxOutputCount");
+
         static uint64_t getUniqueID();
 
         HardwareConfig() = delete;
@@ -13,6 +13,9 @@ namespace kilight::conf {
         std::string_view const SSID;
         std::string_view const Password;
         uint16_t const ListenPort;
+        uint16_t const StreamListenPort;
+        // Empty to leave setting the clock to clients
+        std::string_view const SntpServer;
     };
 
     wifi_config_t const & getWifiConfig();
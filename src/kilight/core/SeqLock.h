@@ -0,0 +1,72 @@
+/**
+ * SeqLock.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <pico/platform.h>
+
+namespace kilight::core {
+
+    /**
+     * Publishes a value from a single writer to any number of readers without ever blocking the writer. Readers retry
+     * if the value changed while they were copying it.
+     *
+     * @tparam ValueT Value to publish, must be trivially copyable
+     */
+    template <typename ValueT>
+    class SeqLock final {
+        static_assert(std::is_trivially_copyable_v<ValueT>, "SeqLock values must be trivially copyable");
+
+        static constexpr size_t WordCount = (sizeof(ValueT) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+        using words_t = std::array<uint32_t, WordCount>;
+
+    public:
+        __force_inline void write(ValueT const& value) {
+            words_t words {};
+            memcpy(words.data(), &value, sizeof(ValueT));
+
+            uint32_t const sequence = m_sequence.load(std::memory_order_relaxed);
+            m_sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t index = 0; index < WordCount; ++index) {
+                m_words[index].store(words[index], std::memory_order_relaxed);
+            }
+            m_sequence.store(sequence + 2, std::memory_order_release);
+        }
+
+        [[nodiscard]]
+        ValueT read() const {
+            words_t words {};
+            uint32_t before = 0;
+            uint32_t after = 0;
+            do {
+                before = m_sequence.load(std::memory_order_acquire);
+                for (size_t index = 0; index < WordCount; ++index) {
+                    words[index] = m_words[index].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                after = m_sequence.load(std::memory_order_relaxed);
+            } while ((before & 1U) != 0 || before != after);
+
+            ValueT value;
+            memcpy(static_cast<void*>(&value), words.data(), sizeof(ValueT));
+            return value;
+        }
+
+    private:
+        std::atomic<uint32_t> m_sequence {0};
+
+        std::array<std::atomic<uint32_t>, WordCount> m_words {};
+    };
+
+}
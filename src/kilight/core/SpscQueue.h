@@ -0,0 +1,75 @@
+/**
+ * SpscQueue.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include <pico/platform.h>
+
+namespace kilight::core {
+
+    /**
+     * Bounded lock-free queue for exactly one producer and one consumer, which may be on different cores. Never
+     * blocks and never allocates, so it is safe to use from interrupt handlers and from code running out of RAM while
+     * flash is being written.
+     *
+     * @tparam ItemT Type of item to queue, copied in and out
+     * @tparam Capacity Maximum number of queued items, must be a power of two
+     */
+    template <typename ItemT, uint32_t Capacity>
+    class SpscQueue final {
+        static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+        static constexpr uint32_t IndexMask = Capacity - 1;
+
+    public:
+        /**
+         * Producer side only.
+         *
+         * @return false if the queue is full and the item was not queued
+         */
+        __force_inline bool push(ItemT const& item) {
+            uint32_t const head = m_head.load(std::memory_order_relaxed);
+            if (head - m_tail.load(std::memory_order_acquire) == Capacity) {
+                return false;
+            }
+            m_items[head & IndexMask] = item;
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * Consumer side only.
+         *
+         * @return false if the queue was empty
+         */
+        __force_inline bool pop(ItemT& item) {
+            uint32_t const tail = m_tail.load(std::memory_order_relaxed);
+            if (tail == m_head.load(std::memory_order_acquire)) {
+                return false;
+            }
+            item = m_items[tail & IndexMask];
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        [[nodiscard]]
+        __force_inline bool empty() const {
+            return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire);
+        }
+
+    private:
+        std::array<ItemT, Capacity> m_items {};
+
+        std::atomic<uint32_t> m_head {0};
+
+        std::atomic<uint32_t> m_tail {0};
+    };
+
+}
@@ -6,92 +6,259 @@
 
 #include "kilight/hw/ADC.h"
 
+#include <algorithm>
+
 #include <pico/stdlib.h>
 #include <hardware/adc.h>
 #include <hardware/dma.h>
+#include <hardware/pwm.h>
+
+#include "kilight/hw/OverCurrentGuard.h"
+#include "kilight/hw/SystemPins.h"
 
 namespace kilight::hw {
 
-    void ADC::onConversionCompleteCallback() {
-        adc_run(false);
-        adc_fifo_drain();
-        dma_channel_acknowledge_irq0(dmaChannel);
-        dataIsReady = true;
-        conversionRunning.clear();
-    }
+    void __not_in_flash_func(ADC::onBufferCompleteCallback)() {
+        bool const firstComplete = dma_channel_get_irq0_status(dmaChannels[0]);
+        bool const secondComplete = dma_channel_get_irq0_status(dmaChannels[1]);
 
-    void ADC::start() {
-        if (conversionRunning.test_and_set()) {
+        if (firstComplete && secondComplete) {
+            // Both buffers filled before either was handled (like while flash was being written), so the channel
+            // that chained back around wrote over its own buffer and the round-robin order can't be trusted
+            ++statistics.overruns;
+            restart();
             return;
         }
 
-        if (!adcInitialized.test_and_set()) {
-            setUpADC();
+        uint8_t const completed = firstComplete ? 0 : 1;
+        dma_channel_acknowledge_irq0(dmaChannels[completed]);
+        reduceBuffer(sampleBuffers[completed]);
+        // Only arms it, it starts when the other channel chains to it
+        dma_channel_set_write_addr(dmaChannels[completed], sampleBuffers[completed].samples.data(), false);
+    }
+
+    void ADC::start(SamplingMode const mode) {
+        if (adcInitialized.test_and_set()) {
+            return;
         }
 
-        dataIsReady = false;
+        samplingMode = mode;
+        setUpADC();
+        restart();
+    }
 
-        dma_channel_set_write_addr(dmaChannel, sampleBuffer.data(), true);
-        adc_select_input(0);
-        adc_run(true);
+    void ADC::synchronizeToPWM() {
+        if (!adcInitialized.test() || samplingMode != SamplingMode::PWMSynchronous) {
+            return;
+        }
+
+        // Whatever's in the buffers now was sampled against the old phase, so it's thrown away along with them
+        irq_set_enabled(DMA_IRQ_0, false);
+        restart();
+        irq_set_enabled(DMA_IRQ_0, true);
     }
 
-    bool ADC::conversionInProgress() {
-        return conversionRunning.test();
+    void ADC::setTripThreshold(uint16_t const rawValue) {
+        tripThreshold = rawValue;
     }
 
-    std::array<ADC::sample_t, ADC::SampleBufferSize> const &ADC::data() {
-        return sampleBuffer;
+    ADC::statistics_t ADC::takeStatistics() {
+        auto const lock = statisticsLock.lock();
+        statistics_t const result = statistics;
+        statistics = {};
+        return result;
     }
 
     void ADC::setUpADC() {
         adc_fifo_setup(true, true, 1, true, false);
         adc_set_clkdiv(KILIGHT_ADC_CLKDIV);
 
-        #ifdef KILIGHT_HAS_OUTPUT_B
-        adc_set_round_robin(0b0011);
-        #else
-        adc_set_round_robin(0b0001);
-        #endif
+        adc_set_round_robin(SystemPins::CurrentSenseADCMask);
+
+        setUpDMA();
 
-        if (dmaChannel < 0) {
-            setUpDMA();
+        if (samplingMode == SamplingMode::PWMSynchronous) {
+            setUpPWMTrigger();
         }
     }
 
     void ADC::setUpDMA() {
-        dmaChannel = dma_claim_unused_channel(true);
+        passesPerBlock = samplingMode == SamplingMode::PWMSynchronous ? SynchronousPassesPerBlock : SampleBufferSize;
 
-        if (dmaChannel < 0) {
-            panic("ADC could not get an available DMA channel!");
+        for (int& dmaChannel : dmaChannels) {
+            dmaChannel = dma_claim_unused_channel(true);
+
+            if (dmaChannel < 0) {
+                panic("ADC could not get an available DMA channel!");
+            }
         }
 
-        dma_channel_config config = dma_channel_get_default_config(dmaChannel);
+        for (uint8_t index = 0; index < dmaChannels.size(); ++index) {
+            dma_channel_config config = dma_channel_get_default_config(dmaChannels[index]);
 
-        channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
-        channel_config_set_read_increment(&config, false);
-        channel_config_set_write_increment(&config, true);
-        channel_config_set_dreq(&config, DREQ_ADC);
+            channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+            channel_config_set_read_increment(&config, false);
+            channel_config_set_write_increment(&config, true);
+            channel_config_set_ring(&config, true, std::countr_zero(SampleRingBytes));
+            channel_config_set_dreq(&config, DREQ_ADC);
+            channel_config_set_chain_to(&config, dmaChannels[(index + 1) % dmaChannels.size()]);
 
-        dma_channel_configure(dmaChannel,
-                              &config,
-                              nullptr,
-                              &adc_hw->fifo,
-                              sampleBuffer.size() * (sizeof(sample_t) / sizeof(uint16_t)),
-                              false);
+            dma_channel_configure(dmaChannels[index],
+                                  &config,
+                                  sampleBuffers[index].samples.data(),
+                                  &adc_hw->fifo,
+                                  passesPerBlock * sizeof(sample_t) / sizeof(uint16_t),
+                                  false);
+
+            dma_channel_set_irq0_enabled(dmaChannels[index], true);
+        }
 
-        dma_channel_set_irq0_enabled(dmaChannel, true);
         irq_set_priority(DMA_IRQ_0, 0xF2);
         irq_set_priority(ADC_IRQ_FIFO, 0xF1);
-        irq_set_exclusive_handler(DMA_IRQ_0, &onConversionCompleteCallback);
+        irq_set_exclusive_handler(DMA_IRQ_0, &onBufferCompleteCallback);
         irq_set_enabled(DMA_IRQ_0, true);
     }
 
-    bool ADC::dataReady() {
-        return dataIsReady;
+    void ADC::setUpPWMTrigger() {
+        triggerDMAChannel = dma_claim_unused_channel(true);
+
+        if (triggerDMAChannel < 0) {
+            panic("ADC could not get an available DMA channel for the PWM trigger!");
+        }
+
+        dma_channel_config config = dma_channel_get_default_config(triggerDMAChannel);
+
+        channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+        channel_config_set_read_increment(&config, false);
+        channel_config_set_write_increment(&config, false);
+        channel_config_set_dreq(&config, pwm_get_dreq(SystemPins::ADCPacingPWMSlice));
+
+        // Through the set alias, so only START_ONCE is touched and the round-robin selection carries on
+        dma_channel_configure(triggerDMAChannel,
+                              &config,
+                              &hw_set_alias(adc_hw)->cs,
+                              &startOnceBits,
+                              dma_encode_endless_transfer_count(),
+                              false);
+
+        pwm_config pacingConfig = pwm_get_default_config();
+        pwm_config_set_wrap(&pacingConfig, PWMReference::PWMTop + PacingPhaseStep);
+        pwm_init(SystemPins::ADCPacingPWMSlice, &pacingConfig, false);
+    }
+
+    void __not_in_flash_func(ADC::restart)() {
+        adc_run(false);
+
+        uint32_t channelMask = (1U << dmaChannels[0]) | (1U << dmaChannels[1]);
+        if (samplingMode == SamplingMode::PWMSynchronous) {
+            pwm_set_enabled(SystemPins::ADCPacingPWMSlice, false);
+            channelMask |= 1U << triggerDMAChannel;
+        }
+
+        // Aborting both at once, so neither can chain to the other on the way out
+        dma_hw->abort = channelMask;
+        while ((dma_hw->abort & channelMask) != 0) {
+            tight_loop_contents();
+        }
+        dma_hw->ints0 = channelMask;
+        overThresholdReadings = {};
+
+        // Let a conversion that was already under way finish, so it doesn't end up at the front of the buffer
+        while ((adc_hw->cs & ADC_CS_READY_BITS) == 0) {
+            tight_loop_contents();
+        }
+        adc_fifo_drain();
+
+        dma_channel_set_write_addr(dmaChannels[1], sampleBuffers[1].samples.data(), false);
+        dma_channel_set_write_addr(dmaChannels[0], sampleBuffers[0].samples.data(), true);
+        adc_select_input(SystemPins::Output<0>::CurrentSense::ADCChannel);
+
+        if (samplingMode == SamplingMode::PWMSynchronous) {
+            startPWMTrigger();
+        } else {
+            adc_run(true);
+        }
+    }
+
+    void __not_in_flash_func(ADC::startPWMTrigger)() {
+        uint const referenceSlice = pwm_gpio_to_slice_num(PWMReference::Number);
+        uint const pacingSlice = SystemPins::ADCPacingPWMSlice;
+
+        // Same divider as the LED PWM, including the fraction, so the two only ever drift by the extra wrap count
+        pwm_hw->slice[pacingSlice].div = pwm_hw->slice[referenceSlice].div;
+        pwm_set_counter(pacingSlice, 0);
+        dma_channel_start(triggerDMAChannel);
+
+        uint32_t const interrupts = save_and_disable_interrupts();
+        pwm_set_enabled(pacingSlice, true);
+        auto const referenceCounter = static_cast<uint8_t>(pwm_get_counter(referenceSlice));
+        restore_interrupts(interrupts);
+
+        // The pacing slice first wraps after a full period of its own, a step further on than the LED PWM
+        nextBufferPhase = static_cast<uint8_t>(referenceCounter + PacingPhaseStep);
     }
 
-    void ADC::clearDataReady() {
-        dataIsReady = false;
+    void __not_in_flash_func(ADC::reduceBuffer)(sample_buffer_t const& buffer) {
+        bool const phaseLocked = samplingMode == SamplingMode::PWMSynchronous;
+        // Every reading is its own trigger, and each trigger is a phase step on from the last
+        uint8_t phase = nextBufferPhase;
+        size_t const readingCount = passesPerBlock * sizeof(sample_t) / sizeof(uint16_t);
+        nextBufferPhase = static_cast<uint8_t>(phase + readingCount * PacingPhaseStep);
+
+        // Kept to 32 bits per buffer, the 64 bit totals are only touched once per buffer
+        std::array<channel_statistics_t, conf::HardwareConfig::OutputCount> reduced {};
+        std::array<uint32_t, conf::HardwareConfig::OutputCount> sums {};
+        std::array<uint32_t, conf::HardwareConfig::OutputCount> sumsOfSquares {};
+
+        uint16_t const threshold = tripThreshold;
+
+        for (size_t pass = 0; pass < passesPerBlock; ++pass) {
+            for (uint8_t index = 0; index < conf::HardwareConfig::OutputCount; ++index) {
+                adc_reading_t const& reading = buffer.samples[pass].outputs[index];
+                channel_statistics_t& channel = reduced[index];
+                uint8_t const readingPhase = phase;
+                phase = static_cast<uint8_t>(phase + PacingPhaseStep);
+                if (reading.error) {
+                    ++channel.errors;
+                    continue;
+                }
+                uint32_t const value = reading.value;
+                if (value < threshold) {
+                    overThresholdReadings[index] = 0;
+                } else if (++overThresholdReadings[index] >= TripReadingCount) {
+                    overThresholdReadings[index] = 0;
+                    OverCurrentGuard::trip(index);
+                }
+                ++channel.count;
+                sums[index] += value;
+                sumsOfSquares[index] += value * value;
+                channel.minimum = std::min(channel.minimum, static_cast<uint16_t>(value));
+                channel.maximum = std::max(channel.maximum, static_cast<uint16_t>(value));
+                if (phaseLocked) {
+                    phase_bin_t& bin = channel.phases[readingPhase / CountsPerPhaseBin];
+                    ++bin.count;
+                    bin.sum += value;
+                }
+            }
+        }
+
+        // Statistics may be taken from either core
+        auto const lock = statisticsLock.lock();
+        statistics.mode = samplingMode;
+        for (uint8_t index = 0; index < conf::HardwareConfig::OutputCount; ++index) {
+            channel_statistics_t& channel = statistics.outputs[index];
+            channel.count += reduced[index].count;
+            channel.errors += reduced[index].errors;
+            channel.sum += sums[index];
+            channel.sumOfSquares += sumsOfSquares[index];
+            channel.minimum = std::min(channel.minimum, reduced[index].minimum);
+            channel.maximum = std::max(channel.maximum, reduced[index].maximum);
+            if (phaseLocked) {
+                for (uint8_t bin = 0; bin < PhaseBinCount; ++bin) {
+                    channel.phases[bin].count += reduced[index].phases[bin].count;
+                    channel.phases[bin].sum += reduced[index].phases[bin].sum;
+                }
+            }
+        }
     }
 }
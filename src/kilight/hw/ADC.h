@@ -10,12 +10,27 @@
 #include <cstddef>
 #include <array>
 #include <atomic>
+#include <bit>
+
+#include <hardware/regs/adc.h>
 
 #include <mpf/util/macros.h>
 #include <mpf/core/Logging.h>
 
+#include "kilight/conf/HardwareConfig.h"
+#include "kilight/core/CriticalSection.h"
+#include "kilight/hw/SystemPins.h"
+
 namespace kilight::hw {
 
+    /**
+     * Samples the current sense channels continuously. Two DMA channels chain to each other, each filling its own
+     * buffer while the other one's is reduced into running statistics, so there's no gap between buffers.
+     *
+     * Conversions either free run, or are triggered once per LED PWM period by a pacing PWM slice whose period is one
+     * count longer. That walks the sampling point through every phase of the LED PWM period in turn, so each reading
+     * lands in a known phase bin.
+     */
     class ADC final {
         LOGGER(ADC);
     public:
@@ -25,55 +40,170 @@ namespace kilight::hw {
             bool volatile error: 1;
         };
 
+        // One round-robin pass over the current sense channels, in output order
         struct PACKED sample_t {
-            adc_reading_t channelZero;
+            std::array<adc_reading_t, conf::HardwareConfig::OutputCount> outputs;
+        };
 
-            #ifdef KILIGHT_HAS_OUTPUT_B
-            adc_reading_t channelOne;
-            #endif
+        enum class SamplingMode : uint8_t {
+            FreeRunning,
+            PWMSynchronous
         };
 
-        static constexpr size_t SampleBufferSize = 128;
+        // Bins the LED PWM period is split into for PWM-synchronous sampling
+        static constexpr uint8_t PhaseBinCount = 16;
 
-        static constexpr uint16_t ReferenceVoltageMilliVolts = 3000;
+        struct phase_bin_t {
+            uint32_t count = 0;
 
-        static constexpr uint16_t ADCMaxValue = 0x0FFF;
+            uint32_t sum = 0;
+        };
 
-        static constexpr float MilliVoltsPerADCBit = static_cast<float>(ReferenceVoltageMilliVolts) / static_cast<float>(ADCMaxValue);
+        // Raw ADC values, for everything sampled since the statistics were last taken
+        struct channel_statistics_t {
+            uint32_t count = 0;
 
-        static void onConversionCompleteCallback();
+            uint32_t errors = 0;
 
-        static void start();
+            uint64_t sum = 0;
 
-        [[nodiscard]]
-        static bool conversionInProgress();
+            uint64_t sumOfSquares = 0;
 
-        [[nodiscard]]
-        static bool dataReady();
+            uint16_t minimum = UINT16_MAX;
+
+            uint16_t maximum = 0;
+
+            // Only filled in when sampling is PWM-synchronous, bin 0 starts at the LED PWM counter wrapping
+            std::array<phase_bin_t, PhaseBinCount> phases {};
+        };
+
+        struct statistics_t {
+            std::array<channel_statistics_t, conf::HardwareConfig::OutputCount> outputs {};
+
+            // Number of times the reduction fell behind and sampling had to be restarted
+            uint32_t overruns = 0;
+
+            SamplingMode mode = SamplingMode::FreeRunning;
+        };
+
+        // Round-robin passes per buffer, at most 256 so a buffer's sum of squares fits in 32 bits
+        static constexpr size_t SampleBufferSize = 256;
+
+        // PWM-synchronous sampling only takes one conversion per PWM period, so the DMA hands over just this many
+        // passes at a time instead of a whole buffer, or the trip check would lag a full buffer (8ms per output)
+        static constexpr size_t SynchronousPassesPerBlock = 4;
+
+        static_assert(SynchronousPassesPerBlock <= SampleBufferSize);
+
+        // Readings in a row that have to reach the trip threshold before an output trips, so a single noisy reading
+        // can't trip it on its own
+        static constexpr uint8_t TripReadingCount = 3;
+
+        static constexpr uint16_t ReferenceVoltageMilliVolts = 3000;
+
+        static constexpr uint16_t ADCMaxValue = 0x0FFF;
 
-        static void clearDataReady();
+        static_assert(SampleBufferSize * ADCMaxValue * ADCMaxValue <= UINT32_MAX);
 
+        static constexpr float MilliVoltsPerADCBit = static_cast<float>(ReferenceVoltageMilliVolts) / static_cast<float>(ADCMaxValue);
+
+        static void onBufferCompleteCallback();
+
+        /**
+         * Starts sampling, if it isn't already running. It keeps running from then on.
+         *
+         * @param mode How conversions are triggered
+         */
+        static void start(SamplingMode mode);
+
+        /**
+         * Lines PWM-synchronous sampling back up with the LED PWM, which has to be done whenever the LED PWM slices
+         * are restarted. Does nothing when sampling is free running.
+         */
+        static void synchronizeToPWM();
+
+        /**
+         * Any output with TripReadingCount readings in a row at or above this is tripped by OverCurrentGuard from the
+         * interrupt, as soon as the block they landed in is reduced, without waiting for the statistics to be taken.
+         *
+         * @param rawValue Raw ADC value to trip at
+         */
+        static void setTripThreshold(uint16_t rawValue);
+
+        /**
+         * @return The statistics gathered since the last call, which start over from nothing
+         */
         [[nodiscard]]
-        static std::array<sample_t, SampleBufferSize> const & data();
+        static statistics_t takeStatistics();
 
         ADC() = delete;
 
         ~ADC() = delete;
 
     private:
-        static inline int dmaChannel = -1;
+        static constexpr size_t SampleBufferBytes = SampleBufferSize * sizeof(sample_t);
+
+        // The DMA write address wraps within this, so a buffer that isn't re-armed in time can't be overrun
+        static constexpr size_t SampleRingBytes = std::bit_ceil(SampleBufferBytes);
+
+        static_assert(SampleRingBytes <= (1U << 15), "DMA rings are at most 32kB");
+
+        struct alignas(SampleRingBytes) sample_buffer_t {
+            std::array<sample_t, SampleBufferSize> samples;
+        };
+
+        // Counts the pacing slice's wrap adds to the LED PWM period, which is how far the phase moves per trigger
+        static constexpr uint8_t PacingPhaseStep = 1;
+
+        using PWMReference = SystemPins::Output<0>::Red;
+
+        static constexpr uint16_t PWMPeriodCounts = PWMReference::PWMCount;
+
+        static_assert(PWMPeriodCounts == 256, "Phases are tracked in a uint8_t");
+
+        static constexpr uint8_t CountsPerPhaseBin = PWMPeriodCounts / PhaseBinCount;
+
+        static inline std::array<int, 2> dmaChannels = {-1, -1};
 
-        static inline std::array<sample_t, SampleBufferSize> sampleBuffer = {};
+        // Writes START_ONCE to the ADC each time the pacing slice wraps
+        static inline int triggerDMAChannel = -1;
+
+        // Not const, so it stays in RAM where the DMA can still read it while flash is being written
+        static inline uint32_t startOnceBits = ADC_CS_START_ONCE_BITS;
+
+        static inline SamplingMode samplingMode = SamplingMode::FreeRunning;
+
+        // Above anything the ADC can read, so nothing trips until a threshold is set
+        static inline uint16_t volatile tripThreshold = UINT16_MAX;
+
+        // LED PWM counter at the first reading of the next buffer to be reduced
+        static inline uint8_t volatile nextBufferPhase = 0;
+
+        // Round-robin passes the DMA fills before handing a buffer over to be reduced
+        static inline size_t passesPerBlock = SampleBufferSize;
+
+        // Readings in a row each output has been at or above the trip threshold, carried over from block to block
+        static inline std::array<uint8_t, conf::HardwareConfig::OutputCount> overThresholdReadings {};
+
+        static inline std::array<sample_buffer_t, 2> sampleBuffers = {};
 
         static inline std::atomic_flag adcInitialized = false;
 
-        static inline bool volatile dataIsReady = false;
+        static inline statistics_t statistics = {};
 
-        static inline std::atomic_flag volatile conversionRunning = false;
+        static inline core::CriticalSection statisticsLock;
 
         static void setUpADC();
 
         static void setUpDMA();
+
+        static void setUpPWMTrigger();
+
+        static void restart();
+
+        static void startPWMTrigger();
+
+        static void reduceBuffer(sample_buffer_t const& buffer);
     };
 
 }
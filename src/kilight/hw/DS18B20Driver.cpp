@@ -17,10 +17,31 @@ namespace kilight::hw {
         return static_cast<int16_t>(static_cast<float>(m_scratchpad.temperature) * 100 / 16);
     }
 
+    DS18B20Driver::Resolution DS18B20Driver::resolution() const {
+        return m_resolution;
+    }
+
+    void DS18B20Driver::setResolution(Resolution const resolution) {
+        m_resolution = resolution;
+    }
+
+    bool DS18B20Driver::configurationIsValid() const {
+        // Nothing to go on if the scratchpad didn't read back cleanly, so it's left until it does
+        return !m_scratchpadValid || m_scratchpad.config.resolution == m_resolution;
+    }
+
+    uint64_t DS18B20Driver::conversionTimeUs() const {
+        return std::max(conversionTimeUs(m_scratchpad.config.resolution), conversionTimeUs(m_resolution));
+    }
+
     bool DS18B20Driver::startRequestTemperatureConversion() const {
         return driver()->startOneWireWriteBlockData(convert_temperature_command_t{address()});
     }
 
+    bool DS18B20Driver::startRequestAllTemperatureConversion() const {
+        return driver()->startOneWireWriteBlockData(convert_temperature_all_command_t{});
+    }
+
     bool DS18B20Driver::completeRequestTemperatureConversion() const {
         return driver()->completeOneWireWriteBlock();
     }
@@ -46,12 +67,29 @@ namespace kilight::hw {
         if (uint8_t const calculatedCRC = util::MathUtil::crc8(std::span<std::byte const>{buffer});
             calculatedCRC != m_scratchpad.crc) {
             DEBUG("Temperature CRC mismatch (calc: {} / received: {}), retrying", calculatedCRC, m_scratchpad.crc);
+            m_scratchpadValid = false;
         } else {
+            m_scratchpadValid = true;
             onTemperatureReady(currentTemperature());
         }
         return true;
     }
 
+    bool DS18B20Driver::startWriteScratchpadCommand() const {
+        // The alarm thresholds are written back as they were, only the resolution changes. It isn't copied to the
+        // thermometer's EEPROM, it's set again from the save data after every power up instead.
+        scratchpad_write_t const scratchpadToWrite {
+            .tHRegister = m_scratchpad.tHRegister,
+            .tLRegister = m_scratchpad.tLRegister,
+            .config = {.resolution = m_resolution}
+        };
+        return driver()->startOneWireWriteBlockData(write_scratchpad_command_t{address(), scratchpadToWrite});
+    }
+
+    bool DS18B20Driver::completeWriteScratchpadCommand() const {
+        return driver()->completeOneWireWriteBlock();
+    }
+
     bool DS18B20Driver::startCopyScratchpadCommand() const {
         return driver()->startOneWireWriteBlockData(copy_scratchpad_command_t{address()});
     }
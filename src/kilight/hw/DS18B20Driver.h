@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 
 #include <mpf/util/macros.h>
@@ -18,6 +19,7 @@ namespace kilight::hw {
     class DS18B20Driver final : public OneWireDevice, public TemperatureSensor {
         LOGGER(DS18B20);
     public:
+        // At twelve bits, each bit less halves it
         static constexpr uint32_t ConversionTimeMs = 750;
 
         static constexpr uint8_t DeviceFamilyCode = 0x28;
@@ -29,6 +31,31 @@ namespace kilight::hw {
             TwelveBits = 0b11
         };
 
+        static constexpr uint8_t MinResolutionBits = 9;
+
+        static constexpr uint8_t MaxResolutionBits = 12;
+
+        // Quarter degree steps in 187.5ms, plenty for fan control and overheat detection
+        static constexpr Resolution DefaultResolution = Resolution::TenBits;
+
+        /**
+         * @param bits Bits of resolution, clamped to 9 to 12, or 0 for the default
+         */
+        static constexpr Resolution resolutionFromBits(uint8_t const bits) {
+            if (bits == 0) {
+                return DefaultResolution;
+            }
+            return static_cast<Resolution>(std::clamp(bits, MinResolutionBits, MaxResolutionBits) - MinResolutionBits);
+        }
+
+        static constexpr uint8_t resolutionBits(Resolution const resolution) {
+            return static_cast<uint8_t>(resolution) + MinResolutionBits;
+        }
+
+        static constexpr uint64_t conversionTimeUs(Resolution const resolution) {
+            return ConversionTimeMs * 1000 >> (MaxResolutionBits - resolutionBits(resolution));
+        }
+
         explicit DS18B20Driver(DS2485Driver* driver);
 
         ~DS18B20Driver() override = default;
@@ -36,9 +63,35 @@ namespace kilight::hw {
         [[nodiscard]]
         int16_t currentTemperature() const override;
 
+        [[nodiscard]]
+        Resolution resolution() const;
+
+        /**
+         * Sets the resolution the thermometer should be at. It's written to the thermometer the next time its
+         * scratchpad shows otherwise.
+         */
+        void setResolution(Resolution resolution);
+
+        [[nodiscard]]
+        bool configurationIsValid() const;
+
+        /**
+         * @return How long a conversion takes, at the slower of the resolution the thermometer was last read at and
+         *         the one it's being set to, so a conversion started just before a change is still waited out
+         */
+        [[nodiscard]]
+        uint64_t conversionTimeUs() const;
+
         [[nodiscard]]
         bool startRequestTemperatureConversion() const;
 
+        /**
+         * Starts a conversion on every DS18B20 on the bus at once, with a Skip ROM broadcast. Completed the same way
+         * as a conversion on just this one.
+         */
+        [[nodiscard]]
+        bool startRequestAllTemperatureConversion() const;
+
         [[nodiscard]]
         bool completeRequestTemperatureConversion() const;
 
@@ -54,6 +107,12 @@ namespace kilight::hw {
         [[nodiscard]]
         bool completeReadScratchpad();
 
+        [[nodiscard]]
+        bool startWriteScratchpadCommand() const;
+
+        [[nodiscard]]
+        bool completeWriteScratchpadCommand() const;
+
         [[nodiscard]]
         bool startCopyScratchpadCommand() const;
 
@@ -84,6 +143,12 @@ namespace kilight::hw {
             unsigned: 1;
         };
 
+        struct PACKED scratchpad_write_t {
+            int8_t tHRegister = 0;
+            int8_t tLRegister = 0;
+            configuration_register_t config {};
+        };
+
         struct PACKED scratchpad_t {
             int16_t temperature: 12 = 0;
             unsigned: 4;
@@ -126,10 +191,17 @@ namespace kilight::hw {
 
         using copy_scratchpad_command_t = match_rom_command_t<Command::CopyScratchPad>;
 
+        using write_scratchpad_command_t = match_rom_command_with_data_t<Command::WriteScratchPad, scratchpad_write_t>;
+
         using convert_temperature_command_t = match_rom_command_t<Command::ConvertT>;
 
         using convert_temperature_all_command_t = skip_rom_command_t<Command::ConvertT>;
 
         scratchpad_t m_scratchpad {};
+
+        // Whether m_scratchpad came through with a matching CRC
+        bool m_scratchpadValid = false;
+
+        Resolution m_resolution = DefaultResolution;
     };
 }
@@ -10,6 +10,10 @@ namespace kilight::hw {
     DS2485Driver::DS2485Driver() : I2CDevice(I2CAddress) {
     }
 
+    bool DS2485Driver::resultPending() const {
+        return m_resultPending;
+    }
+
     bool DS2485Driver::startReadMasterConfiguration() const {
         read_onewire_port_config_register_command_t const command {
             OneWirePortConfigRegister::MasterConfiguration
@@ -20,7 +24,7 @@ namespace kilight::hw {
     bool DS2485Driver::completeReadMasterConfiguration(master_configuration_t * const configurationOut) const {
         read_onewire_port_config_register_master_configuration_result_t result;
         if (!readResult(&result)) {
-            WARN("NACK on Read Master Configuration");
+            TRACE("Read Master Configuration result not ready yet");
             return false;
         }
         if (result.header.resultByte != 0xAA) {
@@ -44,7 +48,7 @@ namespace kilight::hw {
     bool DS2485Driver::completeWriteMasterConfiguration() const {
         command_result_t result;
         if (!readResult(&result)) {
-            WARN("NACK on Write Master Configuration Status read-back");
+            TRACE("Write Master Configuration result not ready yet");
             return false;
         }
 
@@ -74,7 +78,7 @@ namespace kilight::hw {
     bool DS2485Driver::completeReadRPUPBUFConfiguration(rpupbuf_configuration_t * const configurationOut) const {
         read_onewire_port_config_register_rpupbuf_configuration_result_t result;
         if (!readResult(&result)) {
-            WARN("NACK on Read RPUPBUF Configuration");
+            TRACE("Read RPUPBUF Configuration result not ready yet");
             return false;
         }
         if (result.header.resultByte != 0xAA) {
@@ -98,7 +102,7 @@ namespace kilight::hw {
     bool DS2485Driver::completeWriteRPUPBUFConfiguration() const {
         command_result_t result;
         if (!readResult(&result)) {
-            WARN("NACK on Write RPUPBUF Configuration Status read-back");
+            TRACE("Write RPUPBUF Configuration result not ready yet");
             return false;
         }
 
@@ -129,7 +133,7 @@ namespace kilight::hw {
     bool DS2485Driver::completeOneWireSearch(onewire_search_result_t * const searchResult) const {
         onewire_search_command_result_t result;
         if (!readResult(&result)) {
-            WARN("NACK on OneWire search command read-back");
+            TRACE("OneWire search command result not ready yet");
             return false;
         }
 
@@ -159,7 +163,7 @@ namespace kilight::hw {
     bool DS2485Driver::completeOneWireWriteBlock() const {
         command_result_t result;
         if (!readResult(&result)) {
-            WARN("NACK on OneWire write block read-back");
+            TRACE("OneWire write block result not ready yet");
             return false;
         }
 
@@ -102,11 +102,24 @@ namespace kilight::hw {
 
         static constexpr uint64_t ResetTimeUs = 560 * 2;
 
-        static constexpr uint64_t SearchDelayTimeUs = OperationDelayTimeUs + SequenceTimeUs * 65 + OneWireTime + ResetTimeUs + 100000;
+        // How long each operation should take going by the datasheet timings, before any slack
+        static constexpr uint64_t SearchExpectedTimeUs = OperationDelayTimeUs + SequenceTimeUs * 65 + OneWireTime
+                                                         + ResetTimeUs;
 
-        static constexpr uint64_t WriteBlockTimeUs = OperationDelayTimeUs + SequenceTimeUs * (3 + 8) + OneWireTime + ResetTimeUs + 10000;
+        static constexpr uint64_t WriteBlockExpectedTimeUs = OperationDelayTimeUs + SequenceTimeUs * (3 + 8)
+                                                             + OneWireTime + ResetTimeUs;
 
-        static constexpr uint64_t ReadBlockTimeUs = OperationDelayTimeUs + SequenceTimeUs * (10 + 8) + OneWireTime + ResetTimeUs + 10000;
+        static constexpr uint64_t ReadBlockExpectedTimeUs = OperationDelayTimeUs + SequenceTimeUs * (10 + 8)
+                                                            + OneWireTime + ResetTimeUs;
+
+        // The longest each operation is given before it's counted as failed
+        static constexpr uint64_t ConfigurationTimeUs = OperationDelayTimeUs + 10000;
+
+        static constexpr uint64_t SearchDelayTimeUs = SearchExpectedTimeUs + 100000;
+
+        static constexpr uint64_t WriteBlockTimeUs = WriteBlockExpectedTimeUs + 10000;
+
+        static constexpr uint64_t ReadBlockTimeUs = ReadBlockExpectedTimeUs + 10000;
 
         enum class OneWireRWPU : uint8_t {
             External = 0b00,
@@ -178,6 +191,15 @@ namespace kilight::hw {
 
         DS2485Driver();
 
+        /**
+         * The DS2485 NACKs its address while it's still running a command, so a failed complete call might only
+         * mean it isn't done yet.
+         *
+         * @return Whether the last result read failed because the DS2485 NACKed it
+         */
+        [[nodiscard]]
+        bool resultPending() const;
+
         [[nodiscard]]
         bool startReadMasterConfiguration() const;
 
@@ -234,7 +256,7 @@ namespace kilight::hw {
         bool completeOneWireReadBlock(OneWireDataT *const dataOut) const {
             onewire_read_block_command_result_t<OneWireDataT> result{};
             if (!readResult(&result)) {
-                WARN("NACK on OneWire read block read-back");
+                TRACE("OneWire read block result not ready yet");
                 return false;
             }
 
@@ -317,12 +339,13 @@ namespace kilight::hw {
 
         [[nodiscard]]
         bool readResult(command_result_t *const result) const {
+            m_resultPending = false;
             int const resultCode = read(result);
             if (resultCode > 0) {
                 return true;
             }
             if (resultCode == PICO_ERROR_GENERIC) {
-                WARN("Got I2C NACK error trying to read result");
+                m_resultPending = true;
                 return false;
             }
             if (resultCode == PICO_ERROR_TIMEOUT) {
@@ -336,12 +359,13 @@ namespace kilight::hw {
         template<typename ReadDataT>
         [[nodiscard]]
         bool readResult(command_read_t<ReadDataT> *const result) const {
+            m_resultPending = false;
             int const resultCode = read(result);
             if (resultCode > 0) {
                 return true;
             }
             if (resultCode == PICO_ERROR_GENERIC) {
-                WARN("Got I2C NACK error trying to read result");
+                m_resultPending = true;
                 return false;
             }
             if (resultCode == PICO_ERROR_TIMEOUT) {
@@ -351,5 +375,7 @@ namespace kilight::hw {
             WARN("Got error {} trying to read result", resultCode);
             return false;
         }
+
+        mutable bool m_resultPending = false;
     };
 }
@@ -6,8 +6,11 @@
 
 #include "kilight/hw/OneWireSubsystem.h"
 
+#include <algorithm>
 #include <cassert>
 
+#include <pico/time.h>
+
 using kilight::storage::StorageSubsystem;
 
 namespace kilight::hw {
@@ -121,6 +124,14 @@ namespace kilight::hw {
             readDeviceScratchpadCompleteState();
             break;
 
+        case WriteDeviceConfigStart:
+            writeDeviceConfigStartState();
+            break;
+
+        case WriteDeviceConfigComplete:
+            writeDeviceConfigCompleteState();
+            break;
+
         default:
             break;
         }
@@ -142,6 +153,19 @@ namespace kilight::hw {
         m_storage->saveAndReboot();
     }
 
+    void OneWireSubsystem::applyThermometerResolutions() {
+        auto const& resolutions = m_storage->pendingData().thermometerResolutions;
+        if (m_powerSupplyThermometer != nullptr) {
+            m_powerSupplyThermometer->setResolution(DS18B20Driver::resolutionFromBits(resolutions.powerSupply));
+        }
+        for (size_t index = 0; index < m_outputThermometers.size(); ++index) {
+            if (m_outputThermometers[index] != nullptr) {
+                m_outputThermometers[index]->setResolution(
+                    DS18B20Driver::resolutionFromBits(resolutions.outputs[index]));
+            }
+        }
+    }
+
     void OneWireSubsystem::wait(State const stateAfterWait, uint64_t const waitTimeUs) {
         m_state = State::Waiting;
         m_stateAfterWait = stateAfterWait;
@@ -153,20 +177,80 @@ namespace kilight::hw {
                              });
     }
 
+    void OneWireSubsystem::waitForCompletion(State const completeState, Operation const operation) {
+        m_currentOperation = operation;
+        m_operationStartUs = time_us_64();
+        m_pollBackoffUs = MinPollBackoffUs;
+        m_pollCount = 0;
+        wait(completeState, m_expectedLatencyUs[static_cast<size_t>(operation)]);
+    }
+
+    bool OneWireSubsystem::pollAgain() {
+        if (!m_driver.resultPending()) {
+            return false;
+        }
+        uint64_t const elapsedUs = time_us_64() - m_operationStartUs;
+        if (elapsedUs >= operationTimeLimitUs(m_currentOperation)) {
+            WARN("DS2485 still busy after {}us, giving up", elapsedUs);
+            return false;
+        }
+        ++m_pollCount;
+        wait(m_state, m_pollBackoffUs);
+        m_pollBackoffUs = std::min(m_pollBackoffUs * 2, MaxPollBackoffUs);
+        return true;
+    }
+
+    void OneWireSubsystem::operationComplete() {
+        auto const operation = static_cast<size_t>(m_currentOperation);
+        uint64_t& expectedUs = m_expectedLatencyUs[operation];
+        if (m_pollCount == 0) {
+            // Done by the first poll, so it may well have been done sooner. Creep the first poll earlier until it
+            // starts having to wait.
+            expectedUs -= expectedUs >> 4;
+        } else {
+            uint64_t const measuredUs = time_us_64() - m_operationStartUs;
+            if (measuredUs > expectedUs) {
+                expectedUs += (measuredUs - expectedUs) >> LatencyLearningShift;
+            } else {
+                expectedUs -= (expectedUs - measuredUs) >> LatencyLearningShift;
+            }
+        }
+        expectedUs = std::clamp(expectedUs, MinPollBackoffUs, operationTimeLimitUs(m_currentOperation));
+        TRACE("Operation {} took {} polls, first poll now after {}us", operation, m_pollCount, expectedUs);
+    }
+
+    uint64_t OneWireSubsystem::operationTimeLimitUs(Operation const operation) {
+        switch (operation) {
+            using enum Operation;
+        case Search:
+            return DS2485Driver::SearchDelayTimeUs;
+        case WriteBlock:
+            return DS2485Driver::WriteBlockTimeUs;
+        case ReadBlock:
+            return DS2485Driver::ReadBlockTimeUs;
+        default:
+            return DS2485Driver::ConfigurationTimeUs;
+        }
+    }
+
     void OneWireSubsystem::readMasterConfigurationStartState() {
         if (!m_driver.startReadMasterConfiguration()) {
             wait(State::ReadMasterConfigurationStart, ErrorRetryDelayUs);
             return;
         }
 
-        wait(State::ReadMasterConfigurationComplete, DS2485Driver::OperationDelayTimeUs);
+        waitForCompletion(State::ReadMasterConfigurationComplete, Operation::Configuration);
     }
 
     void OneWireSubsystem::readMasterConfigurationCompleteState() {
         if (!m_driver.completeReadMasterConfiguration(&m_masterConfiguration)) {
+            if (pollAgain()) {
+                return;
+            }
             wait(State::ReadMasterConfigurationStart, ErrorRetryDelayUs);
             return;
         }
+        operationComplete();
 
         TRACE("Master config - activePullUp: {} strongPullUp: {} powerDown: {} oneWireOverdriveSpeed: {}",
               static_cast<bool>(m_masterConfiguration.activePullUp),
@@ -189,14 +273,18 @@ namespace kilight::hw {
             return;
         }
 
-        wait(State::WriteMasterConfigurationComplete, DS2485Driver::OperationDelayTimeUs);
+        waitForCompletion(State::WriteMasterConfigurationComplete, Operation::Configuration);
     }
 
     void OneWireSubsystem::writeMasterConfigurationCompleteState() {
         if (!m_driver.completeWriteMasterConfiguration()) {
+            if (pollAgain()) {
+                return;
+            }
             wait(State::WriteMasterConfigurationStart, ErrorRetryDelayUs);
             return;
         }
+        operationComplete();
 
         m_state = State::ReadRPUPBUFConfigurationStart;
     }
@@ -207,14 +295,18 @@ namespace kilight::hw {
             return;
         }
 
-        wait(State::ReadRPUPBUFConfigurationComplete, DS2485Driver::OperationDelayTimeUs);
+        waitForCompletion(State::ReadRPUPBUFConfigurationComplete, Operation::Configuration);
     }
 
     void OneWireSubsystem::readRPUPBUFConfigurationCompleteState() {
         if (!m_driver.completeReadRPUPBUFConfiguration(&m_rpupbufConfiguration)) {
+            if (pollAgain()) {
+                return;
+            }
             wait(State::ReadRPUPBUFConfigurationStart, ErrorRetryDelayUs);
             return;
         }
+        operationComplete();
 
         m_state = State::WriteRPUPBUFConfigurationStart;
     }
@@ -231,14 +323,18 @@ namespace kilight::hw {
             return;
         }
 
-        wait(State::WriteRPUPBUFConfigurationComplete, DS2485Driver::OperationDelayTimeUs);
+        waitForCompletion(State::WriteRPUPBUFConfigurationComplete, Operation::Configuration);
     }
 
     void OneWireSubsystem::writeRPUPBUFConfigurationCompleteState() {
         if (!m_driver.completeWriteRPUPBUFConfiguration()) {
+            if (pollAgain()) {
+                return;
+            }
             wait(State::WriteRPUPBUFConfigurationStart, ErrorRetryDelayUs);
             return;
         }
+        operationComplete();
 
         m_state = State::ScanForDevicesStart;
     }
@@ -259,16 +355,20 @@ namespace kilight::hw {
             wait(State::ScanForDevicesStart, ErrorRetryDelayUs);
             return;
         }
-        wait(State::ScanForDevicesComplete, DS2485Driver::SearchDelayTimeUs);
+        waitForCompletion(State::ScanForDevicesComplete, Operation::Search);
     }
 
     void OneWireSubsystem::scanForDevicesCompleteState() {
         using enum State;
         DS2485Driver::onewire_search_result_t result{};
         if (!m_driver.completeOneWireSearch(&result)) {
+            if (pollAgain()) {
+                return;
+            }
             wait(ScanForDevicesStart, ErrorRetryDelayUs);
             return;
         }
+        operationComplete();
 
         onewire_address_t const foundAddress = result.address;
         if (uint8_t const calculatedCrc = foundAddress.calculateCrc();
@@ -322,14 +422,18 @@ namespace kilight::hw {
             return;
         }
 
-        wait(State::ReadOnboardDeviceScratchpadCommandComplete, DS2485Driver::WriteBlockTimeUs);
+        waitForCompletion(State::ReadOnboardDeviceScratchpadCommandComplete, Operation::WriteBlock);
     }
 
     void OneWireSubsystem::readOnboardDeviceScratchpadCommandCompleteState() {
         if (!m_onboardDevice.completeReadScratchpadCommand()) {
+            if (pollAgain()) {
+                return;
+            }
             wait(State::ReadOnboardDeviceScratchpadCommandStart, ErrorRetryDelayUs);
             return;
         }
+        operationComplete();
         m_state = State::ReadOnboardDeviceScratchpadStart;
     }
 
@@ -339,15 +443,19 @@ namespace kilight::hw {
             return;
         }
 
-        wait(State::ReadOnboardDeviceScratchpadComplete, DS2485Driver::ReadBlockTimeUs);
+        waitForCompletion(State::ReadOnboardDeviceScratchpadComplete, Operation::ReadBlock);
     }
 
     void OneWireSubsystem::readOnboardDeviceScratchpadCompleteState() {
         using enum State;
         if (!m_onboardDevice.completeReadScratchpad()) {
+            if (pollAgain()) {
+                return;
+            }
             wait(ReadOnboardDeviceScratchpadCommandStart, ErrorRetryDelayUs);
             return;
         }
+        operationComplete();
 
         if (!m_onboardDevice.configurationIsValid()) {
             DEBUG("Setting onboard device configuration");
@@ -380,21 +488,41 @@ namespace kilight::hw {
     }
 
     void OneWireSubsystem::requestTemperatureConversionStartState() {
-        if (!m_foundExternalDevices[m_currentExternalDevice].startRequestTemperatureConversion()) {
+        // The on-board thermometer converts continuously, so the broadcast reaching it too makes no difference
+        DS18B20Driver const& device = m_foundExternalDevices[m_currentExternalDevice];
+        bool const started = BroadcastConversion
+                                 ? device.startRequestAllTemperatureConversion()
+                                 : device.startRequestTemperatureConversion();
+        if (!started) {
             wait(State::RequestTemperatureConversionStart, ErrorRetryDelayUs);
             return;
         }
 
-        wait(State::RequestTemperatureConversionComplete, DS2485Driver::WriteBlockTimeUs);
+        waitForCompletion(State::RequestTemperatureConversionComplete, Operation::WriteBlock);
     }
 
     void OneWireSubsystem::requestTemperatureConversionCompleteState() {
         if (!m_foundExternalDevices[m_currentExternalDevice].completeRequestTemperatureConversion()) {
+            if (pollAgain()) {
+                return;
+            }
             wait(State::RequestTemperatureConversionStart, ErrorRetryDelayUs);
             return;
         }
+        operationComplete();
+
+        wait(State::ReadDeviceScratchpadCommandStart, conversionWaitUs());
+    }
 
-        wait(State::ReadDeviceScratchpadCommandStart, DS18B20Driver::ConversionTimeMs * 1000);
+    uint64_t OneWireSubsystem::conversionWaitUs() const {
+        if (!BroadcastConversion) {
+            return m_foundExternalDevices[m_currentExternalDevice].conversionTimeUs();
+        }
+        uint64_t waitUs = 0;
+        for (size_t index = 0; index < m_externalDevicesFound; ++index) {
+            waitUs = std::max(waitUs, m_foundExternalDevices[index].conversionTimeUs());
+        }
+        return waitUs;
     }
 
     void OneWireSubsystem::registerExternalOneWireDevice(onewire_address_t const& foundAddress) {
@@ -403,20 +531,31 @@ namespace kilight::hw {
         }
         m_foundExternalDevices[m_externalDevicesFound].setAddress(foundAddress);
 
-        if (StorageSubsystem::saveData().thermometerAddresses.powerSupply) {
-            if (foundAddress == StorageSubsystem::saveData().thermometerAddresses.powerSupply) {
+        auto const& savedAddresses = StorageSubsystem::saveData().thermometerAddresses;
+        if (savedAddresses.powerSupply) {
+            if (foundAddress == savedAddresses.powerSupply) {
                 m_powerSupplyThermometer = &m_foundExternalDevices[m_externalDevicesFound];
                 DEBUG("Found power supply OneWire device: {}", foundAddress);
             } else {
-                m_outputAThermometer = &m_foundExternalDevices[m_externalDevicesFound];
-                DEBUG("Found Output A OneWire device: {}", m_outputAThermometer->address());
-                // Auto-detection of Output B will be handled in a later version of the hardware/firmware
+                // A thermometer whose address was saved for an output goes back to it, anything else goes to the
+                // first output still without one. Auto-detection of which output a new thermometer is on will be
+                // handled in a later version of the hardware/firmware.
+                auto const saved = std::ranges::find(savedAddresses.outputs, foundAddress);
+                auto const unassigned = std::ranges::find(m_outputThermometers, nullptr);
+                size_t const outputIndex = saved != savedAddresses.outputs.end()
+                                               ? static_cast<size_t>(saved - savedAddresses.outputs.begin())
+                                               : static_cast<size_t>(unassigned - m_outputThermometers.begin());
+                if (outputIndex < m_outputThermometers.size() && m_outputThermometers[outputIndex] == nullptr) {
+                    m_outputThermometers[outputIndex] = &m_foundExternalDevices[m_externalDevicesFound];
+                    DEBUG("Found Output {:c} OneWire device: {}", static_cast<char>('A' + outputIndex), foundAddress);
+                }
             }
         } else {
             DEBUG("Found external OneWire device: {}", foundAddress);
         }
 
         ++m_externalDevicesFound;
+        applyThermometerResolutions();
     }
 
     void OneWireSubsystem::readDeviceScratchpadCommandStartState() {
@@ -425,14 +564,18 @@ namespace kilight::hw {
             return;
         }
 
-        wait(State::ReadDeviceScratchpadCommandComplete, DS2485Driver::WriteBlockTimeUs);
+        waitForCompletion(State::ReadDeviceScratchpadCommandComplete, Operation::WriteBlock);
     }
 
     void OneWireSubsystem::readDeviceScratchpadCommandCompleteState() {
         if (!m_foundExternalDevices[m_currentExternalDevice].completeReadScratchpadCommand()) {
+            if (pollAgain()) {
+                return;
+            }
             wait(State::ReadDeviceScratchpadCommandStart, ErrorRetryDelayUs);
             return;
         }
+        operationComplete();
         m_state = State::ReadDeviceScratchpadStart;
     }
 
@@ -442,16 +585,68 @@ namespace kilight::hw {
             return;
         }
 
-        wait(State::ReadDeviceScratchpadComplete, DS2485Driver::ReadBlockTimeUs);
+        waitForCompletion(State::ReadDeviceScratchpadComplete, Operation::ReadBlock);
     }
 
     void OneWireSubsystem::readDeviceScratchpadCompleteState() {
         using enum State;
         if (!m_foundExternalDevices[m_currentExternalDevice].completeReadScratchpad()) {
+            if (pollAgain()) {
+                return;
+            }
             wait(ReadDeviceScratchpadCommandStart, ErrorRetryDelayUs);
             return;
         }
+        operationComplete();
+
+        uint64_t const now = time_us_64();
+        if (uint64_t const lastReadUs = m_lastExternalReadUs[m_currentExternalDevice]; lastReadUs != 0) {
+            TRACE("Thermometer {} refreshed after {}ms",
+                  m_foundExternalDevices[m_currentExternalDevice].address(),
+                  (now - lastReadUs) / 1000);
+        }
+        m_lastExternalReadUs[m_currentExternalDevice] = now;
+
+        if (!m_foundExternalDevices[m_currentExternalDevice].configurationIsValid()) {
+            DEBUG("Setting thermometer {} to {} bit resolution",
+                  m_foundExternalDevices[m_currentExternalDevice].address(),
+                  DS18B20Driver::resolutionBits(m_foundExternalDevices[m_currentExternalDevice].resolution()));
+            m_state = WriteDeviceConfigStart;
+            return;
+        }
+        nextExternalDevice();
+    }
+
+    void OneWireSubsystem::writeDeviceConfigStartState() {
+        if (!m_foundExternalDevices[m_currentExternalDevice].startWriteScratchpadCommand()) {
+            wait(State::ReadDeviceScratchpadCommandStart, ErrorRetryDelayUs);
+            return;
+        }
+
+        waitForCompletion(State::WriteDeviceConfigComplete, Operation::WriteBlock);
+    }
+
+    void OneWireSubsystem::writeDeviceConfigCompleteState() {
+        if (!m_foundExternalDevices[m_currentExternalDevice].completeWriteScratchpadCommand()) {
+            if (pollAgain()) {
+                return;
+            }
+            wait(State::ReadDeviceScratchpadCommandStart, ErrorRetryDelayUs);
+            return;
+        }
+        operationComplete();
+        // Checked again the next time the thermometer is read
+        nextExternalDevice();
+    }
+
+    void OneWireSubsystem::nextExternalDevice() {
+        using enum State;
         ++m_currentExternalDevice;
+        if (BroadcastConversion && m_currentExternalDevice < m_externalDevicesFound) {
+            // Already converted along with the rest
+            m_state = ReadDeviceScratchpadCommandStart;
+            return;
+        }
         if (m_currentExternalDevice >= m_externalDevicesFound) {
             m_currentExternalDevice = 0;
         }
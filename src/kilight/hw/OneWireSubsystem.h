@@ -8,10 +8,12 @@
 
 #include <array>
 #include <functional>
+#include <utility>
 
 #include <mpf/core/Logging.h>
 #include <mpf/core/Subsystem.h>
 
+#include "kilight/conf/HardwareConfig.h"
 #include "kilight/core/Alarm.h"
 #include "kilight/hw/DS2485Driver.h"
 #include "kilight/hw/DS18B20Driver.h"
@@ -53,18 +55,39 @@ namespace kilight::hw {
             ReadDeviceScratchpadCommandStart,
             ReadDeviceScratchpadCommandComplete,
             ReadDeviceScratchpadStart,
-            ReadDeviceScratchpadComplete
+            ReadDeviceScratchpadComplete,
+            WriteDeviceConfigStart,
+            WriteDeviceConfigComplete
         };
+
+        // DS2485 commands that take noticeably different times, each timed separately
+        enum class Operation : uint8_t {
+            Configuration,
+            Search,
+            WriteBlock,
+            ReadBlock
+        };
+
+        static constexpr size_t OperationCount = 4;
     public:
         static constexpr uint64_t ErrorRetryDelayUs = 1000 * 1000;
 
         static constexpr uint64_t OnboardDeviceOnlyReadDelayUs = 1000 * 1000;
 
-        #ifdef KILIGHT_HAS_OUTPUT_B
-        static constexpr size_t MaxExternalDevicesToFind = 3;
-        #else
-        static constexpr size_t MaxExternalDevicesToFind = 2;
-        #endif
+        // Polls while the DS2485 is still busy start this far apart, doubling each time up to the max
+        static constexpr uint64_t MinPollBackoffUs = 250;
+
+        static constexpr uint64_t MaxPollBackoffUs = 4000;
+
+        // Fraction of the gap between the expected and measured time an operation took that's closed each time
+        static constexpr uint64_t LatencyLearningShift = 2;
+
+        // Converts every external thermometer together and then reads each in turn, so they all refresh once per
+        // conversion time rather than once per conversion time for each of them
+        static constexpr bool BroadcastConversion = KILIGHT_ONEWIRE_BROADCAST_CONVERSION;
+
+        // The power supply's thermometer, plus one for each output
+        static constexpr size_t MaxExternalDevicesToFind = conf::HardwareConfig::OutputCount + 1;
 
         explicit OneWireSubsystem(mpf::core::SubsystemList * list, storage::StorageSubsystem * storage);
 
@@ -79,6 +102,12 @@ namespace kilight::hw {
 
         void requestSetPowerSupplyThermometerAddress();
 
+        /**
+         * Sets each thermometer's resolution from the save data, for after the resolutions there have changed. The
+         * thermometers are written the next time each one is read.
+         */
+        void applyThermometerResolutions();
+
         template<typename FuncT>
         bool registerTemperatureUpdateCallback(onewire_address_t const deviceAddress, FuncT && callback) {
             for (size_t index = 0; index < m_externalDevicesFound; ++index) {
@@ -109,25 +138,14 @@ namespace kilight::hw {
         }
 
         template<typename FuncT>
-        bool registerOutputATemperatureUpdateCallback(FuncT && callback) {
-            if (m_outputAThermometer != nullptr) {
-                m_outputAThermometer->setOnTemperatureReadyCallback(std::forward<FuncT>(callback));
+        bool registerOutputTemperatureUpdateCallback(uint8_t const outputIndex, FuncT && callback) {
+            if (outputIndex < m_outputThermometers.size() && m_outputThermometers[outputIndex] != nullptr) {
+                m_outputThermometers[outputIndex]->setOnTemperatureReadyCallback(std::forward<FuncT>(callback));
                 return true;
             }
             return false;
         }
 
-        #ifdef KILIGHT_HAS_OUTPUT_B
-        template<typename FuncT>
-        bool registerOutputBTemperatureUpdateCallback(FuncT && callback) {
-            if (m_outputB != nullptr) {
-                m_outputB->setOnTemperatureReadyCallback(std::forward<FuncT>(callback));
-                return true;
-            }
-            return false;
-        }
-        #endif
-
     private:
         State volatile m_state = State::Invalid;
 
@@ -139,6 +157,22 @@ namespace kilight::hw {
 
         core::Alarm m_alarm;
 
+        // How long after starting each operation to first check for its result, learned from how long they take
+        std::array<uint64_t, OperationCount> m_expectedLatencyUs {
+            DS2485Driver::OperationDelayTimeUs,
+            DS2485Driver::SearchExpectedTimeUs,
+            DS2485Driver::WriteBlockExpectedTimeUs,
+            DS2485Driver::ReadBlockExpectedTimeUs
+        };
+
+        Operation m_currentOperation = Operation::Configuration;
+
+        uint64_t m_operationStartUs = 0;
+
+        uint64_t m_pollBackoffUs = MinPollBackoffUs;
+
+        uint8_t m_pollCount = 0;
+
         DS2485Driver::master_configuration_t m_masterConfiguration {};
 
         DS2485Driver::rpupbuf_configuration_t m_rpupbufConfiguration {};
@@ -151,26 +185,48 @@ namespace kilight::hw {
 
         size_t m_externalDevicesFound = 0;
 
-        std::array<DS18B20Driver, MaxExternalDevicesToFind> m_foundExternalDevices {
-            DS18B20Driver(&m_driver),
-            DS18B20Driver(&m_driver)
-            #ifdef KILIGHT_HAS_OUTPUT_B
-            ,DS18B20Driver(&m_driver)
-            #endif
-        };
+        std::array<DS18B20Driver, MaxExternalDevicesToFind> m_foundExternalDevices =
+            makeExternalDevices(&m_driver, std::make_index_sequence<MaxExternalDevicesToFind>{});
 
         size_t m_currentExternalDevice = 0;
 
+        // When each external thermometer was last read, to keep track of how often they're refreshed
+        std::array<uint64_t, MaxExternalDevicesToFind> m_lastExternalReadUs {};
+
         DS18B20Driver * m_powerSupplyThermometer = nullptr;
 
-        DS18B20Driver * m_outputAThermometer = nullptr;
+        std::array<DS18B20Driver *, conf::HardwareConfig::OutputCount> m_outputThermometers {};
 
-        #ifdef KILIGHT_HAS_OUTPUT_B
-        DS18B20Driver * m_outputBThermometer = nullptr;
-        #endif
+        template <size_t... Indices>
+        static std::array<DS18B20Driver, MaxExternalDevicesToFind> makeExternalDevices(DS2485Driver * driver,
+                                                                                      std::index_sequence<Indices...>) {
+            return {(static_cast<void>(Indices), DS18B20Driver(driver))...};
+        }
 
         void wait(State stateAfterWait, uint64_t waitTimeUs);
 
+        /**
+         * Waits for the operation just started, checking for its result in completeState once it's expected to be
+         * done.
+         */
+        void waitForCompletion(State completeState, Operation operation);
+
+        /**
+         * Call when a complete state couldn't get a result. If the DS2485 is only still busy, and the operation hasn't
+         * run past its limit, schedules the current state to poll again shortly.
+         *
+         * @return Whether another poll was scheduled, otherwise the failure should be handled as an error
+         */
+        bool pollAgain();
+
+        /**
+         * Call when a complete state got its result, to update how long that operation is expected to take.
+         */
+        void operationComplete();
+
+        [[nodiscard]]
+        static uint64_t operationTimeLimitUs(Operation operation);
+
         void readMasterConfigurationStartState();
 
         void readMasterConfigurationCompleteState();
@@ -217,6 +273,15 @@ namespace kilight::hw {
 
         void requestTemperatureConversionCompleteState();
 
+        void writeDeviceConfigStartState();
+
+        void writeDeviceConfigCompleteState();
+
+        void nextExternalDevice();
+
+        [[nodiscard]]
+        uint64_t conversionWaitUs() const;
+
         void registerExternalOneWireDevice(onewire_address_t const & foundAddress);
 
     };
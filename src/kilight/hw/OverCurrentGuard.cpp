@@ -0,0 +1,49 @@
+/**
+ * OverCurrentGuard.cpp
+ *
+ * @author Patrick Lavigne
+ */
+
+#include "kilight/hw/OverCurrentGuard.h"
+
+#include <pico/platform.h>
+
+#include "kilight/hw/SystemPins.h"
+
+namespace kilight::hw {
+
+    // Called from the ADC interrupt and from core 1, so all of it stays in RAM
+
+    void __not_in_flash_func(OverCurrentGuard::trip)(uint8_t const outputIndex) {
+        // Set first, so a write racing with this one on the other core sees the trip when it checks afterwards
+        trippedMask.fetch_or(1U << outputIndex);
+        writeZeroLevels(outputIndex);
+    }
+
+    void OverCurrentGuard::reset(uint8_t const outputIndex) {
+        trippedMask.fetch_and(~(1U << outputIndex));
+    }
+
+    bool __not_in_flash_func(OverCurrentGuard::tripped)(uint8_t const outputIndex) {
+        return (trippedMask.load() & (1U << outputIndex)) != 0;
+    }
+
+    uint32_t OverCurrentGuard::trippedOutputs() {
+        return trippedMask.load();
+    }
+
+    bool __not_in_flash_func(OverCurrentGuard::enforce)(uint8_t const outputIndex) {
+        if (!tripped(outputIndex)) {
+            return false;
+        }
+        writeZeroLevels(outputIndex);
+        return true;
+    }
+
+    void __not_in_flash_func(OverCurrentGuard::writeZeroLevels)(uint8_t const outputIndex) {
+        // The levels are double buffered, so this takes effect at each channel's next wrap, within one PWM period
+        SystemPins::withOutput(outputIndex, []<typename PinGroupT>(uint8_t) __attribute__((always_inline)) {
+            PinGroupT::writePWM({0, 0, 0, 0, 0});
+        });
+    }
+}
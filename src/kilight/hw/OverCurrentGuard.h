@@ -0,0 +1,51 @@
+/**
+ * OverCurrentGuard.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace kilight::hw {
+
+    /**
+     * Latched over-current trips. A trip forces the output's PWM levels to zero straight away, from whichever core or
+     * interrupt spotted it, and they stay at zero until the trip is reset.
+     */
+    class OverCurrentGuard final {
+    public:
+        static void trip(uint8_t outputIndex);
+
+        static void reset(uint8_t outputIndex);
+
+        [[nodiscard]]
+        static bool tripped(uint8_t outputIndex);
+
+        /**
+         * @return Bit mask of the outputs that are tripped
+         */
+        [[nodiscard]]
+        static uint32_t trippedOutputs();
+
+        /**
+         * Writes the zero levels again if the output is tripped. Call after writing levels to an output, so a trip
+         * that landed just before the write isn't undone by it.
+         *
+         * @return true if the output is tripped
+         */
+        static bool enforce(uint8_t outputIndex);
+
+        OverCurrentGuard() = delete;
+
+        ~OverCurrentGuard() = delete;
+
+    private:
+        static inline std::atomic<uint32_t> trippedMask = 0;
+
+        static void writeZeroLevels(uint8_t outputIndex);
+    };
+
+}
@@ -100,21 +100,51 @@ namespace kilight::hw {
     void GPIOWrapper::enablePWM(uint8_t const gpioNumber,
                                 uint32_t const frequencyHz,
                                 uint16_t const top) {
+        configurePWM(gpioNumber, frequencyHz, top, 0);
+        pwm_set_gpio_level(gpioNumber, 0);
+        pwm_set_enabled(pwm_gpio_to_slice_num(gpioNumber), true);
+    }
+
+    void GPIOWrapper::configurePWM(uint8_t const gpioNumber,
+                                   uint32_t const frequencyHz,
+                                   uint16_t const top,
+                                   uint16_t const counter) {
         float const maxFrequency = static_cast<float>(SysClock::Frequency) / static_cast<float>(top + 1);
         float const divider = maxFrequency / static_cast<float>(frequencyHz);
         auto const slice = pwm_gpio_to_slice_num(gpioNumber);
-        auto const channel = pwm_gpio_to_channel(gpioNumber);
+        // The level is left alone, so a running output can be reconfigured without going dark
+        pwm_set_enabled(slice, false);
         pwm_set_wrap(slice, top);
-        pwm_set_chan_level(slice, channel, 0);
         pwm_set_clkdiv(slice, divider);
-        pwm_set_counter(slice, 0);
-        pwm_set_enabled(slice, true);
+        pwm_set_counter(slice, counter);
+    }
+
+    uint32_t GPIOWrapper::pwmSliceMask(uint8_t const gpioNumber) {
+        return 1U << pwm_gpio_to_slice_num(gpioNumber);
+    }
+
+    void GPIOWrapper::startPWMSlices(uint32_t const sliceMask) {
+        // Same single write to the enable register as pwm_set_mask_enabled(), but through the atomic set alias so
+        // slices already running for something else (like the fan) aren't stopped
+        hw_set_bits(&pwm_hw->en, sliceMask);
     }
 
-    void GPIOWrapper::writePWM(uint8_t const gpioNumber, uint16_t const value) {
+    // Called from the render engine on core 1, which has to keep running out of RAM while flash is being written
+    void __not_in_flash_func(GPIOWrapper::writePWM)(uint8_t const gpioNumber, uint16_t const value) {
         pwm_set_gpio_level(gpioNumber, value);
     }
 
+    void GPIOWrapper::enablePWMEdgeCounting(uint8_t const gpioNumber) {
+        pwm_config config = pwm_get_default_config();
+        pwm_config_set_clkdiv_mode(&config, PWM_DIV_B_FALLING);
+        pwm_config_set_clkdiv(&config, 1.0f);
+        pwm_init(pwm_gpio_to_slice_num(gpioNumber), &config, true);
+    }
+
+    uint16_t GPIOWrapper::readPWMCounter(uint8_t const gpioNumber) {
+        return static_cast<uint16_t>(pwm_get_counter(pwm_gpio_to_slice_num(gpioNumber)));
+    }
+
 
     void GPIOWrapper::interruptWrapper(unsigned int const gpio, uint32_t const trigger) {
         if (interrupts[gpio]) {
@@ -10,6 +10,7 @@
 #include <functional>
 #include <array>
 #include <hardware/platform_defs.h>
+#include <pico/platform.h>
 
 namespace kilight::hw {
 
@@ -40,6 +41,13 @@ namespace kilight::hw {
         PullDown
     };
 
+    enum class PWMPhaseMode : uint8_t {
+        // Every channel's period starts at the same moment
+        Aligned,
+        // Channel periods are spread evenly through the PWM period, so as few pulses as possible overlap
+        Staggered
+    };
+
     constexpr GPIOInterruptTrigger operator|(GPIOInterruptTrigger const first, GPIOInterruptTrigger const second) {
         return static_cast<GPIOInterruptTrigger>(static_cast<uint32_t>(first) | static_cast<uint32_t>(second));
     }
@@ -55,6 +63,23 @@ namespace kilight::hw {
         GPIOWrapper() = delete;
         ~GPIOWrapper() = delete;
 
+        /**
+         * Starts several PWM slices with a single register write, so they run in lock step from then on.
+         *
+         * @param sliceMask Bit mask of the slices to start, slices not in the mask are left alone
+         */
+        static void startPWMSlices(uint32_t sliceMask);
+
+        /**
+         * Same mapping as pwm_gpio_to_slice_num(), but usable at compile time. The RP2350B's pins from 32 up wrap
+         * around slices 8 to 11.
+         */
+        static constexpr uint8_t pwmSliceFor(uint8_t const gpioNumber) {
+            return gpioNumber < 32
+                       ? static_cast<uint8_t>((gpioNumber >> 1U) & 7U)
+                       : static_cast<uint8_t>(8U + ((gpioNumber >> 1U) & 3U));
+        }
+
     protected:
         static void initPin(uint8_t gpioNumber, PinFunction pinFunction);
 
@@ -71,8 +96,18 @@ namespace kilight::hw {
 
         static void enablePWM(uint8_t gpioNumber, uint32_t frequencyHz, uint16_t top);
 
+        static void configurePWM(uint8_t gpioNumber, uint32_t frequencyHz, uint16_t top, uint16_t counter);
+
+        [[nodiscard]]
+        static uint32_t pwmSliceMask(uint8_t gpioNumber);
+
         static void writePWM(uint8_t gpioNumber, uint16_t value);
 
+        static void enablePWMEdgeCounting(uint8_t gpioNumber);
+
+        [[nodiscard]]
+        static uint16_t readPWMCounter(uint8_t gpioNumber);
+
         static void setInterrupt(uint8_t gpioNumber, GPIOInterruptTrigger trigger, GPIOInterruptCallback const & callback);
 
         static void enableADC(uint8_t gpioNumber);
@@ -80,7 +115,7 @@ namespace kilight::hw {
         static uint16_t readADC(uint8_t adcChannel);
 
     private:
-        inline static std::array<GPIOInterruptCallback, 30> interrupts {};
+        inline static std::array<GPIOInterruptCallback, NUM_BANK0_GPIOS> interrupts {};
 
         static void interruptWrapper(unsigned int gpio, uint32_t trigger);
     };
@@ -201,6 +236,8 @@ namespace kilight::hw {
         static constexpr uint16_t PWMTop = PWMCount - 1;
 
     public:
+        static constexpr uint8_t PWMSlice = GPIOWrapper::pwmSliceFor(gpioNumber);
+
         static void enablePWM(uint32_t const frequencyHz) {
             GPIOWrapper::enablePWM(gpioNumber, frequencyHz, PWMTop);
         }
@@ -221,21 +258,65 @@ namespace kilight::hw {
 
     template<uint8_t gpioNumber>
     class PWM8Pin : public Pin<gpioNumber, PinFunction::PWM> {
+    public:
         static constexpr uint16_t PWMCount = 256;
+
         static constexpr uint16_t PWMTop = PWMCount - 1;
 
-    public:
+        static constexpr uint8_t PWMSlice = GPIOWrapper::pwmSliceFor(gpioNumber);
+
         static void enablePWM(uint32_t const frequencyHz) {
             GPIOWrapper::enablePWM(gpioNumber, frequencyHz, PWMTop);
         }
 
-        static void writePWM(uint8_t const value) {
+        /**
+         * Sets up the PWM slice but leaves it stopped, ready to be started along with others by
+         * GPIOWrapper::startPWMSlices().
+         *
+         * @param frequencyHz PWM frequency
+         * @param phase Counter value to start from, which shifts this pin's pulses earlier by that many counts
+         */
+        static void configurePWM(uint32_t const frequencyHz, uint16_t const phase) {
+            GPIOWrapper::configurePWM(gpioNumber, frequencyHz, PWMTop, phase);
+        }
+
+        [[nodiscard]]
+        static uint32_t sliceMask() {
+            return GPIOWrapper::pwmSliceMask(gpioNumber);
+        }
+
+        static __force_inline void writePWM(uint8_t const value) {
             GPIOWrapper::writePWM(gpioNumber, value);
         }
 
         PWM8Pin() = delete;
     };
 
+    /**
+     * A PWM slice's B input, counting falling edges on the pin in hardware so nothing has to be done per edge.
+     */
+    template<uint8_t gpioNumber>
+    class PWMCounterPin : public Pin<gpioNumber, PinFunction::PWM> {
+    public:
+        static_assert(gpioNumber % 2 == 1, "Only a PWM slice's B pin can be used as an input");
+
+        static constexpr uint8_t PWMSlice = GPIOWrapper::pwmSliceFor(gpioNumber);
+
+        static void enableEdgeCounting() {
+            GPIOWrapper::enablePWMEdgeCounting(gpioNumber);
+        }
+
+        /**
+         * @return Falling edges counted since counting was enabled, wrapping around at 16 bits
+         */
+        [[nodiscard]]
+        static uint16_t readCount() {
+            return GPIOWrapper::readPWMCounter(gpioNumber);
+        }
+
+        PWMCounterPin() = delete;
+    };
+
     template<uint8_t gpioNumber>
     class UnusedPin : public Pin<gpioNumber, PinFunction::None> {
     public:
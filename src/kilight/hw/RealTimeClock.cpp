@@ -0,0 +1,48 @@
+/**
+ * RealTimeClock.cpp
+ *
+ * @author Patrick Lavigne
+ */
+
+#include "kilight/hw/RealTimeClock.h"
+
+#include <ctime>
+
+#include <pico/aon_timer.h>
+
+namespace kilight::hw {
+    void RealTimeClock::initialize() {
+        if (aon_timer_is_running()) {
+            timeSource = Source::Retained;
+        }
+    }
+
+    void RealTimeClock::setTime(uint64_t const unixSeconds, Source const source) {
+        timespec const time {
+            .tv_sec = static_cast<time_t>(unixSeconds),
+            .tv_nsec = 0
+        };
+        if (aon_timer_is_running()) {
+            aon_timer_set_time(&time);
+        } else {
+            aon_timer_start(&time);
+        }
+        timeSource = source;
+    }
+
+    bool RealTimeClock::valid() {
+        return timeSource != Source::None;
+    }
+
+    uint64_t RealTimeClock::unixTime() {
+        timespec time {};
+        if (!valid() || !aon_timer_get_time(&time)) {
+            return 0;
+        }
+        return static_cast<uint64_t>(time.tv_sec);
+    }
+
+    RealTimeClock::Source RealTimeClock::source() {
+        return timeSource;
+    }
+}
@@ -0,0 +1,49 @@
+/**
+ * RealTimeClock.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace kilight::hw {
+
+    /**
+     * Wall clock time, kept by the RP2350's always-on timer once something has told us what time it is.
+     */
+    class RealTimeClock {
+    public:
+        enum class Source : uint8_t {
+            None,
+            // The always-on timer was already running at boot, so it survived a reset
+            Retained,
+            Client,
+            Network
+        };
+
+        static void initialize();
+
+        static void setTime(uint64_t unixSeconds, Source source);
+
+        [[nodiscard]]
+        static bool valid();
+
+        /**
+         * @return Seconds since the Unix epoch, UTC, or 0 if the time isn't known yet
+         */
+        [[nodiscard]]
+        static uint64_t unixTime();
+
+        [[nodiscard]]
+        static Source source();
+
+        RealTimeClock() = delete;
+        ~RealTimeClock() = delete;
+
+    private:
+        static inline Source volatile timeSource = Source::None;
+    };
+
+}
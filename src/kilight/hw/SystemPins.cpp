@@ -11,22 +11,21 @@
 
 namespace kilight::hw {
 
-    void SystemPins::initPins() {
+    static constexpr uint64_t OutputPWMPinMask = []<size_t... Indices>(std::index_sequence<Indices...>) {
+        return (SystemPins::Output<Indices>::PWMPinMask | ...);
+    }(std::make_index_sequence<SystemPins::OutputCount>{});
 
-        OutputA::Red::initPin();
-        OutputA::Green::initPin();
-        OutputA::Blue::initPin();
-        bi_decl(bi_3pins_with_names(OutputA::Red::Number, "Output A - Red",
-                                    OutputA::Green::Number, "Output A - Green",
-                                    OutputA::Blue::Number, "Output A - Blue"))
+    static constexpr uint32_t OutputCurrentSensePinMask = []<size_t... Indices>(std::index_sequence<Indices...>) {
+        return ((1U << SystemPins::Output<Indices>::CurrentSense::Number) | ...);
+    }(std::make_index_sequence<SystemPins::OutputCount>{});
 
-        OutputA::ColdWhite::initPin();
-        OutputA::WarmWhite::initPin();
-        bi_decl(bi_2pins_with_names(OutputA::ColdWhite::Number, "Output A - Cold White",
-                                    OutputA::WarmWhite::Number, "Output A - Warm White"))
+    void SystemPins::initPins() {
 
-        OutputA::CurrentSense::initPin();
-        bi_decl(bi_1pin_with_name(OutputA::CurrentSense::Number, "Output A - Current Sense"))
+        forEachOutput([]<typename PinGroupT>(uint8_t) {
+            PinGroupT::initPins();
+        });
+        bi_decl(bi_pin_mask_with_name(OutputPWMPinMask, "LED Outputs - PWM"))
+        bi_decl(bi_pin_mask_with_name(OutputCurrentSensePinMask, "LED Outputs - Current Sense"))
 
         FanTacho::initPin();
         FanPWM::initPin();
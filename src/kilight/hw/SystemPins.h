@@ -6,8 +6,15 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cstdint>
+#include <functional>
+#include <tuple>
+#include <utility>
 
+#include "kilight/conf/HardwareConfig.h"
 #include "kilight/hw/Pin.h"
 
 namespace kilight {
@@ -26,6 +33,8 @@ namespace kilight::hw {
     public:
         static constexpr uint32_t PWMFrequency = pwmFrequency;
 
+        static constexpr uint16_t ChannelCount = 5;
+
         using Red = PWM8Pin<redPin>;
 
         using Green = PWM8Pin<greenPin>;
@@ -38,12 +47,56 @@ namespace kilight::hw {
 
         using CurrentSense = ADCPin<adcPin>;
 
-        static void enablePWM() {
-            Red::enablePWM(PWMFrequency);
-            Green::enablePWM(PWMFrequency);
-            Blue::enablePWM(PWMFrequency);
-            ColdWhite::enablePWM(PWMFrequency);
-            WarmWhite::enablePWM(PWMFrequency);
+        // In the same order as colours are laid out everywhere else
+        using PWMChannels = std::tuple<Red, Green, Blue, ColdWhite, WarmWhite>;
+
+        // 64 bits, since the RP2350B has pins from 32 up
+        static constexpr uint64_t PWMPinMask = (1ULL << redPin) | (1ULL << greenPin) | (1ULL << bluePin)
+                                               | (1ULL << cwPin) | (1ULL << wwPin);
+
+        static constexpr uint32_t PWMSliceMask = (1U << Red::PWMSlice) | (1U << Green::PWMSlice)
+                                                 | (1U << Blue::PWMSlice) | (1U << ColdWhite::PWMSlice)
+                                                 | (1U << WarmWhite::PWMSlice);
+
+        static void initPins() {
+            forEachChannel([]<typename PinT>(uint16_t) {
+                PinT::initPin();
+            });
+            CurrentSense::initPin();
+        }
+
+        /**
+         * (Re)starts all five channels together. Staggering them spreads their rising edges a fifth of a period
+         * apart, which lowers the peak current drawn from the supply without changing the average.
+         *
+         * @param phaseMode How to line up the channels' PWM periods
+         */
+        static void enablePWM(PWMPhaseMode const phaseMode = PWMPhaseMode::Aligned) {
+            uint16_t const phaseStep = phaseMode == PWMPhaseMode::Staggered ? Red::PWMCount / ChannelCount : 0;
+            uint32_t sliceMask = 0;
+            forEachChannel([phaseStep, &sliceMask]<typename PinT>(uint16_t const channel) {
+                PinT::configurePWM(PWMFrequency, static_cast<uint16_t>(channel * phaseStep));
+                sliceMask |= PinT::sliceMask();
+            });
+            GPIOWrapper::startPWMSlices(sliceMask);
+        }
+
+        static __force_inline void writePWM(std::array<uint8_t, ChannelCount> const& levels) {
+            writePWM(levels, std::make_index_sequence<ChannelCount>{});
+        }
+
+    private:
+        template <typename FuncT>
+        static void forEachChannel(FuncT&& func) {
+            [&func]<size_t... Channels>(std::index_sequence<Channels...>) {
+                (func.template operator()<std::tuple_element_t<Channels, PWMChannels>>(Channels), ...);
+            }(std::make_index_sequence<ChannelCount>{});
+        }
+
+        template <size_t... Channels>
+        static __force_inline void writePWM(std::array<uint8_t, ChannelCount> const& levels,
+                                            std::index_sequence<Channels...>) {
+            (std::tuple_element_t<Channels, PWMChannels>::writePWM(levels[Channels]), ...);
         }
     };
 
@@ -53,12 +106,155 @@ namespace kilight::hw {
     public:
 
         // region LED Channels
+#if PICO_RP2350A
         using OutputA = ChannelPins<0, 2, 4, 6, 8, 26>;
+
+        // Shares PWM slices with Output A, so the two always share a phase mode too
+        using OutputB = ChannelPins<1, 3, 5, 7, 9, 27>;
+
+        // Pin groups for every output the board could have, in output order. The RP2350A only has pins and ADC
+        // inputs to spare for two.
+        using AllOutputs = std::tuple<OutputA, OutputB>;
+#else
+        // The RP2350B's ADC inputs are on pins 40 to 47 instead of 26 to 29
+        using OutputA = ChannelPins<0, 2, 4, 6, 8, 40>;
+
+        // Shares PWM slices with Output A, so the two always share a phase mode too
+        using OutputB = ChannelPins<1, 3, 5, 7, 9, 41>;
+
+        // Slices 7 to 11, on the RP2350B's extra pins
+        using OutputC = ChannelPins<30, 32, 34, 36, 38, 42>;
+
+        // Shares PWM slices with Output C
+        using OutputD = ChannelPins<31, 33, 35, 37, 39, 43>;
+
+        // Pin groups for every output the board could have, in output order
+        using AllOutputs = std::tuple<OutputA, OutputB, OutputC, OutputD>;
+#endif
+
+        static constexpr uint8_t OutputCount = conf::HardwareConfig::OutputCount;
+
+        static_assert(OutputCount <= std::tuple_size_v<AllOutputs>,
+                      "Not enough output pin groups for this board, more than two outputs need the RP2350B");
+
+        template <uint8_t OutputIndex>
+        using Output = std::tuple_element_t<OutputIndex, AllOutputs>;
+
+        /**
+         * Calls func.operator()<PinGroupT>(outputIndex) once for every output on the board.
+         */
+        template <typename FuncT>
+        static __force_inline void forEachOutput(FuncT&& func) {
+            forEachOutput(std::forward<FuncT>(func), std::make_index_sequence<OutputCount>{});
+        }
+
+        /**
+         * Calls func.operator()<PinGroupT>(outputIndex) for the output at a run-time index, which must be valid.
+         */
+        template <typename FuncT>
+        static __force_inline void withOutput(uint8_t const outputIndex, FuncT&& func) {
+            withOutput(outputIndex, std::forward<FuncT>(func), std::make_index_sequence<OutputCount>{});
+        }
+
+        // Mask of the ADC channels sensing each output's current, which the ADC samples in ascending order
+        static constexpr uint32_t CurrentSenseADCMask = []<size_t... Indices>(std::index_sequence<Indices...>) {
+            return ((1U << Output<Indices>::CurrentSense::ADCChannel) | ...);
+        }(std::make_index_sequence<OutputCount>{});
+
+        static_assert([]<size_t... Indices>(std::index_sequence<Indices...>) {
+                          std::array<uint8_t, OutputCount> const channels {Output<Indices>::CurrentSense::ADCChannel...};
+                          return std::adjacent_find(channels.begin(), channels.end(), std::greater_equal<>{})
+                              == channels.end();
+                      }(std::make_index_sequence<OutputCount>{}),
+                      "Output current sense ADC channels must be in the same order as the outputs");
+
+        static constexpr uint32_t OutputPWMSliceMask = []<size_t... Indices>(std::index_sequence<Indices...>) {
+            return (Output<Indices>::PWMSliceMask | ...);
+        }(std::make_index_sequence<OutputCount>{});
+
+        static_assert([]<size_t... Indices>(std::index_sequence<Indices...>) {
+                          std::array<uint32_t, OutputCount> const masks {Output<Indices>::PWMSliceMask...};
+                          return std::ranges::all_of(masks, [&masks](uint32_t const mask) {
+                              return std::ranges::all_of(masks, [mask](uint32_t const other) {
+                                  return other == mask || (other & mask) == 0;
+                              });
+                          });
+                      }(std::make_index_sequence<OutputCount>{}),
+                      "Outputs that share a PWM slice have to share all of them, or their phase modes can't be kept "
+                      "apart");
+
+        // The first output on the same PWM slices as each output. Outputs with the same one run off the same
+        // counters, so they can only ever have the same phase mode.
+        static constexpr std::array<uint8_t, OutputCount> PWMGroups = []<size_t... Indices>(
+            std::index_sequence<Indices...>) {
+            std::array<uint32_t, OutputCount> const masks {Output<Indices>::PWMSliceMask...};
+            std::array<uint8_t, OutputCount> groups {};
+            for (uint8_t index = 0; index < OutputCount; ++index) {
+                groups[index] = static_cast<uint8_t>(
+                    std::ranges::find_if(masks, [&masks, index](uint32_t const mask) {
+                        return (mask & masks[index]) != 0;
+                    }) - masks.begin());
+            }
+            return groups;
+        }(std::make_index_sequence<OutputCount>{});
+
+        [[nodiscard]]
+        static constexpr bool sharePWMSlices(uint8_t const first, uint8_t const second) {
+            return PWMGroups[first] == PWMGroups[second];
+        }
+
+        /**
+         * (Re)starts the PWM of the output and every other output on the same slices, all with the same phase mode.
+         *
+         * @param outputIndex Output whose phase mode is being set
+         * @param phaseMode How to line up the channels' PWM periods
+         */
+        static void enablePWM(uint8_t const outputIndex, PWMPhaseMode const phaseMode) {
+            forEachOutput([outputIndex, phaseMode]<typename PinGroupT>(uint8_t const index) {
+                if (sharePWMSlices(index, outputIndex)) {
+                    PinGroupT::enablePWM(phaseMode);
+                    pwmPhaseModes[index] = phaseMode;
+                }
+            });
+        }
+
+        /**
+         * @return The phase mode the output's PWM was last started with, which may have been set through another
+         *         output on the same slices
+         */
+        [[nodiscard]]
+        static PWMPhaseMode pwmPhaseMode(uint8_t const outputIndex) {
+            return pwmPhaseModes[outputIndex];
+        }
         // endregion
 
         // region Fan
-        using FanTacho = GPIOPin<11>;
+        // Counted by its PWM slice (slice 5, which has no other pins in use)
+        using FanTacho = PWMCounterPin<11>;
         using FanPWM = PWMPin<12>;
+
+        static_assert(((1U << FanTacho::PWMSlice) & OutputPWMSliceMask) == 0
+                      && ((1U << FanPWM::PWMSlice) & OutputPWMSliceMask) == 0,
+                      "The fan needs PWM slices of its own");
+        // endregion
+
+        // region ADC Pacing
+        // Highest slice nothing else uses, which paces PWM-synchronous current sampling. On the RP2350A, slices 8 and
+        // up have no pins at all.
+        static constexpr uint32_t UsedPWMSliceMask = OutputPWMSliceMask
+                                                     | (1U << FanTacho::PWMSlice)
+                                                     | (1U << FanPWM::PWMSlice);
+
+        static constexpr bool HasADCPacingPWMSlice = UsedPWMSliceMask != (1U << NUM_PWM_SLICES) - 1;
+
+        static constexpr uint8_t ADCPacingPWMSlice = HasADCPacingPWMSlice
+                                                         ? static_cast<uint8_t>(31 - std::countl_zero(
+                                                             ~UsedPWMSliceMask & ((1U << NUM_PWM_SLICES) - 1)))
+                                                         : 0;
+
+        static_assert(HasADCPacingPWMSlice || !KILIGHT_ADC_PWM_SYNCHRONOUS,
+                      "Every PWM slice is in use, so there's none left to pace PWM-synchronous current sampling. Set "
+                      "KILIGHT_ADC_PWM_SYNCHRONOUS to 0 for this board.");
         // endregion
 
         // region Button
@@ -81,6 +277,7 @@ namespace kilight::hw {
         // endregion
 
         // region Unused Pins
+        // 1, 3, 5, 7, 9 and 27 are Output B's pins on boards that have it
         using UnusedPinA = UnusedPin<1>;
         using UnusedPinB = UnusedPin<3>;
         using UnusedPinC = UnusedPin<5>;
@@ -99,6 +296,21 @@ namespace kilight::hw {
         ~SystemPins() = delete;
 
     private:
+        static inline std::array<PWMPhaseMode, OutputCount> pwmPhaseModes {};
+
         static void initPins();
+
+        template <typename FuncT, size_t... Indices>
+        static __force_inline void forEachOutput(FuncT&& func, std::index_sequence<Indices...>) {
+            (func.template operator()<Output<Indices>>(static_cast<uint8_t>(Indices)), ...);
+        }
+
+        template <typename FuncT, size_t... Indices>
+        static __force_inline void withOutput(uint8_t const outputIndex, FuncT&& func, std::index_sequence<Indices...>) {
+            // Folds into the same compare-and-branch chain a switch would
+            static_cast<void>(((outputIndex == Indices
+                                    ? (func.template operator()<Output<Indices>>(outputIndex), true)
+                                    : false) || ...));
+        }
     };
 }
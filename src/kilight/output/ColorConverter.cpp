@@ -0,0 +1,171 @@
+/**
+ * ColorConverter.cpp
+ *
+ * @author Patrick Lavigne
+ */
+
+#include "kilight/output/ColorConverter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace kilight::output {
+
+    ColorConverter::ColorConverter() :
+        ColorConverter(fixture_calibration_t{}) {
+    }
+
+    ColorConverter::ColorConverter(fixture_calibration_t const& calibration) {
+        setCalibration(calibration);
+    }
+
+    void ColorConverter::setCalibration(fixture_calibration_t const& calibration) {
+        fixture_calibration_t const& usable = calibration.valid() ? calibration : fixture_calibration_t{};
+
+        constexpr auto scale = static_cast<float>(ChromaticityScale);
+        std::array<vector3_t, 3> const primaries {
+            xyzFromXY(usable.redX / scale, usable.redY / scale, usable.redLumens),
+            xyzFromXY(usable.greenX / scale, usable.greenY / scale, usable.greenLumens),
+            xyzFromXY(usable.blueX / scale, usable.blueY / scale, usable.blueLumens)
+        };
+
+        // Each primary is a column of the duty -> XYZ matrix, so work out its inverse by cofactors
+        auto const at = [&primaries](size_t const row, size_t const column) {
+            return primaries[column][row];
+        };
+        matrix3_t cofactors {};
+        for (size_t row = 0; row < 3; ++row) {
+            for (size_t column = 0; column < 3; ++column) {
+                size_t const row1 = (row + 1) % 3;
+                size_t const row2 = (row + 2) % 3;
+                size_t const column1 = (column + 1) % 3;
+                size_t const column2 = (column + 2) % 3;
+                cofactors[row][column] = at(row1, column1) * at(row2, column2) - at(row1, column2) * at(row2, column1);
+            }
+        }
+        float const determinant = at(0, 0) * cofactors[0][0] + at(0, 1) * cofactors[0][1] + at(0, 2) * cofactors[0][2];
+        if (std::fabs(determinant) < 1e-6f) {
+            // Primaries on a straight line can't make every colour between them, fall back to something sane
+            setCalibration(fixture_calibration_t{});
+            return;
+        }
+        for (size_t row = 0; row < 3; ++row) {
+            for (size_t column = 0; column < 3; ++column) {
+                m_xyzToDuty[row][column] = cofactors[column][row] / determinant;
+            }
+        }
+
+        m_coldWhiteKelvin = usable.coldWhiteKelvin;
+        m_warmWhiteKelvin = usable.warmWhiteKelvin;
+        m_coldWhiteXY = planckianXY(m_coldWhiteKelvin);
+        m_warmWhiteXY = planckianXY(m_warmWhiteKelvin);
+        vector3_t const coldWhite = xyzFromXY(m_coldWhiteXY[0], m_coldWhiteXY[1], usable.coldWhiteLumens);
+        vector3_t const warmWhite = xyzFromXY(m_warmWhiteXY[0], m_warmWhiteXY[1], usable.warmWhiteLumens);
+        m_coldWhiteXYZSum = coldWhite[0] + coldWhite[1] + coldWhite[2];
+        m_warmWhiteXYZSum = warmWhite[0] + warmWhite[1] + warmWhite[2];
+        m_coldWhiteAsRGB = dutiesFromXYZ(coldWhite);
+        m_warmWhiteAsRGB = dutiesFromXYZ(warmWhite);
+    }
+
+    rgbcw_color_t ColorConverter::fromColorTemperature(uint32_t const kelvin) const {
+        auto const [x, y] = planckianXY(std::clamp(static_cast<float>(kelvin), m_warmWhiteKelvin, m_coldWhiteKelvin));
+        float const warmShare = warmWhiteShare(x, y);
+        return normalisedColor({0.0f, 0.0f, 0.0f, 1.0f - warmShare, warmShare});
+    }
+
+    rgbcw_color_t ColorConverter::fromXY(float const x, float const y) const {
+        if (!validXY(x, y)) {
+            return {};
+        }
+
+        vector3_t duties = dutiesFromXYZ(xyzFromXY(x, y, 1.0f));
+        for (float& duty : duties) {
+            duty = std::max(duty, 0.0f);
+        }
+
+        // Blend the white channels as close to the requested colour as they can get, then take as much of that blend
+        // as fits inside the colour before red, green and blue make up the rest
+        float const warmShare = warmWhiteShare(x, y);
+        float whiteAmount = INFINITY;
+        vector3_t whiteAsRGB {};
+        for (size_t channel = 0; channel < 3; ++channel) {
+            whiteAsRGB[channel] = (1.0f - warmShare) * m_coldWhiteAsRGB[channel] + warmShare * m_warmWhiteAsRGB[channel];
+            if (whiteAsRGB[channel] > 0.0f) {
+                whiteAmount = std::min(whiteAmount, duties[channel] / whiteAsRGB[channel]);
+            }
+        }
+        if (!std::isfinite(whiteAmount)) {
+            whiteAmount = 0.0f;
+        }
+        for (size_t channel = 0; channel < 3; ++channel) {
+            duties[channel] = std::max(duties[channel] - whiteAmount * whiteAsRGB[channel], 0.0f);
+        }
+
+        return normalisedColor({
+            duties[0],
+            duties[1],
+            duties[2],
+            whiteAmount * (1.0f - warmShare),
+            whiteAmount * warmShare
+        });
+    }
+
+    ColorConverter::vector3_t ColorConverter::xyzFromXY(float const x, float const y, float const luminance) {
+        return {x / y * luminance, luminance, (1.0f - x - y) / y * luminance};
+    }
+
+    ColorConverter::vector2_t ColorConverter::planckianXY(float const kelvin) {
+        // Kim et al. cubic spline fit of the Planckian locus
+        float const t = std::clamp(kelvin, PlanckianMinKelvin, PlanckianMaxKelvin);
+        float const t2 = t * t;
+        float const t3 = t2 * t;
+        float const x = t <= 4000.0f
+                            ? -0.2661239e9f / t3 - 0.2343589e6f / t2 + 0.8776956e3f / t + 0.179910f
+                            : -3.0258469e9f / t3 + 2.1070379e6f / t2 + 0.2226347e3f / t + 0.240390f;
+        float const x2 = x * x;
+        float const x3 = x2 * x;
+        float y;
+        if (t <= 2222.0f) {
+            y = -1.1063814f * x3 - 1.34811020f * x2 + 2.18555832f * x - 0.20219683f;
+        } else if (t <= 4000.0f) {
+            y = -0.9549476f * x3 - 1.37418593f * x2 + 2.09137015f * x - 0.16748867f;
+        } else {
+            y = 3.0817580f * x3 - 5.87338670f * x2 + 3.75112997f * x - 0.37001483f;
+        }
+        return {x, y};
+    }
+
+    rgbcw_color_t ColorConverter::normalisedColor(std::array<float, 5> const& duties) {
+        float const brightest = *std::ranges::max_element(duties);
+        if (!(brightest > 0.0f)) {
+            return {};
+        }
+        float const scale = static_cast<float>(UINT8_MAX) / brightest;
+        auto const toDuty = [scale](float const duty) {
+            return static_cast<uint8_t>(std::clamp(std::lround(duty * scale), 0L, static_cast<long>(UINT8_MAX)));
+        };
+        return {toDuty(duties[0]), toDuty(duties[1]), toDuty(duties[2]), toDuty(duties[3]), toDuty(duties[4])};
+    }
+
+    ColorConverter::vector3_t ColorConverter::dutiesFromXYZ(vector3_t const& xyz) const {
+        vector3_t duties {};
+        for (size_t row = 0; row < 3; ++row) {
+            duties[row] = m_xyzToDuty[row][0] * xyz[0] + m_xyzToDuty[row][1] * xyz[1] + m_xyzToDuty[row][2] * xyz[2];
+        }
+        return duties;
+    }
+
+    float ColorConverter::warmWhiteShare(float const x, float const y) const {
+        // Any mix of the two whites lies on the line between their chromaticities. Find the closest point on it,
+        // as a share of the mix's X+Y+Z coming from the warm white, then turn that into a share of duty.
+        float const lineX = m_warmWhiteXY[0] - m_coldWhiteXY[0];
+        float const lineY = m_warmWhiteXY[1] - m_coldWhiteXY[1];
+        float const position = std::clamp(((x - m_coldWhiteXY[0]) * lineX + (y - m_coldWhiteXY[1]) * lineY)
+                                          / (lineX * lineX + lineY * lineY),
+                                          0.0f,
+                                          1.0f);
+        float const warmDuty = position / m_warmWhiteXYZSum;
+        float const coldDuty = (1.0f - position) / m_coldWhiteXYZSum;
+        return warmDuty / (warmDuty + coldDuty);
+    }
+}
@@ -0,0 +1,153 @@
+/**
+ * ColorConverter.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "kilight/output/output_config.h"
+#include "kilight/output/rgbcw_color.h"
+#include "kilight/util/MathUtil.h"
+
+namespace kilight::output {
+
+    class ColorConverter final {
+    public:
+        ColorConverter();
+
+        explicit ColorConverter(fixture_calibration_t const& calibration);
+
+        /**
+         * Recalculates everything derived from the calibration, so the conversions themselves only need a handful
+         * of multiplies. An invalid calibration is replaced by the default one.
+         */
+        void setCalibration(fixture_calibration_t const& calibration);
+
+        /**
+         * Mixes the two white channels to get as close as they can to a colour temperature. Temperatures outside
+         * the range of the white channels are clamped to it.
+         *
+         * @param kelvin Colour temperature to mix
+         * @return The mix, normalised so the brightest channel is at full duty
+         */
+        [[nodiscard]]
+        rgbcw_color_t fromColorTemperature(uint32_t kelvin) const;
+
+        /**
+         * Converts a CIE 1931 xy chromaticity to channel duties. As much of the colour as possible comes from the
+         * white channels (mixed to the nearest colour temperature), and the remainder from red, green and blue.
+         * Colours outside the fixture's gamut are clipped.
+         *
+         * @param x CIE x coordinate
+         * @param y CIE y coordinate
+         * @return The duties, normalised so the brightest channel is at full duty
+         */
+        [[nodiscard]]
+        rgbcw_color_t fromXY(float x, float y) const;
+
+        /**
+         * @return true if the coordinates are a chromaticity fromXY() can convert, which also rules out NaN
+         */
+        [[nodiscard]]
+        static constexpr bool validXY(float const x, float const y) {
+            return y > 0.0f && x >= 0.0f && x + y <= 1.0f;
+        }
+
+        /**
+         * Converts hue/saturation/value to red, green and blue duties.
+         *
+         * @param hue Hue in degrees, wrapped to 0-359
+         * @param saturation 0 for grey through 255 for a fully saturated colour
+         * @param value Brightness of the brightest channel
+         * @return The duties, with the white channels off
+         */
+        [[nodiscard]]
+        static constexpr rgbcw_color_t fromHSV(uint32_t const hue, uint8_t const saturation, uint8_t const value) {
+            uint32_t const wrappedHue = hue % 360;
+            // How far through the current 60 degree sector the hue is, from 0 to 255
+            uint32_t const position = (wrappedHue % 60) * UINT8_MAX / 59;
+            auto const bottom = static_cast<uint8_t>(
+                util::MathUtil::divideBy255Rounded(value * (UINT8_MAX - saturation)));
+            auto const falling = static_cast<uint8_t>(util::MathUtil::divideBy255Rounded(
+                value * (UINT8_MAX - util::MathUtil::divideBy255Rounded(saturation * position))));
+            auto const rising = static_cast<uint8_t>(util::MathUtil::divideBy255Rounded(
+                value * (UINT8_MAX - util::MathUtil::divideBy255Rounded(saturation * (UINT8_MAX - position)))));
+
+            switch (wrappedHue / 60) {
+            case 0:
+                return {value, rising, bottom, 0, 0};
+            case 1:
+                return {falling, value, bottom, 0, 0};
+            case 2:
+                return {bottom, value, rising, 0, 0};
+            case 3:
+                return {bottom, falling, value, 0, 0};
+            case 4:
+                return {rising, bottom, value, 0, 0};
+            default:
+                return {value, bottom, falling, 0, 0};
+            }
+        }
+
+    private:
+        // Range of the Planckian locus fit used to place colour temperatures
+        static constexpr float PlanckianMinKelvin = 1667.0f;
+
+        static constexpr float PlanckianMaxKelvin = 25000.0f;
+
+        static_assert(MinWhiteKelvin >= PlanckianMinKelvin && MaxWhiteKelvin <= PlanckianMaxKelvin,
+                      "Calibrated white points have to be inside the range colour temperatures can be placed in");
+
+        using vector2_t = std::array<float, 2>;
+
+        using vector3_t = std::array<float, 3>;
+
+        using matrix3_t = std::array<vector3_t, 3>;
+
+        [[nodiscard]]
+        static vector3_t xyzFromXY(float x, float y, float luminance);
+
+        [[nodiscard]]
+        static vector2_t planckianXY(float kelvin);
+
+        [[nodiscard]]
+        static rgbcw_color_t normalisedColor(std::array<float, 5> const& duties);
+
+        [[nodiscard]]
+        vector3_t dutiesFromXYZ(vector3_t const& xyz) const;
+
+        [[nodiscard]]
+        float warmWhiteShare(float x, float y) const;
+
+        float m_coldWhiteKelvin = 0.0f;
+
+        float m_warmWhiteKelvin = 0.0f;
+
+        vector2_t m_coldWhiteXY {};
+
+        vector2_t m_warmWhiteXY {};
+
+        // X+Y+Z of each white channel at full duty, which is what chromaticities mix in proportion to
+        float m_coldWhiteXYZSum = 0.0f;
+
+        float m_warmWhiteXYZSum = 0.0f;
+
+        // Inverse of the matrix made of the red, green and blue channels' XYZ at full duty
+        matrix3_t m_xyzToDuty {};
+
+        // How much red, green and blue it would take to match each white channel at full duty
+        vector3_t m_coldWhiteAsRGB {};
+
+        vector3_t m_warmWhiteAsRGB {};
+    };
+
+    static_assert(ColorConverter::fromHSV(0, 255, 255) == rgbcw_color_t{255, 0, 0, 0, 0});
+    static_assert(ColorConverter::fromHSV(120, 255, 255) == rgbcw_color_t{0, 255, 0, 0, 0});
+    static_assert(ColorConverter::fromHSV(240, 255, 128) == rgbcw_color_t{0, 0, 128, 0, 0});
+    static_assert(ColorConverter::fromHSV(60, 255, 255) == rgbcw_color_t{255, 255, 0, 0, 0});
+    static_assert(ColorConverter::fromHSV(200, 0, 77) == rgbcw_color_t{77, 77, 77, 0, 0});
+}
@@ -0,0 +1,100 @@
+/**
+ * EffectPlayer.cpp
+ *
+ * @author Patrick Lavigne
+ */
+
+#include "kilight/output/EffectPlayer.h"
+
+#include <algorithm>
+
+#include <pico/platform.h>
+
+#include "kilight/util/MathUtil.h"
+
+using kilight::util::MathUtil;
+
+namespace kilight::output {
+
+    // Effects are played by the render engine on core 1, so everything here has to run from RAM
+
+    void __not_in_flash_func(EffectPlayer::start)(effect_program_t const& program,
+                                                  uint8_t const slot,
+                                                  rgbcw_color_t const& startColor,
+                                                  uint32_t const seed) {
+        m_program = program;
+        m_slot = slot;
+        m_randomState = seed != 0 ? seed : 1;
+        m_from = startColor;
+        m_to = startColor;
+        m_keyframeIndex = 0;
+        m_loopsCompleted = 0;
+        m_segmentElapsedMs = 0;
+        if (m_program.empty()) {
+            m_running = false;
+            return;
+        }
+        beginKeyframe();
+        m_running = true;
+    }
+
+    void __not_in_flash_func(EffectPlayer::stop)() {
+        m_running = false;
+    }
+
+    bool __not_in_flash_func(EffectPlayer::running)() const {
+        return m_running;
+    }
+
+    uint8_t __not_in_flash_func(EffectPlayer::slot)() const {
+        return m_slot;
+    }
+
+    rgbcw_color_t __not_in_flash_func(EffectPlayer::advance)(uint32_t const elapsedMs) {
+        if (!m_running) {
+            return m_to;
+        }
+
+        m_segmentElapsedMs += elapsedMs;
+        // Segments are at least 1ms long, so this always terminates even for programs made of 0ms keyframes
+        while (m_segmentElapsedMs >= m_segmentDurationMs) {
+            m_segmentElapsedMs -= m_segmentDurationMs;
+            m_from = m_to;
+            if (!beginNextKeyframe()) {
+                m_running = false;
+                return m_to;
+            }
+        }
+
+        return m_from.interpolatedTowards(m_to, m_segmentElapsedMs, m_segmentDurationMs);
+    }
+
+    void __not_in_flash_func(EffectPlayer::beginKeyframe)() {
+        effect_keyframe_t const& keyframe = m_program.keyframes[m_keyframeIndex];
+        auto const dimming = static_cast<uint8_t>(nextRandom(keyframe.brightnessJitter));
+        m_to = keyframe.color.scaledBy(static_cast<uint8_t>(UINT8_MAX - dimming));
+        m_segmentDurationMs = std::max<uint32_t>(keyframe.durationMs + nextRandom(keyframe.durationJitterMs), 1);
+    }
+
+    bool __not_in_flash_func(EffectPlayer::beginNextKeyframe)() {
+        ++m_keyframeIndex;
+        if (m_keyframeIndex >= m_program.keyframeCount) {
+            m_keyframeIndex = 0;
+            if (m_program.loopCount != 0) {
+                ++m_loopsCompleted;
+                if (m_loopsCompleted >= m_program.loopCount) {
+                    return false;
+                }
+            }
+        }
+        beginKeyframe();
+        return true;
+    }
+
+    uint32_t __not_in_flash_func(EffectPlayer::nextRandom)(uint32_t const maxValue) {
+        if (maxValue == 0) {
+            return 0;
+        }
+        return MathUtil::xorshift32(m_randomState) % (maxValue + 1);
+    }
+}
@@ -0,0 +1,61 @@
+/**
+ * EffectPlayer.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "kilight/output/effect_data.h"
+#include "kilight/output/rgbcw_color.h"
+
+namespace kilight::output {
+
+    class EffectPlayer {
+    public:
+        EffectPlayer() = default;
+
+        void start(effect_program_t const& program, uint8_t slot, rgbcw_color_t const& startColor, uint32_t seed);
+
+        void stop();
+
+        [[nodiscard]]
+        bool running() const;
+
+        [[nodiscard]]
+        uint8_t slot() const;
+
+        rgbcw_color_t advance(uint32_t elapsedMs);
+
+    private:
+        effect_program_t m_program {};
+
+        rgbcw_color_t m_from {};
+
+        rgbcw_color_t m_to {};
+
+        uint32_t m_segmentElapsedMs = 0;
+
+        uint32_t m_segmentDurationMs = 1;
+
+        uint32_t m_randomState = 1;
+
+        uint8_t m_slot = 0;
+
+        uint8_t m_keyframeIndex = 0;
+
+        uint8_t m_loopsCompleted = 0;
+
+        bool volatile m_running = false;
+
+        void beginKeyframe();
+
+        [[nodiscard]]
+        bool beginNextKeyframe();
+
+        uint32_t nextRandom(uint32_t maxValue);
+    };
+
+}
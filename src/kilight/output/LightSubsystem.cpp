@@ -6,19 +6,34 @@
 
 #include "kilight/output/LightSubsystem.h"
 
+#include <algorithm>
 #include <cassert>
+#include <optional>
 
+#include <hardware/timer.h>
+
+#include "kilight/hw/ADC.h"
+#include "kilight/hw/OverCurrentGuard.h"
 #include "kilight/hw/SystemPins.h"
 
 using mpf::core::SubsystemList;
 
+using kilight::hw::ADC;
+using kilight::hw::OverCurrentGuard;
 using kilight::hw::SystemPins;
+using kilight::hw::PWMPhaseMode;
 using kilight::com::WifiSubsystem;
+using kilight::com::stream_frame_t;
+using kilight::core::Alarm;
 using kilight::storage::StorageSubsystem;
 using kilight::storage::save_data_t;
 using kilight::protocol::CommandResult;
 using kilight::protocol::OutputState;
 using kilight::protocol::WriteOutput;
+using kilight::protocol::EffectCommand;
+using kilight::protocol::ConfigureOutput;
+using kilight::protocol::PresetCommand;
+using kilight::protocol::TransitionCommand;
 using kilight::protocol::OutputIdentifier;
 
 namespace kilight::output {
@@ -33,73 +48,196 @@ namespace kilight::output {
     }
 
     void LightSubsystem::initialize() {
-        SystemPins::OutputA::enablePWM();
-        #ifdef KILIGHT_HAS_OUTPUT_B
-        SystemPins::OutputB::enablePWM();
-        #endif
+        // Outputs sharing PWM slices share a phase mode, and the first of them decides it if their saved ones differ
+        for (uint8_t index = 0; index < SystemPins::OutputCount; ++index) {
+            if (SystemPins::PWMGroups[index] == index) {
+                SystemPins::enablePWM(index, StorageSubsystem::saveData().outputConfigs[index].pwmPhaseMode);
+            }
+        }
     }
 
     void LightSubsystem::setUp() {
-        m_outputA.pending = StorageSubsystem::saveData().outputA;
-        #ifdef KILIGHT_HAS_OUTPUT_B
-        m_outputB.pending = StorageSubsystem::saveData().outputB;
-        #endif
+        for (output_state_t& output : m_outputs) {
+            output.pending = StorageSubsystem::saveData().outputs[output.index];
+            output.converter.setCalibration(StorageSubsystem::saveData().outputConfigs[output.index].calibration);
+            PWMPhaseMode const phaseMode = SystemPins::pwmPhaseMode(output.index);
+            if (StorageSubsystem::saveData().outputConfigs[output.index].pwmPhaseMode != phaseMode) {
+                WARN("Output {} shares PWM slices with output {}, so it takes that output's phase mode",
+                     output.index,
+                     SystemPins::PWMGroups[output.index]);
+                m_storage->updatePendingOutputConfig(output.index, [phaseMode](output_config_t& saveConfig) {
+                    saveConfig.pwmPhaseMode = phaseMode;
+                });
+            }
+        }
 
         m_wifi->setWriteRequestCallback([this](WriteOutput const& writeRequest) {
             CommandResult response;
-            switch (writeRequest.get_outputId()) {
-            case OutputIdentifier::OutputA:
-                m_outputA = writeRequest;
-                response.set_result(CommandResult::Result::OK);
-                break;
-
-            #ifdef KILIGHT_HAS_OUTPUT_B
-            case OutputIdentifier::OutputB:
-                m_outputB = writeRequest;
-                response.set_result(CommandResult::Result::OK);
-                break;
-            #endif
-
-            default:
+            output_state_t* const output = outputFor(writeRequest.get_outputId());
+            if (output == nullptr) {
                 response.set_result(CommandResult::Result::Error);
+                return response;
             }
+            if (writeRequest.get_which_colorInput() == WriteOutput::FieldNumber::XY
+                && !ColorConverter::validXY(writeRequest.xy().x(), writeRequest.xy().y())) {
+                WARN("Rejected invalid xy chromaticity");
+                response.set_result(CommandResult::Result::Error);
+                return response;
+            }
+            *output = writeRequest;
+            // A direct write takes over from whatever effect was playing
+            stopPlayback(*output);
+            response.set_result(CommandResult::Result::OK);
             return response;
         });
+
+        m_wifi->setEffectCommandCallback([this](EffectCommand const& effectCommand) {
+            return processEffectCommand(effectCommand);
+        });
+
+        m_wifi->setConfigureOutputCallback([this](ConfigureOutput const& configureOutput) {
+            return processConfigureOutput(configureOutput);
+        });
+
+        m_wifi->setPresetCommandCallback([this](PresetCommand const& presetCommand) {
+            return processPresetCommand(presetCommand);
+        });
+
+        m_wifi->setTransitionCommandCallback([this](TransitionCommand const& transitionCommand) {
+            return processTransitionCommand(transitionCommand);
+        });
+
+        m_wifi->setRecallPresetCallback([this](uint32_t const& slot) {
+            return recallPreset(slot);
+        });
+
+        m_renderEngine.launch();
+        INFO("Render engine started on core 1");
+
+        m_statusAlarm.setTimeout(RenderStatusPollMs,
+                                 [this](Alarm const&) {
+                                     m_statusPollPending = true;
+                                 });
     }
 
     bool LightSubsystem::hasWork() const {
-        #ifdef KILIGHT_HAS_OUTPUT_B
-        return m_outputA.live != m_outputA.pending || m_outputB.live != m_outputB.pending;
-        #else
-        return m_outputA.live != m_outputA.pending;
-        #endif
+        return m_targetSyncPending
+            || m_statusPollPending
+            || std::ranges::any_of(m_outputs,
+                                   [](output_state_t const& output) {
+                                       return output.live != output.pending;
+                                   });
     }
 
     void LightSubsystem::work() {
         TRACE("Light data syncing");
         if (updateLiveOutputs()) {
-            m_outputA.calculateTargetOutput(*this);
-            #ifdef KILIGHT_HAS_OUTPUT_B
-            m_outputB.calculateTargetOutput(*this);
-            #endif
-            startFadeAlarm();
+            for (output_state_t const& output : m_outputs) {
+                onOutputChange(output);
+            }
+            m_targetSyncPending = true;
+        }
+
+        if (m_targetSyncPending) {
+            syncTargets();
+        }
+
+        if (m_statusPollPending) {
+            render_status_t const status = m_renderEngine.status();
+            for (output_state_t& output : m_outputs) {
+                publishRenderState(output, status.outputs[output.index]);
+            }
+            m_statusPollPending = false;
+            m_statusAlarm.setTimeout(RenderStatusPollMs,
+                                     [this](Alarm const&) {
+                                         m_statusPollPending = true;
+                                     });
+        }
+    }
+
+    void LightSubsystem::powerOffOutput(uint8_t const outputIndex) {
+        if (outputIndex < m_outputs.size()) {
+            m_outputs[outputIndex].pending.powerOn = false;
+        }
+    }
+
+    void LightSubsystem::powerOffAllOutputs() {
+        for (output_state_t& output : m_outputs) {
+            output.pending.powerOn = false;
+        }
+    }
+
+    void LightSubsystem::setOutputLimit(uint8_t const outputIndex, uint8_t const limit) {
+        if (outputIndex >= m_outputs.size() || m_outputs[outputIndex].limit == limit) {
+            return;
+        }
+        m_outputs[outputIndex].limit = limit;
+        m_targetSyncPending = true;
+    }
+
+    void LightSubsystem::setThermalDerate(uint8_t const derate) {
+        if (m_thermalDerate == derate) {
+            return;
+        }
+        m_thermalDerate = derate;
+        m_targetSyncPending = true;
+    }
+
+    void LightSubsystem::transitionOutput(uint8_t const outputIndex,
+                                          uint16_t const kelvin,
+                                          uint8_t const brightness,
+                                          bool const powerOn,
+                                          uint32_t const fadeMs) {
+        if (outputIndex >= m_outputs.size()) {
+            return;
+        }
+        output_state_t& output = m_outputs[outputIndex];
+        if (kelvin != 0) {
+            output.pending.color = output.converter.fromColorTemperature(kelvin);
         }
+        output.pending.brightnessMultiplier = brightness;
+        output.pending.powerOn = powerOn;
+        output.fadeMs = fadeMs;
+        stopPlayback(output);
     }
 
-    void LightSubsystem::powerOffOutputA() {
-        m_outputA.pending.powerOn = false;
+    bool LightSubsystem::submitStreamFrame(stream_frame_t const& frame) {
+        return m_renderEngine.submitFrame(frame);
     }
 
-    #ifdef KILIGHT_HAS_OUTPUT_B
-    void LightSubsystem::powerOffOutputB() {
-        m_outputB.pending.powerOn = false;
+    render_status_t LightSubsystem::renderStatus() const {
+        return m_renderEngine.status();
     }
-    #endif
 
     LightSubsystem::output_state_t& LightSubsystem::output_state_t::operator=(WriteOutput const& protocolWrite) {
-        pending.color = protocolWrite.color();
+        switch (protocolWrite.get_which_colorInput()) {
+            using enum WriteOutput::FieldNumber;
+        case COLOR:
+            pending.color = protocolWrite.color();
+            break;
+
+        case COLORTEMPERATURE:
+            pending.color = converter.fromColorTemperature(protocolWrite.colorTemperature().kelvin());
+            break;
+
+        case HSV:
+            pending.color = ColorConverter::fromHSV(
+                protocolWrite.hsv().hue(),
+                static_cast<uint8_t>(std::min<uint32_t>(protocolWrite.hsv().saturation(), UINT8_MAX)),
+                static_cast<uint8_t>(std::min<uint32_t>(protocolWrite.hsv().value(), UINT8_MAX)));
+            break;
+
+        case XY:
+            pending.color = converter.fromXY(protocolWrite.xy().x(), protocolWrite.xy().y());
+            break;
+
+        default:
+            // No colour given, so only the brightness and power state change
+            break;
+        }
         pending.brightnessMultiplier = static_cast<uint8_t>(protocolWrite.brightness());
         pending.powerOn = protocolWrite.on();
+        fadeMs = 0;
         return *this;
     }
 
@@ -109,55 +247,385 @@ namespace kilight::output {
         }
         previous = live;
         live = pending;
+        if (live.powerOn && !previous.powerOn) {
+            // Turning an output back on is what clears a latched over-current trip
+            OverCurrentGuard::reset(index);
+        }
         return true;
     }
 
-    void LightSubsystem::output_state_t::calculateTargetOutput(LightSubsystem const & parent) {
-        if (!live.powerOn) {
-            target = rgbcw_color_volatile_t { 0, 0, 0, 0, 0 };
-        } else {
-            target = live.getRGBCWColorScaledToBrightness();
+    render_command_t LightSubsystem::output_state_t::targetCommand(uint8_t const derate) const {
+        render_command_t command;
+        command.type = render_command_t::Type::SetTarget;
+        command.outputIndex = index;
+        command.brightness = live.brightnessMultiplier;
+        command.powerOn = live.powerOn;
+        command.limit = limit;
+        command.derate = derate;
+        command.fadeMs = fadeMs;
+        if (live.powerOn) {
+            command.target = live.getRGBCWColorScaledToBrightness();
+        }
+        DEBUG("Set Output {} = {}", outputName(index), command.target);
+        return command;
+    }
+
+    LightSubsystem::output_state_t* LightSubsystem::outputFor(OutputIdentifier const outputId) {
+        std::optional<uint8_t> const index = outputIndexFor(outputId);
+        return index.has_value() ? &m_outputs[*index] : nullptr;
+    }
+
+    bool LightSubsystem::updateLiveOutputs() {
+        auto const lock = m_criticalSection.lock();
+        bool changed = false;
+        for (output_state_t& output : m_outputs) {
+            changed = output.updateLive() || changed;
+        }
+        return changed;
+    }
+
+    void LightSubsystem::syncTargets() {
+        // If the queue is full the render engine is behind, so try again on the next loop
+        m_targetSyncPending = false;
+        for (output_state_t const& output : m_outputs) {
+            m_targetSyncPending = !submitRenderCommand(output.targetCommand(m_thermalDerate)) || m_targetSyncPending;
         }
-        DEBUG("Set {} = {}", outputId == OutputIdentifier::OutputA ? "Output A" : "Output B", target);
+    }
+
+    bool LightSubsystem::submitRenderCommand(render_command_t const& command) {
+        if (!m_renderEngine.submitCommand(command)) {
+            WARN("Render command queue full, dropping command");
+            return false;
+        }
+        return true;
+    }
 
-        parent.onOutputChange(outputId, live);
+    bool LightSubsystem::stopPlayback(output_state_t& output) {
+        output.transitionsQueued = false;
+        render_command_t command;
+        command.type = render_command_t::Type::StopPlayback;
+        command.outputIndex = output.index;
+        return submitRenderCommand(command);
     }
 
-    void LightSubsystem::startFadeAlarm() {
-        m_fadeAlarm.setTimeout(FadeTickMs, [this](core::Alarm & alarm) {
-            if (m_outputA.current != m_outputA.target) {
-                m_outputA.current.incrementTowards(m_outputA.target);
-                writeCurrentOutput<SystemPins::OutputA>(m_outputA);
+    CommandResult LightSubsystem::processEffectCommand(EffectCommand const& effectCommand) {
+        CommandResult response;
+        response.set_result(CommandResult::Result::Error);
+
+        if (effectCommand.slot() >= MaxEffectPrograms) {
+            WARN("Invalid effect slot: {}", effectCommand.slot());
+            return response;
+        }
+        auto const slot = static_cast<uint8_t>(effectCommand.slot());
+
+        switch (effectCommand.action()) {
+        case EffectCommand::Action::Upload:
+            m_storage->updatePendingData([&effectCommand, slot](save_data_t& saveData) {
+                saveData.effects[slot] = effectCommand.program();
+            });
+            DEBUG("Stored effect program in slot {}", slot);
+            response.set_result(CommandResult::Result::OK);
+            break;
+
+        case EffectCommand::Action::Start: {
+            output_state_t* const output = outputFor(effectCommand.outputId());
+            effect_program_t const& program = m_storage->pendingData().effects[slot];
+            if (output == nullptr || program.empty()) {
+                break;
+            }
+            render_command_t command;
+            command.type = render_command_t::Type::StartEffect;
+            command.outputIndex = output->index;
+            command.effectSlot = slot;
+            command.effectSeed = time_us_32();
+            command.effect = program;
+            if (!submitRenderCommand(command)) {
+                break;
             }
-            #ifdef KILIGHT_HAS_OUTPUT_B
-            if (m_outputB.current != m_outputB.target) {
-                m_outputB.current.incrementTowards(m_outputB.target);
-                writeCurrentOutput<SystemPins::OutputB>(m_outputB);
+            {
+                auto const lock = m_criticalSection.lock();
+                output->pending.powerOn = true;
             }
-            if (m_outputA.current != m_outputA.target || m_outputB.current != m_outputB.target) {
-                alarm.restart(FadeTickMs);
+            output->transitionsQueued = false;
+            DEBUG("Started effect {}", slot);
+            response.set_result(CommandResult::Result::OK);
+            break;
+        }
+
+        case EffectCommand::Action::Stop: {
+            output_state_t* const output = outputFor(effectCommand.outputId());
+            if (output == nullptr) {
+                break;
             }
-            #else
-            if (m_outputA.current != m_outputA.target) {
-                alarm.restart(FadeTickMs);
+            if (stopPlayback(*output)) {
+                response.set_result(CommandResult::Result::OK);
             }
-            #endif
+            break;
+        }
+
+        default:
+            break;
+        }
+        return response;
+    }
+
+    CommandResult LightSubsystem::processConfigureOutput(ConfigureOutput const& configureOutput) {
+        CommandResult response;
+        response.set_result(CommandResult::Result::Error);
+
+        output_state_t* const output = outputFor(configureOutput.outputId());
+        if (output == nullptr) {
+            return response;
+        }
+
+        output_config_t config;
+        config = configureOutput;
+        if (!config.calibration.valid()) {
+            WARN("Rejected invalid fixture calibration");
+            return response;
+        }
+
+        output->converter.setCalibration(config.calibration);
+        if (SystemPins::pwmPhaseMode(output->index) != config.pwmPhaseMode) {
+            restartPWM(output->index, config.pwmPhaseMode);
+        }
+        m_storage->updatePendingOutputConfig(output->index, [&config](output_config_t& saveConfig) {
+            saveConfig = config;
         });
+        // The outputs on the same slices just changed phase mode along with this one
+        for (uint8_t index = 0; index < SystemPins::OutputCount; ++index) {
+            if (index != output->index && SystemPins::sharePWMSlices(index, output->index)) {
+                m_storage->updatePendingOutputConfig(index, [&config](output_config_t& saveConfig) {
+                    saveConfig.pwmPhaseMode = config.pwmPhaseMode;
+                });
+            }
+        }
+        DEBUG("Updated output configuration");
+        response.set_result(CommandResult::Result::OK);
+        return response;
     }
 
-    bool LightSubsystem::updateLiveOutputs() {
-        auto const lock = m_criticalSection.lock();
-        return m_outputA.updateLive();
+    CommandResult LightSubsystem::processPresetCommand(PresetCommand const& presetCommand) {
+        CommandResult response;
+        response.set_result(CommandResult::Result::Error);
+
+        if (presetCommand.slot() >= MaxPresets) {
+            WARN("Invalid preset slot: {}", presetCommand.slot());
+            return response;
+        }
+        auto const slot = static_cast<uint8_t>(presetCommand.slot());
+
+        switch (presetCommand.action()) {
+        case PresetCommand::Action::Save: {
+            preset_t preset;
+            preset = presetCommand.preset();
+            if (preset.empty()) {
+                // Nothing given, so capture the scene as it is right now
+                for (output_state_t const& output : m_outputs) {
+                    preset.outputs[output.index] = output.live;
+                    preset.outputMask |= static_cast<uint8_t>(1U << output.index);
+                }
+            }
+            m_storage->updatePendingData([&preset, slot](save_data_t& saveData) {
+                saveData.presets[slot] = preset;
+            });
+            DEBUG("Stored preset in slot {}", slot);
+            response.set_result(CommandResult::Result::OK);
+            break;
+        }
+
+        case PresetCommand::Action::Delete:
+            m_storage->updatePendingData([slot](save_data_t& saveData) {
+                saveData.presets[slot] = preset_t{};
+            });
+            DEBUG("Deleted preset in slot {}", slot);
+            response.set_result(CommandResult::Result::OK);
+            break;
+
+        default:
+            break;
+        }
+        return response;
+    }
+
+    CommandResult LightSubsystem::processTransitionCommand(TransitionCommand const& transitionCommand) {
+        CommandResult response;
+        response.set_result(CommandResult::Result::Error);
+
+        output_state_t* const output = outputFor(transitionCommand.outputId());
+        if (output == nullptr) {
+            return response;
+        }
+
+        if (transitionCommand.action() == TransitionCommand::Action::Clear) {
+            if (stopPlayback(*output)) {
+                response.set_result(CommandResult::Result::OK);
+            }
+            return response;
+        }
+
+        auto const& transitions = transitionCommand.transitions();
+        if (transitions.get_length() == 0 || transitions.get_length() > MaxQueuedTransitions) {
+            WARN("Invalid number of transitions: {}", transitions.get_length());
+            return response;
+        }
+
+        render_command_t command;
+        command.replaceTransitions = transitionCommand.action() == TransitionCommand::Action::Replace;
+        command.transitionCount = static_cast<uint8_t>(transitions.get_length());
+
+        output_data_t last;
+        for (uint8_t index = 0; index < command.transitionCount; ++index) {
+            auto const& transition = transitions[index];
+            last.color = transition.color();
+            last.brightnessMultiplier = static_cast<uint8_t>(std::min<uint32_t>(transition.brightness(), UINT8_MAX));
+            last.powerOn = transition.on();
+            if (last.powerOn) {
+                command.transitions[index].target = last.getRGBCWColorScaledToBrightness();
+            }
+            command.transitions[index].fadeMs = transition.fadeMs();
+            command.transitions[index].holdMs = transition.holdMs();
+        }
+
+        if (!submitTransitions(*output, command, last)) {
+            return response;
+        }
+        DEBUG("Queued {} transitions on Output {}", command.transitionCount, outputName(output->index));
+        response.set_result(CommandResult::Result::OK);
+        return response;
+    }
+
+    bool LightSubsystem::playCalibrationSequence(uint8_t const outputIndex, uint32_t const stepMs) {
+        if (outputIndex >= m_outputs.size()) {
+            return false;
+        }
+        output_state_t& output = m_outputs[outputIndex];
+
+        static_assert(rgbcw_color_t::ChannelCount + 2 <= MaxQueuedTransitions);
+        render_command_t command;
+        command.replaceTransitions = true;
+        // Each channel on its own at full duty, then everything off, then straight back to the scene
+        for (uint8_t channel = 0; channel < rgbcw_color_t::ChannelCount; ++channel) {
+            render_transition_t& step = command.transitions[command.transitionCount++];
+            step.target = rgbcw_color_t::singleChannel(channel, UINT8_MAX);
+            step.holdMs = stepMs;
+        }
+        command.transitions[command.transitionCount++].holdMs = stepMs;
+
+        output_data_t scene;
+        {
+            auto const lock = m_criticalSection.lock();
+            scene = output.live;
+        }
+        if (scene.powerOn) {
+            command.transitions[command.transitionCount].target = scene.getRGBCWColorScaledToBrightness();
+        }
+        ++command.transitionCount;
+
+        if (!submitTransitions(output, command, scene)) {
+            return false;
+        }
+        INFO("Playing current calibration sequence on Output {}", outputName(outputIndex));
+        return true;
+    }
+
+    bool LightSubsystem::submitTransitions(output_state_t& output,
+                                           render_command_t& command,
+                                           output_data_t const& end) {
+        command.type = render_command_t::Type::QueueTransitions;
+        command.outputIndex = output.index;
+        command.transitionSequence = static_cast<uint8_t>(output.transitionSequence + 1);
+        if (!submitRenderCommand(command)) {
+            return false;
+        }
+
+        // The output's target becomes wherever the sequence ends, so it stays there once the queue runs dry. It has
+        // to stay on to play the sequence, even if it ends off.
+        {
+            auto const lock = m_criticalSection.lock();
+            output.pending.color = end.color;
+            output.pending.brightnessMultiplier = end.brightnessMultiplier;
+            output.pending.powerOn = true;
+        }
+        output.fadeMs = 0;
+        output.transitionSequence = command.transitionSequence;
+        output.transitionsQueued = true;
+        output.transitionsEndOff = !end.powerOn;
+        return true;
+    }
+
+    CommandResult LightSubsystem::recallPreset(uint32_t const slot) {
+        CommandResult response;
+        response.set_result(CommandResult::Result::Error);
+
+        if (slot >= MaxPresets) {
+            WARN("Invalid preset slot: {}", slot);
+            return response;
+        }
+
+        preset_t const& preset = m_storage->pendingData().presets[slot];
+        if (preset.empty()) {
+            WARN("No preset in slot {}", slot);
+            return response;
+        }
+
+        for (output_state_t& output : m_outputs) {
+            if (!preset.includes(output.index)) {
+                continue;
+            }
+            output.pending = preset.outputs[output.index];
+            output.fadeMs = preset.fadeMs;
+            // Like a direct write, a preset takes over from whatever effect was playing
+            stopPlayback(output);
+        }
+        DEBUG("Recalled preset {}", slot);
+        response.set_result(CommandResult::Result::OK);
+        return response;
+    }
+
+    void LightSubsystem::restartPWM(uint8_t const outputIndex, PWMPhaseMode const phaseMode) {
+        // Core 1 only ever changes the levels, so the slices can be restarted underneath it. The outputs glitch
+        // for at most one PWM period while the counters are moved.
+        SystemPins::enablePWM(outputIndex, phaseMode);
+        ADC::synchronizeToPWM();
+    }
+
+    void LightSubsystem::publishRenderState(output_state_t& output, render_output_status_t const& status) {
+        // The sequence check makes sure core 1 has actually seen the transitions, not just not got to them yet
+        if (output.transitionsQueued
+            && status.transitionSequence == output.transitionSequence
+            && status.queuedTransitions == 0) {
+            output.transitionsQueued = false;
+            if (output.transitionsEndOff) {
+                auto const lock = m_criticalSection.lock();
+                output.pending.powerOn = false;
+            }
+        }
+
+        if (output.effectRunning == status.effectRunning
+            && output.effectSlot == status.effectSlot
+            && output.queuedTransitions == status.queuedTransitions) {
+            return;
+        }
+        output.effectRunning = status.effectRunning;
+        output.effectSlot = status.effectSlot;
+        output.queuedTransitions = status.queuedTransitions;
+        m_wifi->updateOutputStateData(output.index, [&status](OutputState& state) {
+            state.set_effectRunning(status.effectRunning);
+            state.set_effectSlot(status.effectSlot);
+            state.set_queuedTransitions(status.queuedTransitions);
+        });
     }
 
-    void LightSubsystem::onOutputChange(OutputIdentifier const outputId, output_data_t const& newValue) const {
-        m_wifi->updateOutputStateData(outputId, [&newValue](OutputState& output) {
-            output.set_color(newValue.color.toColor());
-            output.set_brightness(newValue.brightnessMultiplier);
-            output.set_on(static_cast<bool>(newValue.powerOn));
+    void LightSubsystem::onOutputChange(output_state_t const& output) const {
+        output_data_t const& newValue = output.live;
+        m_wifi->updateOutputStateData(output.index, [&newValue](OutputState& state) {
+            state.set_color(newValue.color.toColor());
+            state.set_brightness(newValue.brightnessMultiplier);
+            state.set_on(static_cast<bool>(newValue.powerOn));
         });
 
-        m_storage->updatePendingOutputData(outputId, [&newValue](output_data_t & saveData) {
+        m_storage->updatePendingOutputData(output.index, [&newValue](output_data_t & saveData) {
             saveData = newValue;
         });
     }
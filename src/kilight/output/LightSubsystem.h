@@ -6,16 +6,29 @@
 
 #pragma once
 
+#include <array>
+#include <utility>
+
 #include <mpf/core/Logging.h>
 #include <mpf/core/Subsystem.h>
 
 #include <kilight/protocol/OutputIdentifier.h>
+#include <kilight/protocol/EffectCommand.h>
+#include <kilight/protocol/ConfigureOutput.h>
+#include <kilight/protocol/PresetCommand.h>
+#include <kilight/protocol/TransitionCommand.h>
 
 #include "kilight/core/Alarm.h"
 #include "kilight/com/WifiSubsystem.h"
+#include "kilight/com/stream_data.h"
 #include "kilight/core/CriticalSection.h"
 #include "kilight/hw/SystemPins.h"
+#include "kilight/output/ColorConverter.h"
 #include "kilight/output/output_data.h"
+#include "kilight/output/output_identifier.h"
+#include "kilight/output/preset_data.h"
+#include "kilight/output/render_data.h"
+#include "kilight/output/RenderEngine.h"
 #include "kilight/storage/StorageSubsystem.h"
 
 namespace kilight::output {
@@ -24,7 +37,7 @@ namespace kilight::output {
         LOGGER(Light);
 
     public:
-        static constexpr uint32_t FadeTickMs = 5;
+        static constexpr uint32_t RenderStatusPollMs = 100;
 
         LightSubsystem(mpf::core::SubsystemList* list,
                        storage::StorageSubsystem* storageSubsystem,
@@ -41,19 +54,62 @@ namespace kilight::output {
 
         void work() override;
 
-        void powerOffOutputA();
+        void powerOffOutput(uint8_t outputIndex);
+
+        void powerOffAllOutputs();
+
+        /**
+         * Scales an output back to keep it inside its power budget. This applies on top of the output's brightness,
+         * and to effects and streamed frames as well.
+         *
+         * @param outputIndex Output to limit
+         * @param limit Scale to apply, where 255 leaves the output unlimited
+         */
+        void setOutputLimit(uint8_t outputIndex, uint8_t limit);
+
+        /**
+         * Lowers the brightness ceiling of every output to keep the fixture cool. The outputs fade to the new ceiling
+         * rather than jumping.
+         *
+         * @param derate Ceiling to fade to, where 255 is full brightness
+         */
+        void setThermalDerate(uint8_t derate);
+
+        /**
+         * Fades an output to a new colour temperature and brightness, taking over from any effect, the same as a
+         * write from a client would.
+         *
+         * @param outputIndex Output to change
+         * @param kelvin Colour temperature to fade to, or 0 to leave the colour as it is
+         * @param brightness Brightness to fade to
+         * @param powerOn Whether the output ends up on
+         * @param fadeMs How long the fade takes, 0 for the normal fade
+         */
+        void transitionOutput(uint8_t outputIndex, uint16_t kelvin, uint8_t brightness, bool powerOn, uint32_t fadeMs);
+
+        protocol::CommandResult recallPreset(uint32_t slot);
+
+        /**
+         * Runs each channel of an output on its own at full duty, then all of them off, holding each for stepMs, and
+         * then puts the scene back. Used to calibrate the output's current model.
+         *
+         * @return false if the render engine couldn't take the sequence
+         */
+        bool playCalibrationSequence(uint8_t outputIndex, uint32_t stepMs);
+
+        /**
+         * Only call from the lwIP callback context.
+         *
+         * @return false if the frame was dropped because the render engine is behind
+         */
+        bool submitStreamFrame(com::stream_frame_t const& frame);
 
-        #ifdef KILIGHT_HAS_OUTPUT_B
-        void powerOffOutputB();
-        #endif
+        [[nodiscard]]
+        render_status_t renderStatus() const;
 
     private:
         struct output_state_t {
-            protocol::OutputIdentifier const outputId;
-
-            rgbcw_color_volatile_t target{};
-
-            rgbcw_color_volatile_t current{};
+            uint8_t const index;
 
             output_data_t live{};
 
@@ -61,46 +117,91 @@ namespace kilight::output {
 
             output_data_t previous{};
 
+            ColorConverter converter{};
+
+            uint8_t limit = UINT8_MAX;
+
+            // How long the fade to the pending target takes, 0 for the normal fade
+            uint32_t fadeMs = 0;
+
+            // Effect state last published to the wifi state data
+            bool effectRunning = false;
+
+            uint8_t effectSlot = 0;
+
+            uint8_t queuedTransitions = 0;
+
+            // Bumped with each batch of transitions sent to core 1
+            uint8_t transitionSequence = 0;
+
+            // Transitions were sent to core 1 and it hasn't finished them yet
+            bool transitionsQueued = false;
+
+            // The last queued transition turns the output off, which happens once the queue runs dry
+            bool transitionsEndOff = false;
+
             output_state_t() = delete;
 
-            explicit output_state_t(protocol::OutputIdentifier const outputId) :
-                outputId(outputId) {
+            explicit output_state_t(uint8_t const index) :
+                index(index) {
             }
 
             output_state_t & operator=(protocol::WriteOutput const & protocolWrite);
 
             bool updateLive();
 
-            void calculateTargetOutput(LightSubsystem const & parent);
+            [[nodiscard]]
+            render_command_t targetCommand(uint8_t derate) const;
         };
 
-        template <typename OutputPinGroupT>
-        static void writeCurrentOutput(output_state_t const& outputToWrite) {
-            OutputPinGroupT::Red::writePWM(outputToWrite.current.red);
-            OutputPinGroupT::Green::writePWM(outputToWrite.current.green);
-            OutputPinGroupT::Blue::writePWM(outputToWrite.current.blue);
-            OutputPinGroupT::ColdWhite::writePWM(outputToWrite.current.coldWhite);
-            OutputPinGroupT::WarmWhite::writePWM(outputToWrite.current.warmWhite);
-        }
-
         com::WifiSubsystem* const m_wifi;
 
         storage::StorageSubsystem* const m_storage;
 
         core::CriticalSection m_criticalSection;
 
-        core::Alarm m_fadeAlarm;
+        RenderEngine m_renderEngine;
+
+        core::Alarm m_statusAlarm;
 
-        output_state_t m_outputA{protocol::OutputIdentifier::OutputA};
+        bool volatile m_statusPollPending = false;
 
-        #ifdef KILIGHT_HAS_OUTPUT_B
-        output_state_t m_outputB { protocol::OutputIdentifier::OutputB };
-        #endif
+        bool m_targetSyncPending = false;
 
-        void startFadeAlarm();
+        uint8_t m_thermalDerate = UINT8_MAX;
+
+        std::array<output_state_t, OutputCount> m_outputs = makeOutputs(std::make_index_sequence<OutputCount>{});
+
+        template <size_t... Indices>
+        static std::array<output_state_t, OutputCount> makeOutputs(std::index_sequence<Indices...>) {
+            return {output_state_t{static_cast<uint8_t>(Indices)}...};
+        }
+
+        [[nodiscard]]
+        output_state_t* outputFor(protocol::OutputIdentifier outputId);
 
         bool updateLiveOutputs();
 
-        void onOutputChange(protocol::OutputIdentifier outputId, output_data_t const& newValue) const;
+        void syncTargets();
+
+        bool submitRenderCommand(render_command_t const& command);
+
+        bool stopPlayback(output_state_t& output);
+
+        protocol::CommandResult processEffectCommand(protocol::EffectCommand const& effectCommand);
+
+        protocol::CommandResult processConfigureOutput(protocol::ConfigureOutput const& configureOutput);
+
+        protocol::CommandResult processPresetCommand(protocol::PresetCommand const& presetCommand);
+
+        protocol::CommandResult processTransitionCommand(protocol::TransitionCommand const& transitionCommand);
+
+        bool submitTransitions(output_state_t& output, render_command_t& command, output_data_t const& end);
+
+        static void restartPWM(uint8_t outputIndex, hw::PWMPhaseMode phaseMode);
+
+        void publishRenderState(output_state_t& output, render_output_status_t const& status);
+
+        void onOutputChange(output_state_t const& output) const;
     };
 }
@@ -0,0 +1,362 @@
+/**
+ * RenderEngine.cpp
+ *
+ * @author Patrick Lavigne
+ */
+
+#include "kilight/output/RenderEngine.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include <pico/multicore.h>
+#include <hardware/irq.h>
+#include <hardware/structs/timer.h>
+
+#include "kilight/hw/OverCurrentGuard.h"
+#include "kilight/util/MathUtil.h"
+
+using kilight::com::stream_frame_t;
+using kilight::hw::OverCurrentGuard;
+using kilight::hw::SystemPins;
+using kilight::util::MathUtil;
+
+namespace kilight::output {
+
+    // PICO_FLASH_ASSUME_CORE1_SAFE is set, so core 1 keeps running while core 0 writes to flash. Everything core 1
+    // calls is therefore either placed in RAM here or force inlined, and it never touches the SDK's alarm pool or
+    // anything else that lives in flash.
+
+    void RenderEngine::launch() {
+        assert(instance == nullptr);
+        instance = this;
+        multicore_launch_core1(&RenderEngine::core1Entry);
+    }
+
+    bool RenderEngine::submitCommand(render_command_t const& command) {
+        return m_commands.push(command);
+    }
+
+    bool RenderEngine::submitFrame(stream_frame_t const& frame) {
+        return m_frames.push(frame);
+    }
+
+    render_status_t RenderEngine::status() const {
+        return m_status.read();
+    }
+
+    void __not_in_flash_func(RenderEngine::core1Entry)() {
+        // Interrupts are per core, so the wrap interrupt has to be set up from here. These live in flash, but
+        // core 0 is still setting up and can't be writing to it yet.
+        irq_set_exclusive_handler(PWM_DEFAULT_IRQ_NUM(), &RenderEngine::pwmWrapHandler);
+        irq_set_enabled(PWM_DEFAULT_IRQ_NUM(), true);
+        instance->run();
+    }
+
+    void __not_in_flash_func(RenderEngine::pwmWrapHandler)() {
+        uint32_t const wrapped = pwm_get_irq_status_mask();
+        for (uint8_t index = 0; index < OutputCount; ++index) {
+            uint32_t const slice = latchSlice(index);
+            if ((wrapped & (1U << slice)) != 0) {
+                // One shot, the interrupt is only armed while there is a colour staged
+                pwm_set_irq_enabled(slice, false);
+                pwm_clear_irq(slice);
+                commitOutput(index);
+            }
+        }
+    }
+
+    uint32_t __not_in_flash_func(RenderEngine::latchSlice)(uint8_t const outputIndex) {
+        uint32_t slice = 0;
+        SystemPins::withOutput(outputIndex, [&slice]<typename PinGroupT>(uint8_t) __attribute__((always_inline)) {
+            // Red's slice wrapping marks the start of the output's PWM period
+            slice = pwm_gpio_to_slice_num(PinGroupT::Red::Number);
+        });
+        return slice;
+    }
+
+    void __not_in_flash_func(RenderEngine::commitOutput)(uint8_t const outputIndex) {
+        // The levels are double buffered, so each slice picks its new level up at its own next wrap. With staggered
+        // phases those wraps are spread over the coming period, but every one of them is still ahead of us.
+        rgbcw_color_t const& color = instance->m_stagedOutputs[outputIndex];
+        SystemPins::withOutput(outputIndex, [&color]<typename PinGroupT>(uint8_t) __attribute__((always_inline)) {
+            PinGroupT::writePWM({color.red, color.green, color.blue, color.coldWhite, color.warmWhite});
+        });
+        OverCurrentGuard::enforce(outputIndex);
+    }
+
+    void __not_in_flash_func(RenderEngine::writeOutput)(uint8_t const outputIndex, rgbcw_color_t const& color) {
+        if (outputIndex >= m_stagedOutputs.size()) {
+            return;
+        }
+        uint32_t const slice = latchSlice(outputIndex);
+        pwm_set_irq_enabled(slice, false);
+        render_output_t const& output = m_outputs[outputIndex];
+        auto const scale = static_cast<uint8_t>(MathUtil::divideBy255Rounded(output.limit * output.derate));
+        m_stagedOutputs[outputIndex] = color.scaledBy(scale);
+        // The wrap flag is raised every period whether or not anyone is listening, so clear it first, or the
+        // interrupt would fire straight away at some random point in the period
+        pwm_clear_irq(slice);
+        pwm_set_irq_enabled(slice, true);
+    }
+
+    uint64_t __not_in_flash_func(RenderEngine::nowUs)() {
+        // Same as time_us_64(), which lives in flash
+        uint32_t high = timer_hw->timerawh;
+        uint32_t low = 0;
+        while (true) {
+            low = timer_hw->timerawl;
+            uint32_t const nextHigh = timer_hw->timerawh;
+            if (high == nextHigh) {
+                break;
+            }
+            high = nextHigh;
+        }
+        return (static_cast<uint64_t>(high) << 32U) | low;
+    }
+
+    void __not_in_flash_func(RenderEngine::run)() {
+        uint64_t const startUs = nowUs();
+        m_nextFadeUs = startUs + FadeTickMs * 1000;
+        m_nextStreamRenderUs = startUs + StreamRenderIntervalUs;
+        m_jitterWindowStartUs = startUs;
+
+        while (true) {
+            render_command_t command;
+            while (m_commands.pop(command)) {
+                processCommand(command);
+            }
+
+            uint64_t const now = nowUs();
+            queueFrames(now);
+
+            bool ticked = false;
+            if (now >= m_nextStreamRenderUs) {
+                streamTick(now);
+                m_nextStreamRenderUs += StreamRenderIntervalUs;
+                if (m_nextStreamRenderUs <= now) {
+                    m_nextStreamRenderUs = now + StreamRenderIntervalUs;
+                }
+                ticked = true;
+            }
+
+            if (now >= m_nextFadeUs) {
+                fadeTick();
+                m_nextFadeUs += FadeTickMs * 1000;
+                if (m_nextFadeUs <= now) {
+                    m_nextFadeUs = now + FadeTickMs * 1000;
+                }
+                ticked = true;
+            }
+
+            if (ticked) {
+                publishStatus();
+            }
+        }
+    }
+
+    void __not_in_flash_func(RenderEngine::processCommand)(render_command_t const& command) {
+        if (command.outputIndex >= m_outputs.size()) {
+            return;
+        }
+        render_output_t& output = m_outputs[command.outputIndex];
+
+        switch (command.type) {
+        case render_command_t::Type::SetTarget:
+            // Targets are resent whenever anything about the output changes, so only a new target restarts the fade
+            if (output.target != command.target) {
+                output.fadeFrom = output.current;
+                output.fadeElapsedMs = 0;
+                output.fadeDurationMs = command.fadeMs;
+            }
+            output.target = command.target;
+            output.brightness = command.brightness;
+            output.powerOn = command.powerOn;
+            if (!output.powerOn) {
+                output.effect.stop();
+                clearTransitions(output);
+            }
+            if (output.limit != command.limit) {
+                // The limiter is fighting an overload, so it can't wait for the colour to change next
+                output.limit = command.limit;
+                writeOutput(command.outputIndex, output.current);
+            }
+            output.derateTarget = command.derate;
+            break;
+
+        case render_command_t::Type::StartEffect:
+            clearTransitions(output);
+            // The effect's colours are scaled by the brightness as they're played, so it starts from the unscaled
+            // current colour, or its first segment would start out scaled by the brightness twice
+            output.effect.start(command.effect,
+                                command.effectSlot,
+                                output.current.unscaledBy(output.brightness),
+                                command.effectSeed);
+            // Wherever the effect leaves the output, it steps back to the target rather than resuming a stale fade
+            output.fadeDurationMs = 0;
+            break;
+
+        case render_command_t::Type::QueueTransitions:
+            output.effect.stop();
+            queueTransitions(output, command);
+            break;
+
+        case render_command_t::Type::StopPlayback:
+            output.effect.stop();
+            clearTransitions(output);
+            output.fadeDurationMs = 0;
+            break;
+        }
+    }
+
+    void __not_in_flash_func(RenderEngine::queueTransitions)(render_output_t& output, render_command_t const& command) {
+        if (command.replaceTransitions) {
+            clearTransitions(output);
+        }
+        for (uint8_t index = 0; index < command.transitionCount && output.transitionCount < MaxQueuedTransitions;
+             ++index) {
+            if (output.transitionCount == 0) {
+                // Nothing was playing, so this one starts from wherever the output is now
+                output.transitionFrom = output.current;
+                output.transitionElapsedMs = 0;
+            }
+            uint8_t const tail = (output.transitionHead + output.transitionCount) % MaxQueuedTransitions;
+            output.transitions[tail] = command.transitions[index];
+            ++output.transitionCount;
+        }
+        output.transitionSequence = command.transitionSequence;
+    }
+
+    void __not_in_flash_func(RenderEngine::clearTransitions)(render_output_t& output) {
+        output.transitionHead = 0;
+        output.transitionCount = 0;
+    }
+
+    void __not_in_flash_func(RenderEngine::advanceTransition)(render_output_t& output) {
+        render_transition_t const& transition = output.transitions[output.transitionHead];
+        output.transitionElapsedMs += FadeTickMs;
+        output.current = output.transitionFrom.interpolatedTowards(transition.target,
+                                                                   output.transitionElapsedMs,
+                                                                   transition.fadeMs);
+        if (output.transitionElapsedMs < transition.fadeMs + transition.holdMs) {
+            return;
+        }
+
+        output.transitionHead = (output.transitionHead + 1) % MaxQueuedTransitions;
+        --output.transitionCount;
+        output.transitionElapsedMs = 0;
+        output.transitionFrom = output.current;
+        if (output.transitionCount == 0) {
+            // Stay where the sequence ended rather than fading off somewhere else before core 0 catches up
+            output.target = output.current;
+            output.fadeDurationMs = 0;
+        }
+    }
+
+    void __not_in_flash_func(RenderEngine::queueFrames)(uint64_t const now) {
+        stream_frame_t frame;
+        while (m_frames.pop(frame)) {
+            m_lastFrameQueuedUs = now;
+            if (m_jitterBuffer.push(frame, m_lastRenderedFrameUs)
+                != com::JitterBuffer<stream_frame_t, JitterBufferFrames>::PushResult::Queued) {
+                // Either too late to show, or it pushed out the oldest queued frame, which won't be shown either
+                ++m_publishedStatus.streamFramesLate;
+            }
+        }
+    }
+
+    void __not_in_flash_func(RenderEngine::fadeTick)() {
+        bool const derateStep = ++m_derateFadeTicks >= DerateFadeTicksPerStep;
+        if (derateStep) {
+            m_derateFadeTicks = 0;
+        }
+
+        for (uint8_t index = 0; index < m_outputs.size(); ++index) {
+            render_output_t& output = m_outputs[index];
+            bool const derateChanged = derateStep && output.derate != output.derateTarget;
+            if (derateChanged) {
+                output.derate = MathUtil::incrementBetween(output.derate, output.derateTarget);
+            }
+
+            if (m_streaming) {
+                // Streamed frames are written directly and pick the derating up with the next frame, fading picks
+                // back up once the stream ends
+                continue;
+            }
+
+            if (output.transitionCount > 0) {
+                advanceTransition(output);
+                writeOutput(index, output.current);
+            } else if (output.effect.running()) {
+                output.current = output.effect.advance(FadeTickMs).scaledBy(output.brightness);
+                writeOutput(index, output.current);
+            } else if (output.current != output.target) {
+                // A finite effect that just ended also lands here, and fades back to the target
+                if (output.fadeDurationMs > 0) {
+                    output.fadeElapsedMs += FadeTickMs;
+                    output.current = output.fadeFrom.interpolatedTowards(output.target,
+                                                                         output.fadeElapsedMs,
+                                                                         output.fadeDurationMs);
+                } else {
+                    output.current.incrementTowards(output.target);
+                }
+                writeOutput(index, output.current);
+            } else if (derateChanged) {
+                writeOutput(index, output.current);
+            }
+        }
+    }
+
+    void __not_in_flash_func(RenderEngine::streamTick)(uint64_t const now) {
+        if (now - m_jitterWindowStartUs >= StreamJitterWindowUs) {
+            m_previousJitterWindowMaxUs = m_jitterWindowMaxUs;
+            m_jitterWindowMaxUs = 0;
+            m_jitterWindowStartUs = now;
+        }
+
+        stream_frame_t frame;
+        uint32_t skipped = 0;
+        bool const frameDue = m_jitterBuffer.popDue(now, frame, skipped);
+        m_publishedStatus.streamFramesLate += skipped;
+
+        if (!frameDue) {
+            if (m_streaming && now - m_lastFrameQueuedUs > StreamTimeoutUs) {
+                m_streaming = false;
+                m_jitterBuffer.clear();
+                m_lastRenderedFrameUs = 0;
+            }
+            return;
+        }
+
+        m_streaming = true;
+        m_lastRenderedFrameUs = frame.playoutTimeUs;
+        for (uint8_t index = 0; index < m_outputs.size(); ++index) {
+            render_output_t& output = m_outputs[index];
+            output.effect.stop();
+            clearTransitions(output);
+            output.fadeDurationMs = 0;
+            // Power state stays in charge while streaming, so an output that is off (or was tripped off) stays dark
+            output.current = output.powerOn ? frame.outputs[index] : rgbcw_color_t{};
+            writeOutput(index, output.current);
+        }
+
+        auto const jitterUs = static_cast<uint32_t>(now - frame.playoutTimeUs);
+        m_jitterWindowMaxUs = std::max(m_jitterWindowMaxUs, jitterUs);
+        ++m_publishedStatus.streamFramesRendered;
+        m_publishedStatus.streamRenderJitterSumUs += jitterUs;
+    }
+
+    void __not_in_flash_func(RenderEngine::publishStatus)() {
+        for (uint8_t index = 0; index < m_outputs.size(); ++index) {
+            m_publishedStatus.outputs[index].current = m_outputs[index].current;
+            m_publishedStatus.outputs[index].levels = m_stagedOutputs[index];
+            m_publishedStatus.outputs[index].effectRunning = m_outputs[index].effect.running();
+            m_publishedStatus.outputs[index].effectSlot = m_outputs[index].effect.slot();
+            m_publishedStatus.outputs[index].queuedTransitions = m_outputs[index].transitionCount;
+            m_publishedStatus.outputs[index].transitionSequence = m_outputs[index].transitionSequence;
+        }
+        m_publishedStatus.streaming = m_streaming;
+        m_publishedStatus.streamRenderJitterMaxUs = std::max(m_jitterWindowMaxUs, m_previousJitterWindowMaxUs);
+        m_status.write(m_publishedStatus);
+    }
+}
@@ -0,0 +1,184 @@
+/**
+ * RenderEngine.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <pico/platform.h>
+#include <hardware/pwm.h>
+
+#include "kilight/com/JitterBuffer.h"
+#include "kilight/com/stream_data.h"
+#include "kilight/core/SeqLock.h"
+#include "kilight/core/SpscQueue.h"
+#include "kilight/hw/SystemPins.h"
+#include "kilight/output/EffectPlayer.h"
+#include "kilight/output/render_data.h"
+
+namespace kilight::output {
+
+    class RenderEngine final {
+    public:
+        static constexpr uint32_t FadeTickMs = 5;
+
+        // Thermal derating moves one step every this many fade ticks, so a full swing takes a few seconds
+        static constexpr uint8_t DerateFadeTicksPerStep = 4;
+
+        // Streamed frames are rendered on a fixed 250Hz cadence, comfortably above the 60-120Hz senders push at
+        static constexpr uint32_t StreamRenderIntervalUs = 4000;
+
+        // Streaming stops and fading to the normal target resumes after this long without a frame
+        static constexpr uint32_t StreamTimeoutUs = 1000000;
+
+        static constexpr uint32_t StreamJitterWindowUs = 1000000;
+
+        static constexpr uint32_t CommandQueueSize = 16;
+
+        static constexpr uint32_t FrameQueueSize = 8;
+
+        static constexpr uint32_t JitterBufferFrames = 8;
+
+        RenderEngine() = default;
+
+        RenderEngine(RenderEngine const&) = delete;
+
+        RenderEngine& operator=(RenderEngine const&) = delete;
+
+        void launch();
+
+        /**
+         * Only call from the main loop on core 0.
+         *
+         * @return false if the command queue is full
+         */
+        bool submitCommand(render_command_t const& command);
+
+        /**
+         * Only call from the lwIP callback context on core 0.
+         *
+         * @return false if the frame queue is full and the frame was dropped
+         */
+        bool submitFrame(com::stream_frame_t const& frame);
+
+        [[nodiscard]]
+        render_status_t status() const;
+
+    private:
+        struct render_output_t {
+            rgbcw_color_t target {};
+
+            rgbcw_color_t current {};
+
+            // Where a timed fade started from, and how far along it is
+            rgbcw_color_t fadeFrom {};
+
+            uint32_t fadeElapsedMs = 0;
+
+            uint32_t fadeDurationMs = 0;
+
+            EffectPlayer effect {};
+
+            // Ring buffer of transitions still to play, the one at the head is playing
+            std::array<render_transition_t, MaxQueuedTransitions> transitions {};
+
+            uint8_t transitionHead = 0;
+
+            uint8_t transitionCount = 0;
+
+            uint8_t transitionSequence = 0;
+
+            uint32_t transitionElapsedMs = 0;
+
+            rgbcw_color_t transitionFrom {};
+
+            uint8_t brightness = 0;
+
+            uint8_t limit = UINT8_MAX;
+
+            uint8_t derate = UINT8_MAX;
+
+            uint8_t derateTarget = UINT8_MAX;
+
+            bool powerOn = false;
+        };
+
+        static inline RenderEngine* instance = nullptr;
+
+        static void core1Entry();
+
+        static void pwmWrapHandler();
+
+        static uint32_t latchSlice(uint8_t outputIndex);
+
+        static void commitOutput(uint8_t outputIndex);
+
+        /**
+         * Stages a colour to be written to every channel of an output at once, right after the output's next PWM
+         * wrap. Writing the five levels directly could straddle a wrap and show half old, half new colour for a
+         * period. The output's limit and thermal derating are applied on the way.
+         */
+        void writeOutput(uint8_t outputIndex, rgbcw_color_t const& color);
+
+        static uint64_t nowUs();
+
+        core::SpscQueue<render_command_t, CommandQueueSize> m_commands;
+
+        core::SpscQueue<com::stream_frame_t, FrameQueueSize> m_frames;
+
+        core::SeqLock<render_status_t> m_status;
+
+        // Everything below is only touched by core 1
+
+        std::array<render_output_t, OutputCount> m_outputs {};
+
+        // Colours waiting for the PWM wrap interrupt to commit them, also on core 1
+        std::array<rgbcw_color_t, OutputCount> m_stagedOutputs {};
+
+        com::JitterBuffer<com::stream_frame_t, JitterBufferFrames> m_jitterBuffer;
+
+        render_status_t m_publishedStatus {};
+
+        uint64_t m_nextFadeUs = 0;
+
+        uint64_t m_nextStreamRenderUs = 0;
+
+        uint64_t m_lastFrameQueuedUs = 0;
+
+        uint64_t m_lastRenderedFrameUs = 0;
+
+        uint64_t m_jitterWindowStartUs = 0;
+
+        uint32_t m_jitterWindowMaxUs = 0;
+
+        uint32_t m_previousJitterWindowMaxUs = 0;
+
+        uint8_t m_derateFadeTicks = 0;
+
+        bool m_streaming = false;
+
+        [[noreturn]]
+        void run();
+
+        void processCommand(render_command_t const& command);
+
+        void queueFrames(uint64_t now);
+
+        void fadeTick();
+
+        static void queueTransitions(render_output_t& output, render_command_t const& command);
+
+        static void clearTransitions(render_output_t& output);
+
+        static void advanceTransition(render_output_t& output);
+
+        void streamTick(uint64_t now);
+
+        void publishStatus();
+    };
+
+}
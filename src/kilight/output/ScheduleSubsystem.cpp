@@ -0,0 +1,255 @@
+/**
+ * ScheduleSubsystem.cpp
+ *
+ * @author Patrick Lavigne
+ */
+
+#include "kilight/output/ScheduleSubsystem.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+#include <pico/cyw43_arch.h>
+#include <lwip/apps/sntp.h>
+
+#include <kilight/protocol/SystemState.h>
+
+#include "kilight/conf/WifiConfig.h"
+#include "kilight/hw/RealTimeClock.h"
+
+using mpf::core::SubsystemList;
+
+using kilight::com::WifiSubsystem;
+using kilight::conf::getWifiConfig;
+using kilight::core::Alarm;
+using kilight::hw::RealTimeClock;
+using kilight::protocol::ClockSource;
+using kilight::protocol::CommandResult;
+using kilight::protocol::ScheduleCommand;
+using kilight::protocol::SystemState;
+using kilight::storage::StorageSubsystem;
+using kilight::storage::save_data_t;
+
+// SNTP_SET_SYSTEM_TIME in lwipopts.h lands here
+extern "C" void kilight_sntp_set_system_time(uint32_t const seconds) {
+    kilight::output::ScheduleSubsystem::onNetworkTime(seconds);
+}
+
+namespace kilight::output {
+    ScheduleSubsystem::ScheduleSubsystem(SubsystemList* const list,
+                                         StorageSubsystem* const storageSubsystem,
+                                         WifiSubsystem* const wifiSubsystem,
+                                         LightSubsystem* const lightSubsystem) :
+        Subsystem(list),
+        m_storage(storageSubsystem),
+        m_wifi(wifiSubsystem),
+        m_lights(lightSubsystem) {
+        assert(m_storage != nullptr);
+        assert(m_wifi != nullptr);
+        assert(m_lights != nullptr);
+    }
+
+    void ScheduleSubsystem::initialize() {
+        RealTimeClock::initialize();
+    }
+
+    void ScheduleSubsystem::setUp() {
+        assert(instance == nullptr);
+        instance = this;
+
+        m_wifi->setScheduleCommandCallback([this](ScheduleCommand const& scheduleCommand) {
+            return processScheduleCommand(scheduleCommand);
+        });
+
+        m_wifi->setSetTimeCallback([this](uint64_t const& unixSeconds) {
+            return processSetTime(unixSeconds);
+        });
+
+        startNetworkTime();
+
+        if (RealTimeClock::valid()) {
+            INFO("Clock kept running through reset, schedule is live");
+        }
+        publishClockState();
+
+        m_alarm.setTimeout(CheckScheduleEveryMs,
+                           [this](Alarm const&) {
+                               m_checkPending = true;
+                           });
+    }
+
+    bool ScheduleSubsystem::hasWork() const {
+        return m_checkPending || m_networkTimePending;
+    }
+
+    void ScheduleSubsystem::work() {
+        if (m_networkTimePending) {
+            m_networkTimePending = false;
+            RealTimeClock::setTime(m_networkTime, RealTimeClock::Source::Network);
+            DEBUG("Clock set from network time");
+            publishClockState();
+        }
+
+        if (m_checkPending) {
+            m_checkPending = false;
+            runSchedule();
+            m_alarm.setTimeout(CheckScheduleEveryMs,
+                               [this](Alarm const&) {
+                                   m_checkPending = true;
+                               });
+        }
+    }
+
+    void ScheduleSubsystem::onNetworkTime(uint32_t const unixSeconds) {
+        if (instance == nullptr) {
+            return;
+        }
+        instance->m_networkTime = unixSeconds;
+        instance->m_networkTimePending = true;
+    }
+
+    void ScheduleSubsystem::startNetworkTime() const {
+        std::string_view const server = getWifiConfig().SntpServer;
+        if (server.empty()) {
+            INFO("No SNTP server configured, waiting for a client to set the clock");
+            return;
+        }
+        // The server name comes from a string literal, so it's null terminated and outlives the SNTP client
+        cyw43_arch_lwip_begin();
+        sntp_setoperatingmode(SNTP_OPMODE_POLL);
+        sntp_setservername(0, server.data());
+        sntp_init();
+        cyw43_arch_lwip_end();
+        INFO("Setting clock from SNTP server {}", server);
+    }
+
+    void ScheduleSubsystem::runSchedule() {
+        if (!RealTimeClock::valid()) {
+            return;
+        }
+
+        schedule_t const& schedule = m_storage->pendingData().schedule;
+        int64_t const localSeconds = static_cast<int64_t>(RealTimeClock::unixTime())
+                                     + static_cast<int64_t>(schedule.utcOffsetMinutes) * 60;
+        if (localSeconds < 0) {
+            return;
+        }
+        auto const localMinute = static_cast<uint64_t>(localSeconds / 60);
+
+        if (localMinute <= m_lastMinute && m_lastMinute - localMinute <= MaxMinutesToPlayOut) {
+            // Same minute, or the clock was nudged back a little, so wait for it to come back round
+            return;
+        }
+
+        if (m_lastMinute == 0 || localMinute < m_lastMinute || localMinute - m_lastMinute > MaxMinutesToPlayOut) {
+            catchUp(localMinute);
+        } else {
+            for (uint64_t minute = m_lastMinute + 1; minute <= localMinute; ++minute) {
+                auto const weekday = static_cast<uint8_t>((minute / MinutesPerDay + EpochWeekday) % 7);
+                auto const minuteOfDay = static_cast<uint16_t>(minute % MinutesPerDay);
+                for (schedule_entry_t const& entry : schedule.entries) {
+                    if (entry.used() && entry.firesOn(weekday) && entry.minuteOfDay == minuteOfDay) {
+                        fire(entry, false);
+                    }
+                }
+            }
+        }
+
+        m_lastMinute = localMinute;
+        publishClockState();
+    }
+
+    void ScheduleSubsystem::catchUp(uint64_t const localMinute) {
+        struct due_entry_t {
+            // Minutes relative to midnight today, so anything from yesterday is negative
+            int32_t minute;
+            uint8_t index;
+        };
+
+        schedule_t const& schedule = m_storage->pendingData().schedule;
+        auto const today = static_cast<uint8_t>((localMinute / MinutesPerDay + EpochWeekday) % 7);
+        auto const yesterday = static_cast<uint8_t>((today + 6) % 7);
+        auto const now = static_cast<int32_t>(localMinute % MinutesPerDay);
+
+        // Replay everything from the last 24 hours in order, so each output ends up where the schedule left it
+        std::array<due_entry_t, MaxScheduleEntries * 2> due {};
+        size_t dueCount = 0;
+        for (uint8_t index = 0; index < MaxScheduleEntries; ++index) {
+            schedule_entry_t const& entry = schedule.entries[index];
+            if (!entry.used()) {
+                continue;
+            }
+            if (entry.firesOn(today) && entry.minuteOfDay <= now) {
+                due[dueCount++] = {entry.minuteOfDay, index};
+            }
+            if (entry.firesOn(yesterday) && entry.minuteOfDay > now) {
+                due[dueCount++] = {entry.minuteOfDay - static_cast<int32_t>(MinutesPerDay), index};
+            }
+        }
+
+        std::sort(due.begin(),
+                  due.begin() + static_cast<ptrdiff_t>(dueCount),
+                  [](due_entry_t const& first, due_entry_t const& second) {
+                      return first.minute < second.minute
+                          || (first.minute == second.minute && first.index < second.index);
+                  });
+
+        DEBUG("Catching up on {} schedule entries", dueCount);
+        for (size_t position = 0; position < dueCount; ++position) {
+            fire(schedule.entries[due[position].index], true);
+        }
+    }
+
+    void ScheduleSubsystem::fire(schedule_entry_t const& entry, bool const catchingUp) {
+        DEBUG("Running schedule entry for {:02}:{:02}", entry.minuteOfDay / 60, entry.minuteOfDay % 60);
+        switch (entry.action) {
+        case schedule_entry_t::Action::RecallPreset:
+            m_lights->recallPreset(entry.presetSlot);
+            break;
+
+        case schedule_entry_t::Action::Transition:
+            for (uint8_t index = 0; index < OutputCount; ++index) {
+                if ((entry.outputMask & (1U << index)) == 0) {
+                    continue;
+                }
+                // When catching up, the fade is long over, so go straight to where it ended
+                m_lights->transitionOutput(index,
+                                           entry.kelvin,
+                                           entry.brightness,
+                                           entry.powerOn,
+                                           catchingUp ? 0 : entry.fadeMs);
+            }
+            break;
+        }
+    }
+
+    void ScheduleSubsystem::publishClockState() const {
+        // RealTimeClock::Source and ClockSource list the sources in the same order
+        auto const source = static_cast<ClockSource>(RealTimeClock::source());
+        uint64_t const unixTime = RealTimeClock::unixTime();
+        m_wifi->updateStateData([source, unixTime](SystemState& state) {
+            state.mutable_clock().set_source(source);
+            state.mutable_clock().set_unixTime(unixTime);
+        });
+    }
+
+    CommandResult ScheduleSubsystem::processScheduleCommand(ScheduleCommand const& scheduleCommand) {
+        CommandResult response;
+        m_storage->updatePendingData([&scheduleCommand](save_data_t& saveData) {
+            saveData.schedule = scheduleCommand.schedule();
+        });
+        DEBUG("Updated schedule");
+        response.set_result(CommandResult::Result::OK);
+        return response;
+    }
+
+    CommandResult ScheduleSubsystem::processSetTime(uint64_t const unixSeconds) {
+        CommandResult response;
+        RealTimeClock::setTime(unixSeconds, RealTimeClock::Source::Client);
+        DEBUG("Clock set by client");
+        publishClockState();
+        response.set_result(CommandResult::Result::OK);
+        return response;
+    }
+}
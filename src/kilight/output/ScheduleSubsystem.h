@@ -0,0 +1,96 @@
+/**
+ * ScheduleSubsystem.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include <mpf/core/Logging.h>
+#include <mpf/core/Subsystem.h>
+
+#include <kilight/protocol/ScheduleCommand.h>
+
+#include "kilight/core/Alarm.h"
+#include "kilight/com/WifiSubsystem.h"
+#include "kilight/output/LightSubsystem.h"
+#include "kilight/output/schedule_data.h"
+#include "kilight/storage/StorageSubsystem.h"
+
+namespace kilight::output {
+
+    /**
+     * Runs the schedule stored on the device against the real time clock, so the lights keep to it without anything
+     * on the network.
+     */
+    class ScheduleSubsystem final : public mpf::core::Subsystem {
+        LOGGER(Schedule);
+
+    public:
+        static constexpr uint32_t CheckScheduleEveryMs = 1000;
+
+        // Missing more than this many minutes (the clock was set, or jumped) catches up on the day so far instead of
+        // playing out each minute in between
+        static constexpr uint16_t MaxMinutesToPlayOut = 5;
+
+        // 1970-01-01 was a Thursday
+        static constexpr uint8_t EpochWeekday = 4;
+
+        ScheduleSubsystem(mpf::core::SubsystemList* list,
+                          storage::StorageSubsystem* storageSubsystem,
+                          com::WifiSubsystem* wifiSubsystem,
+                          LightSubsystem* lightSubsystem);
+
+        ~ScheduleSubsystem() override = default;
+
+        void initialize() override;
+
+        void setUp() override;
+
+        [[nodiscard]]
+        bool hasWork() const override;
+
+        void work() override;
+
+        /**
+         * Called by lwIP's SNTP client, in the lwIP context.
+         */
+        static void onNetworkTime(uint32_t unixSeconds);
+
+    private:
+        static inline ScheduleSubsystem* instance = nullptr;
+
+        storage::StorageSubsystem* const m_storage;
+
+        com::WifiSubsystem* const m_wifi;
+
+        LightSubsystem* const m_lights;
+
+        core::Alarm m_alarm;
+
+        bool volatile m_checkPending = false;
+
+        uint32_t volatile m_networkTime = 0;
+
+        bool volatile m_networkTimePending = false;
+
+        // Local minutes since the epoch that the schedule has been run up to, 0 until the clock is set
+        uint64_t m_lastMinute = 0;
+
+        void startNetworkTime() const;
+
+        void runSchedule();
+
+        void catchUp(uint64_t localMinute);
+
+        void fire(schedule_entry_t const& entry, bool catchingUp);
+
+        void publishClockState() const;
+
+        protocol::CommandResult processScheduleCommand(protocol::ScheduleCommand const& scheduleCommand);
+
+        protocol::CommandResult processSetTime(uint64_t unixSeconds);
+    };
+}
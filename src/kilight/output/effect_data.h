@@ -0,0 +1,92 @@
+/**
+ * effect_data.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <algorithm>
+// ReSharper disable once CppUnusedIncludeDirective
+#include <compare>
+
+#include <mpf/util/macros.h>
+
+#include <kilight/protocol/EffectProgram.h>
+
+#include "kilight/output/rgbcw_color.h"
+
+namespace kilight::output {
+    static constexpr uint8_t MaxEffectPrograms = 4;
+
+    static constexpr uint8_t MaxEffectKeyframes = 8;
+
+    struct PACKED effect_keyframe_t {
+        // Color to move to by the end of this keyframe
+        rgbcw_color_t color {};
+
+        // Time taken to move from the previous keyframe's color to this one
+        uint32_t durationMs = 0;
+
+        // Up to this many milliseconds are randomly added to the duration every time the keyframe is played
+        uint16_t durationJitterMs = 0;
+
+        // Up to this much (out of 255) is randomly taken off the keyframe's brightness every time it is played
+        uint8_t brightnessJitter = 0;
+
+        constexpr auto operator<=>(effect_keyframe_t const& other) const noexcept = default;
+    };
+
+    struct PACKED effect_program_t {
+        std::array<effect_keyframe_t, MaxEffectKeyframes> keyframes {};
+
+        uint8_t keyframeCount = 0;
+
+        // Number of times to play through the keyframes before stopping, 0 to loop until stopped
+        uint8_t loopCount = 0;
+
+        constexpr auto operator<=>(effect_program_t const& other) const noexcept = default;
+
+        [[nodiscard]]
+        bool empty() const {
+            return keyframeCount == 0;
+        }
+
+        effect_program_t& operator=(protocol::EffectProgram const& protocolProgram) {
+            keyframeCount = static_cast<uint8_t>(std::min<uint32_t>(protocolProgram.keyframes().get_length(),
+                                                                    MaxEffectKeyframes));
+            for (uint8_t index = 0; index < MaxEffectKeyframes; ++index) {
+                if (index >= keyframeCount) {
+                    keyframes[index] = effect_keyframe_t{};
+                    continue;
+                }
+                auto const& protocolKeyframe = protocolProgram.keyframes()[index];
+                keyframes[index].color = protocolKeyframe.color();
+                keyframes[index].durationMs = protocolKeyframe.durationMs();
+                keyframes[index].durationJitterMs = static_cast<uint16_t>(
+                    std::min<uint32_t>(protocolKeyframe.durationJitterMs(), UINT16_MAX));
+                keyframes[index].brightnessJitter = static_cast<uint8_t>(
+                    std::min<uint32_t>(protocolKeyframe.brightnessJitter(), UINT8_MAX));
+            }
+            loopCount = static_cast<uint8_t>(std::min<uint32_t>(protocolProgram.loopCount(), UINT8_MAX));
+            return *this;
+        }
+
+        [[nodiscard]]
+        protocol::EffectProgram toEffectProgram() const {
+            protocol::EffectProgram program;
+            for (uint8_t index = 0; index < keyframeCount; ++index) {
+                protocol::EffectKeyframe keyframe;
+                keyframe.set_color(keyframes[index].color.toColor());
+                keyframe.set_durationMs(keyframes[index].durationMs);
+                keyframe.set_durationJitterMs(keyframes[index].durationJitterMs);
+                keyframe.set_brightnessJitter(keyframes[index].brightnessJitter);
+                program.mutable_keyframes().add(keyframe);
+            }
+            program.set_loopCount(loopCount);
+            return program;
+        }
+    };
+}
@@ -0,0 +1,117 @@
+/**
+ * output_config.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+// ReSharper disable once CppUnusedIncludeDirective
+#include <compare>
+
+#include <mpf/util/macros.h>
+
+#include <kilight/protocol/ConfigureOutput.h>
+#include <kilight/protocol/FixtureCalibration.h>
+
+#include "kilight/hw/Pin.h"
+
+namespace kilight::output {
+
+    // Chromaticity coordinates are stored as integers, in units of 1/ChromaticityScale
+    static constexpr uint16_t ChromaticityScale = 10000;
+
+    // As low as the Planckian locus fit ColorConverter places the whites with goes, anything warmer would be clamped
+    static constexpr uint16_t MinWhiteKelvin = 1667;
+
+    static constexpr uint16_t MaxWhiteKelvin = 20000;
+
+    // Highest current limit an output can be given. It has to stay under the hard overcurrent trip in
+    // CurrentMonitorSubsystem, or the limiter would never get the chance to act before the trip.
+    static constexpr uint16_t MaxOutputCurrentLimitMilliAmps = 7500;
+
+    struct PACKED fixture_calibration_t {
+        // Correlated colour temperature of each white channel
+        uint16_t coldWhiteKelvin = 6500;
+        uint16_t warmWhiteKelvin = 2700;
+
+        // Light output of each channel at full duty. Only the ratios matter, so any consistent unit will do.
+        uint16_t redLumens = 60;
+        uint16_t greenLumens = 150;
+        uint16_t blueLumens = 30;
+        uint16_t coldWhiteLumens = 200;
+        uint16_t warmWhiteLumens = 180;
+
+        // CIE 1931 xy chromaticity of each colour channel
+        uint16_t redX = 6900;
+        uint16_t redY = 3000;
+        uint16_t greenX = 1700;
+        uint16_t greenY = 7000;
+        uint16_t blueX = 1350;
+        uint16_t blueY = 400;
+
+        constexpr auto operator<=>(fixture_calibration_t const& other) const noexcept = default;
+
+        [[nodiscard]]
+        constexpr bool valid() const {
+            return coldWhiteKelvin >= MinWhiteKelvin && coldWhiteKelvin <= MaxWhiteKelvin
+                && warmWhiteKelvin >= MinWhiteKelvin && warmWhiteKelvin <= MaxWhiteKelvin
+                && coldWhiteKelvin > warmWhiteKelvin
+                && redLumens > 0 && greenLumens > 0 && blueLumens > 0
+                && coldWhiteLumens > 0 && warmWhiteLumens > 0
+                && redY > 0 && greenY > 0 && blueY > 0
+                && redX + redY <= ChromaticityScale
+                && greenX + greenY <= ChromaticityScale
+                && blueX + blueY <= ChromaticityScale;
+        }
+
+        fixture_calibration_t& operator=(protocol::FixtureCalibration const& protocolCalibration) {
+            coldWhiteKelvin = toUint16(protocolCalibration.coldWhiteKelvin());
+            warmWhiteKelvin = toUint16(protocolCalibration.warmWhiteKelvin());
+            redLumens = toUint16(protocolCalibration.redLumens());
+            greenLumens = toUint16(protocolCalibration.greenLumens());
+            blueLumens = toUint16(protocolCalibration.blueLumens());
+            coldWhiteLumens = toUint16(protocolCalibration.coldWhiteLumens());
+            warmWhiteLumens = toUint16(protocolCalibration.warmWhiteLumens());
+            redX = toUint16(protocolCalibration.redX());
+            redY = toUint16(protocolCalibration.redY());
+            greenX = toUint16(protocolCalibration.greenX());
+            greenY = toUint16(protocolCalibration.greenY());
+            blueX = toUint16(protocolCalibration.blueX());
+            blueY = toUint16(protocolCalibration.blueY());
+            return *this;
+        }
+
+    private:
+        static constexpr uint16_t toUint16(uint32_t const value) {
+            return static_cast<uint16_t>(std::min<uint32_t>(value, UINT16_MAX));
+        }
+    };
+
+    struct PACKED output_config_t {
+        fixture_calibration_t calibration {};
+
+        hw::PWMPhaseMode pwmPhaseMode = hw::PWMPhaseMode::Aligned;
+
+        // Brightness is scaled back to hold the measured current under this
+        uint16_t currentLimitMilliAmps = MaxOutputCurrentLimitMilliAmps;
+
+        constexpr auto operator<=>(output_config_t const& other) const noexcept = default;
+
+        output_config_t& operator=(protocol::ConfigureOutput const& configureOutput) {
+            calibration = configureOutput.calibration();
+            pwmPhaseMode = configureOutput.pwmPhaseMode() == protocol::PWMPhaseMode::Staggered
+                               ? hw::PWMPhaseMode::Staggered
+                               : hw::PWMPhaseMode::Aligned;
+            // 0 means no limit of its own, which still leaves the most the hardware allows
+            currentLimitMilliAmps = configureOutput.currentLimitMilliAmps() == 0
+                                        ? MaxOutputCurrentLimitMilliAmps
+                                        : static_cast<uint16_t>(std::min<uint32_t>(
+                                            configureOutput.currentLimitMilliAmps(),
+                                            MaxOutputCurrentLimitMilliAmps));
+            return *this;
+        }
+    };
+}
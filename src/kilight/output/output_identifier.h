@@ -0,0 +1,51 @@
+/**
+ * output_identifier.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#include <kilight/protocol/OutputIdentifier.h>
+
+#include "kilight/conf/HardwareConfig.h"
+
+namespace kilight::output {
+    static constexpr uint8_t OutputCount = conf::HardwareConfig::OutputCount;
+
+    // Protocol identifier of each output, by index
+    static constexpr std::array<protocol::OutputIdentifier, conf::HardwareConfig::MaxOutputCount> OutputIdentifiers {
+        protocol::OutputIdentifier::OutputA,
+        protocol::OutputIdentifier::OutputB,
+        protocol::OutputIdentifier::OutputC,
+        protocol::OutputIdentifier::OutputD
+    };
+
+    /**
+     * @return Index of the output with the given identifier, or nothing if the board doesn't have that output
+     */
+    [[nodiscard]]
+    constexpr std::optional<uint8_t> outputIndexFor(protocol::OutputIdentifier const outputId) {
+        for (uint8_t index = 0; index < OutputCount; ++index) {
+            if (OutputIdentifiers[index] == outputId) {
+                return index;
+            }
+        }
+        return std::nullopt;
+    }
+
+    [[nodiscard]]
+    constexpr protocol::OutputIdentifier outputIdentifierFor(uint8_t const outputIndex) {
+        return OutputIdentifiers[outputIndex];
+    }
+
+    // Letter the output is labelled with on the board
+    [[nodiscard]]
+    constexpr char outputName(uint8_t const outputIndex) {
+        return static_cast<char>('A' + outputIndex);
+    }
+}
@@ -0,0 +1,85 @@
+/**
+ * preset_data.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+// ReSharper disable once CppUnusedIncludeDirective
+#include <compare>
+
+#include <mpf/util/macros.h>
+
+#include <kilight/protocol/Preset.h>
+
+#include "kilight/output/output_data.h"
+#include "kilight/output/output_identifier.h"
+
+namespace kilight::output {
+    static constexpr uint8_t MaxPresets = 32;
+
+    struct PACKED preset_t {
+        std::array<output_data_t, OutputCount> outputs {};
+
+        // Bit per output index, outputs left out of the preset are left alone when it's recalled
+        uint8_t outputMask = 0;
+
+        // How long recalled outputs take to fade to the preset, 0 for the normal fade
+        uint32_t fadeMs = 0;
+
+        constexpr auto operator<=>(preset_t const& other) const noexcept = default;
+
+        [[nodiscard]]
+        bool empty() const {
+            return outputMask == 0;
+        }
+
+        [[nodiscard]]
+        bool includes(uint8_t const outputIndex) const {
+            return (outputMask & (1U << outputIndex)) != 0;
+        }
+
+        preset_t& operator=(protocol::Preset const& protocolPreset) {
+            outputMask = 0;
+            outputs = {};
+            for (auto const& protocolOutput : protocolPreset.outputs()) {
+                std::optional<uint8_t> const index = outputIndexFor(protocolOutput.outputId());
+                if (!index.has_value()) {
+                    continue;
+                }
+                outputs[*index].color = protocolOutput.color();
+                outputs[*index].brightnessMultiplier = static_cast<uint8_t>(
+                    std::min<uint32_t>(protocolOutput.brightness(), UINT8_MAX));
+                outputs[*index].powerOn = protocolOutput.on();
+                outputMask |= static_cast<uint8_t>(1U << *index);
+            }
+            fadeMs = protocolPreset.fadeMs();
+            return *this;
+        }
+
+        [[nodiscard]]
+        protocol::Preset toPreset() const {
+            protocol::Preset preset;
+            for (uint8_t index = 0; index < OutputCount; ++index) {
+                if (!includes(index)) {
+                    continue;
+                }
+                protocol::PresetOutput output;
+                output.set_outputId(outputIdentifierFor(index));
+                output.set_color(outputs[index].color.toColor());
+                output.set_brightness(outputs[index].brightnessMultiplier);
+                output.set_on(static_cast<bool>(outputs[index].powerOn));
+                preset.mutable_outputs().add(output);
+            }
+            preset.set_fadeMs(fadeMs);
+            return preset;
+        }
+    };
+
+    static_assert(OutputCount <= 8, "preset_t::outputMask has a bit per output");
+}
@@ -0,0 +1,115 @@
+/**
+ * render_data.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "kilight/com/stream_data.h"
+#include "kilight/output/effect_data.h"
+#include "kilight/output/output_identifier.h"
+#include "kilight/output/rgbcw_color.h"
+
+namespace kilight::output {
+
+    static constexpr uint8_t MaxQueuedTransitions = 8;
+
+    struct render_transition_t {
+        // Already scaled by brightness, and black for a step that turns the output off
+        rgbcw_color_t target {};
+
+        uint32_t fadeMs = 0;
+
+        // How long to stay at the target before moving on to the next transition
+        uint32_t holdMs = 0;
+    };
+
+    struct render_command_t {
+        enum class Type : uint8_t {
+            SetTarget,
+            StartEffect,
+            QueueTransitions,
+            // Stops any effect and clears any queued transitions
+            StopPlayback
+        };
+
+        Type type = Type::SetTarget;
+
+        uint8_t outputIndex = 0;
+
+        // SetTarget: color to fade to, already scaled by brightness
+        rgbcw_color_t target {};
+
+        // SetTarget: brightness effects are scaled by
+        uint8_t brightness = 0;
+
+        // SetTarget: turning an output off also stops any effect on it
+        bool powerOn = false;
+
+        // SetTarget: scales everything written to the output, to keep it inside its power budget
+        uint8_t limit = UINT8_MAX;
+
+        // SetTarget: thermal brightness ceiling. Unlike the limit, the output fades to this gradually.
+        uint8_t derate = UINT8_MAX;
+
+        // SetTarget: how long the fade to a new target takes, 0 to step one level per tick as usual
+        uint32_t fadeMs = 0;
+
+        // StartEffect
+        uint8_t effectSlot = 0;
+
+        // StartEffect
+        uint32_t effectSeed = 0;
+
+        // StartEffect: copied so core 1 never reads save data that core 0 might be changing
+        effect_program_t effect {};
+
+        // QueueTransitions
+        std::array<render_transition_t, MaxQueuedTransitions> transitions {};
+
+        // QueueTransitions: transitions past what the queue has room for are dropped
+        uint8_t transitionCount = 0;
+
+        // QueueTransitions: clear the queue first, rather than adding on to the end of it
+        bool replaceTransitions = false;
+
+        // QueueTransitions: echoed back in the status once core 1 has the transitions
+        uint8_t transitionSequence = 0;
+    };
+
+    struct render_output_status_t {
+        rgbcw_color_t current {};
+
+        // Last levels written to the PWM, after the limit and thermal derating
+        rgbcw_color_t levels {};
+
+        uint8_t effectSlot = 0;
+
+        bool effectRunning = false;
+
+        uint8_t queuedTransitions = 0;
+
+        // Sequence of the last QueueTransitions command core 1 took in
+        uint8_t transitionSequence = 0;
+    };
+
+    struct render_status_t {
+        std::array<render_output_status_t, OutputCount> outputs {};
+
+        // Totals since boot, so readers can work out averages over whatever period they like
+        uint64_t streamRenderJitterSumUs = 0;
+
+        uint32_t streamFramesRendered = 0;
+
+        uint32_t streamFramesLate = 0;
+
+        // Worst render jitter over roughly the last second
+        uint32_t streamRenderJitterMaxUs = 0;
+
+        bool streaming = false;
+    };
+}
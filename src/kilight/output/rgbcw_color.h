@@ -6,10 +6,12 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <concepts>
 #include <limits>
 #include <format>
+#include <type_traits>
 
 // ReSharper disable once CppUnusedIncludeDirective
 #include <compare>
@@ -23,12 +25,16 @@
 namespace kilight::output {
     template <std::unsigned_integral ColorDataT>
     struct PACKED rgbcw_color_base_t {
+        using ValueT = std::remove_cv_t<ColorDataT>;
+
         ColorDataT red = 0U;
         ColorDataT green = 0U;
         ColorDataT blue = 0U;
         ColorDataT coldWhite = 0U;
         ColorDataT warmWhite = 0U;
 
+        static constexpr uint8_t ChannelCount = 5;
+
         rgbcw_color_base_t() = default;
 
         constexpr rgbcw_color_base_t(ColorDataT const red,
@@ -52,7 +58,23 @@ namespace kilight::output {
             warmWhite(other.warmWhite) {
         }
 
-        constexpr auto operator<=>(rgbcw_color_base_t const& other) const noexcept = default;
+        /**
+         * @param channel Channel index, in the usual red, green, blue, cold white, warm white order
+         * @param value Level for that channel, every other channel is left at 0
+         */
+        static constexpr rgbcw_color_base_t singleChannel(uint8_t const channel, ValueT const value) {
+            return rgbcw_color_base_t{
+                    channel == 0 ? value : ValueT{0},
+                    channel == 1 ? value : ValueT{0},
+                    channel == 2 ? value : ValueT{0},
+                    channel == 3 ? value : ValueT{0},
+                    channel == 4 ? value : ValueT{0}
+                };
+        }
+
+        __force_inline constexpr auto operator<=>(rgbcw_color_base_t const& other) const noexcept = default;
+
+        __force_inline constexpr bool operator==(rgbcw_color_base_t const& other) const noexcept = default;
 
         rgbcw_color_base_t& operator=(protocol::Color const& protocolColor) {
             red = static_cast<uint8_t>(protocolColor.red());
@@ -85,16 +107,44 @@ namespace kilight::output {
         }
 
         template <typename OtherColorT>
-        void incrementTowards(OtherColorT const& other) {
-            red = util::MathUtil::incrementBetween(red, other.red);
-            green = util::MathUtil::incrementBetween(green, other.green);
-            blue = util::MathUtil::incrementBetween(blue, other.blue);
-            coldWhite = util::MathUtil::incrementBetween(coldWhite, other.coldWhite);
-            warmWhite = util::MathUtil::incrementBetween(warmWhite, other.warmWhite);
+        constexpr __force_inline void incrementTowards(OtherColorT const& other) {
+            red = util::MathUtil::incrementBetween<ValueT>(red, other.red);
+            green = util::MathUtil::incrementBetween<ValueT>(green, other.green);
+            blue = util::MathUtil::incrementBetween<ValueT>(blue, other.blue);
+            coldWhite = util::MathUtil::incrementBetween<ValueT>(coldWhite, other.coldWhite);
+            warmWhite = util::MathUtil::incrementBetween<ValueT>(warmWhite, other.warmWhite);
+        }
+
+        template <typename ReturnT = rgbcw_color_base_t, typename OtherColorT>
+        __force_inline ReturnT interpolatedTowards(OtherColorT const& other, uint32_t const position, uint32_t const length) const {
+            return ReturnT{
+                    util::MathUtil::interpolate<ValueT>(red, other.red, position, length),
+                    util::MathUtil::interpolate<ValueT>(green, other.green, position, length),
+                    util::MathUtil::interpolate<ValueT>(blue, other.blue, position, length),
+                    util::MathUtil::interpolate<ValueT>(coldWhite, other.coldWhite, position, length),
+                    util::MathUtil::interpolate<ValueT>(warmWhite, other.warmWhite, position, length)
+                };
         }
 
         template <typename ReturnT = rgbcw_color_base_t, std::unsigned_integral IntermediateCalculationT = uint32_t>
-        ReturnT scaledBy(ColorDataT const scaleFactor) const {
+        constexpr __force_inline ReturnT scaledBy(ValueT const scaleFactor) const {
+            if constexpr (std::numeric_limits<ValueT>::max() == std::numeric_limits<uint8_t>::max()) {
+                // Four channels go through one SWAR multiply, the fifth through the same arithmetic on its own.
+                // Each channel is read exactly once, which matters when they're volatile.
+                uint64_t const lanes = static_cast<uint64_t>(red)
+                                       | static_cast<uint64_t>(green) << 16U
+                                       | static_cast<uint64_t>(blue) << 32U
+                                       | static_cast<uint64_t>(coldWhite) << 48U;
+                uint64_t const scaled = util::MathUtil::scaleLanesBy255(lanes, scaleFactor);
+                return ReturnT{
+                        static_cast<ValueT>(scaled),
+                        static_cast<ValueT>(scaled >> 16U),
+                        static_cast<ValueT>(scaled >> 32U),
+                        static_cast<ValueT>(scaled >> 48U),
+                        static_cast<ValueT>(util::MathUtil::divideBy255Rounded(
+                            static_cast<uint32_t>(warmWhite) * scaleFactor))
+                    };
+            }
             return ReturnT{
                     static_cast<ColorDataT>(static_cast<IntermediateCalculationT>(red)
                                             * static_cast<IntermediateCalculationT>(scaleFactor)
@@ -113,12 +163,41 @@ namespace kilight::output {
                                             / std::numeric_limits<ColorDataT>::max())
                 };
         }
+
+        /**
+         * Undoes scaledBy(), to the nearest level. Scaling the result back by the same factor gives this colour again
+         * exactly, as long as no channel is above the factor, which no channel scaled by it can be.
+         *
+         * @param scaleFactor Factor this colour was scaled by, a colour scaled by 0 comes back black
+         */
+        template <typename ReturnT = rgbcw_color_base_t>
+        constexpr ReturnT unscaledBy(ValueT const scaleFactor) const {
+            auto const unscale = [scaleFactor](uint32_t const channel) {
+                if (scaleFactor == 0) {
+                    return ValueT{0};
+                }
+                uint32_t constexpr Max = std::numeric_limits<ValueT>::max();
+                return static_cast<ValueT>(std::min<uint32_t>((channel * Max + scaleFactor / 2U) / scaleFactor, Max));
+            };
+            return ReturnT{
+                    unscale(red),
+                    unscale(green),
+                    unscale(blue),
+                    unscale(coldWhite),
+                    unscale(warmWhite)
+                };
+        }
     };
 
     using rgbcw_color_t = rgbcw_color_base_t<uint8_t>;
 
     using rgbcw_color_volatile_t = rgbcw_color_base_t<uint8_t volatile>;
 
+    static_assert(rgbcw_color_t{255, 128, 1, 0, 64}.scaledBy(255) == rgbcw_color_t{255, 128, 1, 0, 64});
+    static_assert(rgbcw_color_t{255, 128, 1, 0, 64}.scaledBy(128) == rgbcw_color_t{128, 64, 1, 0, 32});
+    static_assert(rgbcw_color_t{255, 128, 1, 0, 64}.scaledBy(0) == rgbcw_color_t{});
+    static_assert(rgbcw_color_t{128, 64, 1, 0, 32}.unscaledBy(128) == rgbcw_color_t{255, 128, 2, 0, 64});
+
 
     template <class ColorT, class CharT>
     struct formatter_base {
@@ -0,0 +1,137 @@
+/**
+ * schedule_data.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+// ReSharper disable once CppUnusedIncludeDirective
+#include <compare>
+
+#include <mpf/util/macros.h>
+
+#include <kilight/protocol/Schedule.h>
+
+namespace kilight::output {
+    static constexpr uint8_t MaxScheduleEntries = 24;
+
+    static constexpr uint16_t MinutesPerDay = 24 * 60;
+
+    struct PACKED schedule_entry_t {
+        enum class Action : uint8_t {
+            Transition,
+            RecallPreset
+        };
+
+        // Local time the entry fires at
+        uint16_t minuteOfDay = 0;
+
+        // Bit per weekday, with Sunday in bit 0. Entries with no days are unused.
+        uint8_t dayMask = 0;
+
+        // Transition: bit per output index
+        uint8_t outputMask = 0;
+
+        Action action = Action::Transition;
+
+        // Transition: colour temperature to fade to, 0 leaves the colour alone
+        uint16_t kelvin = 0;
+
+        // Transition
+        uint8_t brightness = 0;
+
+        // Transition
+        bool powerOn = false;
+
+        // Transition: how long the fade takes, so a sunrise can take half an hour
+        uint32_t fadeMs = 0;
+
+        // RecallPreset
+        uint8_t presetSlot = 0;
+
+        constexpr auto operator<=>(schedule_entry_t const& other) const noexcept = default;
+
+        [[nodiscard]]
+        bool used() const {
+            return dayMask != 0;
+        }
+
+        [[nodiscard]]
+        bool firesOn(uint8_t const weekday) const {
+            return (dayMask & (1U << weekday)) != 0;
+        }
+
+        schedule_entry_t& operator=(protocol::ScheduleEntry const& protocolEntry) {
+            minuteOfDay = static_cast<uint16_t>(std::min<uint32_t>(protocolEntry.minuteOfDay(), MinutesPerDay - 1));
+            dayMask = static_cast<uint8_t>(protocolEntry.dayMask() & 0x7FU);
+            outputMask = static_cast<uint8_t>(std::min<uint32_t>(protocolEntry.outputMask(), UINT8_MAX));
+            action = protocolEntry.action() == protocol::ScheduleEntry::Action::RecallPreset
+                         ? Action::RecallPreset
+                         : Action::Transition;
+            kelvin = static_cast<uint16_t>(std::min<uint32_t>(protocolEntry.kelvin(), UINT16_MAX));
+            brightness = static_cast<uint8_t>(std::min<uint32_t>(protocolEntry.brightness(), UINT8_MAX));
+            powerOn = protocolEntry.on();
+            fadeMs = protocolEntry.fadeMs();
+            presetSlot = static_cast<uint8_t>(std::min<uint32_t>(protocolEntry.presetSlot(), UINT8_MAX));
+            return *this;
+        }
+
+        [[nodiscard]]
+        protocol::ScheduleEntry toScheduleEntry() const {
+            protocol::ScheduleEntry entry;
+            entry.set_minuteOfDay(minuteOfDay);
+            entry.set_dayMask(dayMask);
+            entry.set_outputMask(outputMask);
+            entry.set_action(action == Action::RecallPreset
+                                 ? protocol::ScheduleEntry::Action::RecallPreset
+                                 : protocol::ScheduleEntry::Action::Transition);
+            entry.set_kelvin(kelvin);
+            entry.set_brightness(brightness);
+            entry.set_on(powerOn);
+            entry.set_fadeMs(fadeMs);
+            entry.set_presetSlot(presetSlot);
+            return entry;
+        }
+    };
+
+    struct PACKED schedule_t {
+        std::array<schedule_entry_t, MaxScheduleEntries> entries {};
+
+        // Offset of local time from UTC, daylight saving included. The client keeps it current when it changes.
+        int16_t utcOffsetMinutes = 0;
+
+        constexpr auto operator<=>(schedule_t const& other) const noexcept = default;
+
+        schedule_t& operator=(protocol::Schedule const& protocolSchedule) {
+            auto const entryCount = static_cast<uint8_t>(std::min<uint32_t>(protocolSchedule.entries().get_length(),
+                                                                            MaxScheduleEntries));
+            for (uint8_t index = 0; index < MaxScheduleEntries; ++index) {
+                if (index >= entryCount) {
+                    entries[index] = schedule_entry_t{};
+                    continue;
+                }
+                entries[index] = protocolSchedule.entries()[index];
+            }
+            utcOffsetMinutes = static_cast<int16_t>(std::clamp<int32_t>(protocolSchedule.utcOffsetMinutes(),
+                                                                        -static_cast<int32_t>(MinutesPerDay),
+                                                                        MinutesPerDay));
+            return *this;
+        }
+
+        [[nodiscard]]
+        protocol::Schedule toSchedule() const {
+            protocol::Schedule schedule;
+            for (schedule_entry_t const& entry : entries) {
+                if (entry.used()) {
+                    schedule.mutable_entries().add(entry.toScheduleEntry());
+                }
+            }
+            schedule.set_utcOffsetMinutes(utcOffsetMinutes);
+            return schedule;
+        }
+    };
+}
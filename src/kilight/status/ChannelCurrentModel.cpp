@@ -0,0 +1,103 @@
+/**
+ * ChannelCurrentModel.cpp
+ *
+ * @author Patrick Lavigne
+ */
+
+#include "kilight/status/ChannelCurrentModel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace kilight::status {
+
+    void ChannelCurrentModel::setPrior(current_model_t const& prior) {
+        m_prior[0] = static_cast<float>(prior.offsetMilliAmps);
+        for (uint8_t channel = 0; channel < ModelChannelCount; ++channel) {
+            m_prior[channel + 1] = static_cast<float>(prior.channelMilliAmps[channel]);
+        }
+    }
+
+    void ChannelCurrentModel::reset() {
+        m_gram = {};
+        m_moments = {};
+        m_sampleCount = 0;
+    }
+
+    void ChannelCurrentModel::addSample(output::rgbcw_color_t const& levels, uint32_t const milliAmps) {
+        terms_t const terms = termsFor(levels);
+        auto const measured = static_cast<float>(milliAmps);
+        for (uint8_t row = 0; row < TermCount; ++row) {
+            for (uint8_t column = 0; column < TermCount; ++column) {
+                m_gram[row][column] = m_gram[row][column] * ForgettingFactor + terms[row] * terms[column];
+            }
+            m_moments[row] = m_moments[row] * ForgettingFactor + terms[row] * measured;
+        }
+        ++m_sampleCount;
+    }
+
+    uint32_t ChannelCurrentModel::sampleCount() const {
+        return m_sampleCount;
+    }
+
+    current_model_t ChannelCurrentModel::fit(float const priorWeight) const {
+        // Solves (G + wI) x = m + w * prior by Gaussian elimination. The prior term keeps it well conditioned.
+        std::array<terms_t, TermCount> matrix = m_gram;
+        terms_t solution {};
+        for (uint8_t row = 0; row < TermCount; ++row) {
+            matrix[row][row] += priorWeight;
+            solution[row] = m_moments[row] + priorWeight * m_prior[row];
+        }
+
+        for (uint8_t pivot = 0; pivot < TermCount; ++pivot) {
+            uint8_t best = pivot;
+            for (uint8_t row = pivot + 1; row < TermCount; ++row) {
+                if (std::fabs(matrix[row][pivot]) > std::fabs(matrix[best][pivot])) {
+                    best = row;
+                }
+            }
+            std::swap(matrix[pivot], matrix[best]);
+            std::swap(solution[pivot], solution[best]);
+
+            for (uint8_t row = pivot + 1; row < TermCount; ++row) {
+                float const factor = matrix[row][pivot] / matrix[pivot][pivot];
+                for (uint8_t column = pivot; column < TermCount; ++column) {
+                    matrix[row][column] -= factor * matrix[pivot][column];
+                }
+                solution[row] -= factor * solution[pivot];
+            }
+        }
+
+        for (int row = TermCount - 1; row >= 0; --row) {
+            for (uint8_t column = row + 1; column < TermCount; ++column) {
+                solution[row] -= matrix[row][column] * solution[column];
+            }
+            solution[row] /= matrix[row][row];
+        }
+
+        current_model_t model;
+        model.offsetMilliAmps = static_cast<int16_t>(std::clamp(std::lround(solution[0]),
+                                                                static_cast<long>(INT16_MIN),
+                                                                static_cast<long>(INT16_MAX)));
+        for (uint8_t channel = 0; channel < ModelChannelCount; ++channel) {
+            // A channel can't give current back, so a negative share is only noise
+            model.channelMilliAmps[channel] = static_cast<uint16_t>(std::clamp(std::lround(solution[channel + 1]),
+                                                                               0L,
+                                                                               static_cast<long>(UINT16_MAX)));
+        }
+        return model;
+    }
+
+    ChannelCurrentModel::terms_t ChannelCurrentModel::termsFor(output::rgbcw_color_t const& levels) {
+        constexpr float FullDuty = UINT8_MAX;
+        return {
+            1.0f,
+            static_cast<float>(levels.red) / FullDuty,
+            static_cast<float>(levels.green) / FullDuty,
+            static_cast<float>(levels.blue) / FullDuty,
+            static_cast<float>(levels.coldWhite) / FullDuty,
+            static_cast<float>(levels.warmWhite) / FullDuty
+        };
+    }
+}
@@ -0,0 +1,64 @@
+/**
+ * ChannelCurrentModel.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "kilight/output/rgbcw_color.h"
+#include "kilight/status/current_model_data.h"
+
+namespace kilight::status {
+
+    /**
+     * Fits an output's current as an offset plus a share per channel proportional to its duty, from the one shunt
+     * reading the output has. Least squares over recent samples, held towards a prior so that directions the samples
+     * don't cover (like a scene that never changes) stay where the prior has them rather than wandering off.
+     */
+    class ChannelCurrentModel final {
+    public:
+        // Offset plus one per channel
+        static constexpr uint8_t TermCount = ModelChannelCount + 1;
+
+        // How much each sample's weight shrinks by for every sample after it
+        static constexpr float ForgettingFactor = 0.995f;
+
+        // Weight of the prior, in samples, for the running fit
+        static constexpr float PriorWeight = 5.0f;
+
+        // Weight of the prior for a calibration fit, where the samples are there to replace it. Each channel is only
+        // lit for a sixth of the sequence while the offset is in every sample, so even 0.01 would pull the shares a
+        // few milliamps towards the prior. This is still enough to keep the solve well conditioned.
+        static constexpr float CalibrationPriorWeight = 0.0001f;
+
+        void setPrior(current_model_t const& prior);
+
+        void reset();
+
+        void addSample(output::rgbcw_color_t const& levels, uint32_t milliAmps);
+
+        [[nodiscard]]
+        uint32_t sampleCount() const;
+
+        [[nodiscard]]
+        current_model_t fit(float priorWeight = PriorWeight) const;
+
+    private:
+        using terms_t = std::array<float, TermCount>;
+
+        std::array<terms_t, TermCount> m_gram {};
+
+        terms_t m_moments {};
+
+        terms_t m_prior {};
+
+        uint32_t m_sampleCount = 0;
+
+        static terms_t termsFor(output::rgbcw_color_t const& levels);
+    };
+
+}
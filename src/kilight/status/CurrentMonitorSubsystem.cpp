@@ -6,25 +6,62 @@
 
 #include "kilight/status/CurrentMonitorSubsystem.h"
 
+#include <algorithm>
 #include <cmath>
+#include <optional>
+
+#include <pico/time.h>
 
 #include <kilight/protocol/SystemState.h>
 
 #include "kilight/hw/ADC.h"
+#include "kilight/hw/OverCurrentGuard.h"
 
 using kilight::hw::ADC;
+using kilight::hw::OverCurrentGuard;
 using kilight::core::Alarm;
+using kilight::output::render_status_t;
+using kilight::output::rgbcw_color_t;
+using kilight::protocol::CalibrateCurrentModel;
+using kilight::protocol::CommandResult;
+using kilight::protocol::ConfigurePowerBudget;
+using kilight::protocol::LimitingFactor;
+using kilight::storage::save_data_t;
 
 namespace kilight::status {
     CurrentMonitorSubsystem::CurrentMonitorSubsystem(mpf::core::SubsystemList* const list,
+                                                     storage::StorageSubsystem* const storageSubsystem,
                                                      com::WifiSubsystem* const wifiSubsystem,
-                                                     output::LightSubsystem* const lightSubsystem) :
+                                                     output::LightSubsystem* const lightSubsystem,
+                                                     HistorySubsystem* const historySubsystem) :
         Subsystem(list),
+        m_storage(storageSubsystem),
         m_wifi(wifiSubsystem),
-        m_lights(lightSubsystem) {
+        m_lights(lightSubsystem),
+        m_history(historySubsystem) {
     }
 
     void CurrentMonitorSubsystem::setUp() {
+        m_wifi->setConfigurePowerBudgetCallback([this](ConfigurePowerBudget const& configurePowerBudget) {
+            return processConfigurePowerBudget(configurePowerBudget);
+        });
+
+        m_wifi->setCalibrateCurrentModelCallback([this](CalibrateCurrentModel const& calibrateCurrentModel) {
+            return processCalibrateCurrentModel(calibrateCurrentModel);
+        });
+
+        for (uint8_t index = 0; index < output::OutputCount; ++index) {
+            m_currentModels[index].setPrior(m_storage->pendingData().currentModels[index]);
+            publishCurrentModel(index);
+        }
+
+        m_energyMicroJoules = m_storage->pendingData().energy.outputMicroJoules;
+        m_lastEnergyUpdateUs = time_us_64();
+        m_lastEnergySaveUs = m_lastEnergyUpdateUs;
+
+        ADC::setTripThreshold(calculateSampleValue(OutputOverCurrentTripMilliAmps));
+        ADC::start(KILIGHT_ADC_PWM_SYNCHRONOUS ? ADC::SamplingMode::PWMSynchronous : ADC::SamplingMode::FreeRunning);
+
         m_alarm.setTimeout(CheckCurrentEveryMs,
                            [this](Alarm const&) {
                                m_alarmFired = true;
@@ -32,18 +69,11 @@ namespace kilight::status {
     }
 
     bool CurrentMonitorSubsystem::hasWork() const {
-        return m_alarmFired && (ADC::dataReady() || !ADC::conversionInProgress());
+        return m_alarmFired;
     }
 
     void CurrentMonitorSubsystem::work() {
-        if (ADC::dataReady()) {
-            processData();
-        }
-
-        if (!ADC::conversionInProgress()) {
-            ADC::start();
-            TRACE("Starting current measurement");
-        }
+        processData();
     }
 
     uint32_t CurrentMonitorSubsystem::calculateCurrent(uint32_t const sampleValue) {
@@ -53,78 +83,377 @@ namespace kilight::status {
 
     }
 
+    uint16_t CurrentMonitorSubsystem::calculateSampleValue(uint32_t const milliAmps) {
+        return static_cast<uint16_t>(std::round(static_cast<float>(milliAmps) /
+                                                (ADC::MilliVoltsPerADCBit * MilliAmpsPerAmplifiedMilliVolt)));
+    }
+
     void CurrentMonitorSubsystem::processData() {
-        uint32_t outputASum = 0;
-        uint32_t outputACount = 0;
+        ADC::statistics_t const statistics = ADC::takeStatistics();
+        if (statistics.overruns > 0) {
+            WARN("Current sampling fell behind and restarted {} times", statistics.overruns);
+        }
+
+        for (uint8_t index = 0; index < output::OutputCount; ++index) {
+            ADC::channel_statistics_t const& channel = statistics.outputs[index];
+            if (channel.count == 0) {
+                continue;
+            }
+            auto averageValue = static_cast<uint32_t>(channel.sum / channel.count);
+            uint32_t peakValue = channel.maximum;
+            if (statistics.mode == ADC::SamplingMode::PWMSynchronous) {
+                // Each phase bin is the same share of the PWM period, however many readings happened to land in it
+                uint32_t binTotal = 0;
+                uint32_t binsFilled = 0;
+                peakValue = 0;
+                for (ADC::phase_bin_t const& bin : channel.phases) {
+                    if (bin.count == 0) {
+                        continue;
+                    }
+                    uint32_t const binAverage = bin.sum / bin.count;
+                    binTotal += binAverage;
+                    ++binsFilled;
+                    peakValue = std::max(peakValue, binAverage);
+                }
+                if (binsFilled > 0) {
+                    averageValue = binTotal / binsFilled;
+                }
+            }
+            m_outputCurrents[index] = calculateCurrent(averageValue);
+            m_history->record(HistorySeries::OutputCurrent, index, static_cast<int32_t>(m_outputCurrents[index]));
+            uint32_t const peak = calculateCurrent(peakValue);
+            auto const rmsValue = static_cast<uint32_t>(std::lround(
+                std::sqrt(static_cast<float>(channel.sumOfSquares / channel.count))));
+            uint32_t const rms = calculateCurrent(rmsValue);
+            uint32_t const minimum = calculateCurrent(channel.minimum);
+            uint32_t const maximum = calculateCurrent(channel.maximum);
+            TRACE("Output {}: {}mA, {}mA peak, {}mA RMS, {}-{}mA over {} samples",
+                  output::outputName(index),
+                  m_outputCurrents[index],
+                  peak,
+                  rms,
+                  minimum,
+                  maximum,
+                  channel.count);
+
+            m_wifi->updateOutputStateData(index, [=, this](protocol::OutputState& state) {
+                state.set_current(m_outputCurrents[index]);
+                state.set_currentPeak(peak);
+                state.set_currentRms(rms);
+                state.set_currentMin(minimum);
+                state.set_currentMax(maximum);
+            });
+        }
+
+        integrateEnergy();
+        updateCurrentModels();
+        updateLimits();
+        publishLimits();
+
+        publishTrips();
+
+        m_alarmFired = false;
+        m_alarm.setTimeout(CheckCurrentEveryMs,
+                           [this](Alarm const&) {
+                               m_alarmFired = true;
+                           });
+    }
 
-        #ifdef KILIGHT_HAS_OUTPUT_B
+    uint32_t CurrentMonitorSubsystem::outputPowerMilliWatts() const {
+        uint64_t const supplyMilliVolts = m_storage->pendingData().powerBudget.supplyMilliVolts;
+        uint64_t microWatts = 0;
+        for (uint8_t index = 0; index < output::OutputCount; ++index) {
+            microWatts += supplyMilliVolts * std::max(m_outputCurrents[index], m_predictedCurrents[index]);
+        }
+        return static_cast<uint32_t>(microWatts / 1000);
+    }
+
+    void CurrentMonitorSubsystem::integrateEnergy() {
+        uint64_t const now = time_us_64();
+        uint64_t const elapsedUs = now - m_lastEnergyUpdateUs;
+        m_lastEnergyUpdateUs = now;
 
-        uint32_t outputBSum = 0;
-        uint32_t outputBCount = 0;
+        uint32_t const supplyMilliVolts = m_storage->pendingData().powerBudget.supplyMilliVolts;
+        if (supplyMilliVolts == 0) {
+            return;
+        }
+
+        for (uint8_t index = 0; index < output::OutputCount; ++index) {
+            // mV * mA is uW, and uW * us is pJ
+            uint64_t const picoJoules = static_cast<uint64_t>(supplyMilliVolts) * m_outputCurrents[index] * elapsedUs
+                                        + m_energyRemainderPicoJoules[index];
+            m_energyMicroJoules[index] += picoJoules / 1000000;
+            m_energyRemainderPicoJoules[index] = picoJoules % 1000000;
 
-        for (auto const [channelZero, channelOne] : ADC::data()) {
-            if (!channelZero.error) {
-                outputASum += channelZero.value;
-                ++outputACount;
+            m_wifi->updateOutputStateData(index, [this, index](protocol::OutputState& state) {
+                state.set_energyMilliWattHours(m_energyMicroJoules[index] / MicroJoulesPerMilliWattHour);
+            });
+        }
+
+        if (now - m_lastEnergySaveUs >= SaveEnergyEveryUs) {
+            m_lastEnergySaveUs = now;
+            m_storage->updatePendingData([this](save_data_t& saveData) {
+                saveData.energy.outputMicroJoules = m_energyMicroJoules;
+            });
+            DEBUG("Checkpointed energy counters");
+        }
+    }
+
+    void CurrentMonitorSubsystem::updateCurrentModels() {
+        render_status_t const status = m_lights->renderStatus();
+        uint64_t const now = time_us_64();
+
+        for (uint8_t index = 0; index < output::OutputCount; ++index) {
+            rgbcw_color_t const levels = status.outputs[index].levels;
+            // The current is the mean over the whole window since the last check, so it only lines up with the
+            // levels if they held for all of it. A tripped output isn't running at its levels at all.
+            bool const steady = levels == m_previousLevels[index] && !OverCurrentGuard::tripped(index);
+            m_previousLevels[index] = levels;
+
+            current_model_t const& model = m_storage->pendingData().currentModels[index];
+            bool const predictable = model.calibrated && !OverCurrentGuard::tripped(index);
+            m_predictedCurrents[index] = predictable ? model.predict(levels) : 0;
+
+            if (steady) {
+                m_currentModels[index].addSample(levels, m_outputCurrents[index]);
+                checkForAnomaly(index, levels);
+                m_wifi->updateOutputStateData(index, [this, index](protocol::OutputState& state) {
+                    state.set_learnedCurrentModel(m_currentModels[index].fit().toChannelCurrentModel());
+                });
             }
-            if (!channelOne.error) {
-                outputBSum += channelOne.value;
-                ++outputBCount;
+
+            if (m_calibrationEndUs[index] != 0 && now >= m_calibrationEndUs[index]) {
+                finishCalibration(index);
             }
         }
+    }
 
-        if (outputACount > 0) {
-            m_outputACurrent = calculateCurrent(outputASum / outputACount);
+    void CurrentMonitorSubsystem::checkForAnomaly(uint8_t const index, rgbcw_color_t const& levels) {
+        current_model_t const& model = m_storage->pendingData().currentModels[index];
+        if (!model.calibrated || m_calibrationEndUs[index] != 0) {
+            return;
         }
-        if (outputBCount > 0) {
-            m_outputBCurrent = calculateCurrent(outputBSum / outputBCount);
+
+        uint32_t const predicted = model.predict(levels);
+        uint32_t const measured = m_outputCurrents[index];
+        uint32_t const difference = measured > predicted ? measured - predicted : predicted - measured;
+        uint32_t const tolerance = std::max(CurrentAnomalyMinMilliAmps, predicted * CurrentAnomalyPercent / 100);
+        bool const diverging = difference > tolerance;
+
+        m_wifi->updateOutputStateData(index, [predicted](protocol::OutputState& state) {
+            state.set_predictedCurrent(predicted);
+        });
+
+        if (diverging == m_currentAnomalies[index]) {
+            m_anomalyChecks[index] = 0;
+            return;
+        }
+        if (++m_anomalyChecks[index] < CurrentAnomalyChecks) {
+            return;
         }
-        TRACE("Output A: {}mA / Output B: {}mA", m_outputACurrent, m_outputBCurrent);
 
-        #else
+        m_anomalyChecks[index] = 0;
+        m_currentAnomalies[index] = diverging;
+        if (diverging) {
+            WARN("Output {} drawing {}mA, model predicts {}mA",
+                 output::outputName(index),
+                 measured,
+                 predicted);
+        } else {
+            INFO("Output {} current back in line with its model", output::outputName(index));
+        }
+        m_wifi->updateOutputStateData(index, [diverging](protocol::OutputState& state) {
+            state.set_currentAnomaly(diverging);
+        });
+    }
+
+    void CurrentMonitorSubsystem::finishCalibration(uint8_t const index) {
+        m_calibrationEndUs[index] = 0;
+
+        current_model_t model = m_currentModels[index].fit(ChannelCurrentModel::CalibrationPriorWeight);
+        model.calibrated = true;
+        m_storage->updatePendingData([&model, index](save_data_t& saveData) {
+            saveData.currentModels[index] = model;
+        });
+        m_currentModels[index].setPrior(model);
+        m_anomalyChecks[index] = 0;
+        m_currentAnomalies[index] = false;
+
+        INFO("Output {} current model: {}mA + R {}mA, G {}mA, B {}mA, CW {}mA, WW {}mA",
+             output::outputName(index),
+             model.offsetMilliAmps,
+             model.channelMilliAmps[0],
+             model.channelMilliAmps[1],
+             model.channelMilliAmps[2],
+             model.channelMilliAmps[3],
+             model.channelMilliAmps[4]);
+        m_wifi->updateOutputStateData(index, [](protocol::OutputState& state) {
+            state.set_currentAnomaly(false);
+        });
+        publishCurrentModel(index);
+    }
 
-        for (auto const [channelZero] : ADC::data()) {
-            if (!channelZero.error) {
-                outputASum += channelZero.value;
-                ++outputACount;
+    void CurrentMonitorSubsystem::publishCurrentModel(uint8_t const index) const {
+        m_wifi->updateOutputStateData(index, [this, index](protocol::OutputState& state) {
+            state.set_currentModel(m_storage->pendingData().currentModels[index].toChannelCurrentModel());
+        });
+    }
+
+    void CurrentMonitorSubsystem::updateLimits() {
+        save_data_t const& settings = m_storage->pendingData();
+        std::array<uint8_t, output::OutputCount> allowed {};
+        std::array<uint32_t, output::OutputCount> demands {};
+        std::array<LimitingFactor, output::OutputCount> factors {};
+        uint32_t totalAllowedMilliAmps = 0;
+
+        for (uint8_t index = 0; index < output::OutputCount; ++index) {
+            // What was measured is what got through the current limit, so work back to what the output would draw
+            // without it. LED current is close enough to proportional to duty for this.
+            demands[index] = m_outputCurrents[index] * UINT8_MAX / m_outputLimits[index];
+            uint32_t const budget = settings.outputConfigs[index].currentLimitMilliAmps;
+            if (demands[index] > budget) {
+                allowed[index] = static_cast<uint8_t>(budget * UINT8_MAX / demands[index]);
+                factors[index] = LimitingFactor::OutputCurrent;
+            } else {
+                allowed[index] = UINT8_MAX;
+                factors[index] = LimitingFactor::None;
             }
+            totalAllowedMilliAmps += demands[index] * allowed[index] / UINT8_MAX;
         }
 
-        if (outputACount > 0) {
-            m_outputACurrent = calculateCurrent(outputASum / outputACount);
+        uint32_t const totalBudget = settings.powerBudget.totalCurrentLimitMilliAmps;
+        if (totalBudget != 0 && totalAllowedMilliAmps > totalBudget) {
+            // Every output that's drawing anything gives up the same share, so the balance between them holds
+            for (uint8_t index = 0; index < output::OutputCount; ++index) {
+                if (demands[index] == 0) {
+                    continue;
+                }
+                auto const shared = static_cast<uint8_t>(allowed[index] * totalBudget / totalAllowedMilliAmps);
+                if (shared < allowed[index]) {
+                    allowed[index] = shared;
+                    factors[index] = LimitingFactor::TotalCurrent;
+                }
+            }
         }
-        TRACE("Output A: {}mA", m_outputACurrent);
 
-        #endif
+        for (uint8_t index = 0; index < output::OutputCount; ++index) {
+            uint8_t const previous = m_outputLimits[index];
+            uint8_t limit = std::max(allowed[index], MinOutputLimit);
+            if (limit > previous) {
+                limit = static_cast<uint8_t>(std::min<uint32_t>(limit, previous + OutputLimitRiseStep));
+            }
 
+            if (limit == UINT8_MAX) {
+                factors[index] = LimitingFactor::None;
+            } else if (factors[index] == LimitingFactor::None) {
+                // Still rising back after an overload, so whatever caused it is still the reason
+                factors[index] = m_limitingFactors[index];
+            }
+
+            if (factors[index] != m_limitingFactors[index]) {
+                if (factors[index] == LimitingFactor::None) {
+                    INFO("Output {} no longer limited", output::outputName(index));
+                } else {
+                    WARN("Output {} limited by {} budget, drawing {}mA",
+                         output::outputName(index),
+                         factors[index] == LimitingFactor::TotalCurrent ? "total current" : "output current",
+                         m_outputCurrents[index]);
+                }
+            }
 
-        m_wifi->updateStateData([this](protocol::SystemState& state) {
-            state.mutable_outputA().set_current(m_outputACurrent);
+            m_outputLimits[index] = limit;
+            m_limitingFactors[index] = factors[index];
+            m_lights->setOutputLimit(index, limit);
+        }
+    }
 
-            #ifdef KILIGHT_HAS_OUTPUT_B
-            state.mutable_outputB().set_current(m_outputBCurrent);
-            #endif
+    void CurrentMonitorSubsystem::publishTrips() {
+        // The trip itself already happened in the ADC interrupt, this just catches everything else up with it
+        uint32_t const tripped = OverCurrentGuard::trippedOutputs();
+        if (tripped == m_trippedOutputs) {
+            return;
+        }
+
+        for (uint8_t index = 0; index < output::OutputCount; ++index) {
+            bool const isTripped = (tripped & (1U << index)) != 0;
+            bool const wasTripped = (m_trippedOutputs & (1U << index)) != 0;
+            if (isTripped == wasTripped) {
+                continue;
+            }
+            if (isTripped) {
+                WARN("Output {} overcurrent trip! Current: {}mA", output::outputName(index), m_outputCurrents[index]);
+                m_lights->powerOffOutput(index);
+            } else {
+                INFO("Output {} overcurrent trip cleared", output::outputName(index));
+            }
+            m_wifi->updateOutputStateData(index, [isTripped](protocol::OutputState& state) {
+                state.set_overCurrentTripped(isTripped);
+            });
+        }
+
+        m_trippedOutputs = tripped;
+        m_wifi->updateStateData([tripped](protocol::SystemState& state) {
+            state.set_overCurrentFault(tripped != 0);
         });
-        ADC::clearDataReady();
+    }
+
+    void CurrentMonitorSubsystem::publishLimits() const {
+        for (uint8_t index = 0; index < output::OutputCount; ++index) {
+            m_wifi->updateOutputStateData(index, [this, index](protocol::OutputState& state) {
+                state.set_limitingFactor(m_limitingFactors[index]);
+                state.set_limit(m_outputLimits[index]);
+            });
+        }
 
-        if (m_outputACurrent >= OutputOverCurrentTripMilliAmps) {
-            WARN("Output A overcurrent trip! Output A Current: {}", m_outputACurrent);
-            m_lights->powerOffOutputA();
+        // The system as a whole reports the broadest limit in force, so the total budget wins over any one output's
+        LimitingFactor overall = LimitingFactor::None;
+        for (LimitingFactor const factor : m_limitingFactors) {
+            if (factor == LimitingFactor::TotalCurrent) {
+                overall = factor;
+                break;
+            }
+            if (factor != LimitingFactor::None) {
+                overall = factor;
+            }
         }
+        m_wifi->updateStateData([overall](protocol::SystemState& state) {
+            state.set_limitingFactor(overall);
+        });
+    }
+
+    CommandResult CurrentMonitorSubsystem::processConfigurePowerBudget(
+        ConfigurePowerBudget const& configurePowerBudget) {
+        m_storage->updatePendingData([&configurePowerBudget](save_data_t& saveData) {
+            saveData.powerBudget = configurePowerBudget;
+        });
+        DEBUG("Updated power budget, total limit {}mA, supply {}mV",
+              m_storage->pendingData().powerBudget.totalCurrentLimitMilliAmps,
+              m_storage->pendingData().powerBudget.supplyMilliVolts);
+        CommandResult response;
+        response.set_result(CommandResult::Result::OK);
+        return response;
+    }
 
-        #ifdef KILIGHT_HAS_OUTPUT_B
+    CommandResult CurrentMonitorSubsystem::processCalibrateCurrentModel(
+        CalibrateCurrentModel const& calibrateCurrentModel) {
+        CommandResult response;
+        response.set_result(CommandResult::Result::Error);
 
-        if (m_outputBCurrent >= OutputOverCurrentTripMilliAmps) {
-            WARN("Output B overcurrent trip! Output B Current: {}", m_outputBCurrent);
-            m_lights->powerOffOutputB();
+        std::optional<uint8_t> const index = output::outputIndexFor(calibrateCurrentModel.outputId());
+        if (!index.has_value() || m_calibrationEndUs[*index] != 0) {
+            return response;
         }
 
-        #endif
+        if (!m_lights->playCalibrationSequence(*index, CalibrationStepMs)) {
+            return response;
+        }
 
-        m_alarmFired = false;
-        m_alarm.setTimeout(CheckCurrentEveryMs,
-                           [this](Alarm const&) {
-                               m_alarmFired = true;
-                           });
+        // Only what the sequence shows goes into the fit, plus a couple of checks' grace for it to get going
+        m_currentModels[*index].reset();
+        m_calibrationEndUs[*index] = time_us_64()
+                                     + (static_cast<uint64_t>(rgbcw_color_t::ChannelCount + 2) * CalibrationStepMs
+                                        + 2 * CheckCurrentEveryMs) * 1000;
+        response.set_result(CommandResult::Result::OK);
+        return response;
     }
 }
@@ -6,12 +6,21 @@
 
 #pragma once
 
+#include <array>
+
 #include <mpf/core/Logging.h>
 #include <mpf/core/Subsystem.h>
 
+#include <kilight/protocol/CalibrateCurrentModel.h>
+#include <kilight/protocol/ConfigurePowerBudget.h>
+#include <kilight/protocol/LimitingFactor.h>
+
 #include "kilight/core/Alarm.h"
 #include "kilight/com/WifiSubsystem.h"
 #include "kilight/output/LightSubsystem.h"
+#include "kilight/status/ChannelCurrentModel.h"
+#include "kilight/status/HistorySubsystem.h"
+#include "kilight/storage/StorageSubsystem.h"
 
 namespace kilight::status {
 
@@ -26,11 +35,39 @@ namespace kilight::status {
 
         static constexpr float MilliAmpsPerAmplifiedMilliVolt = 1 / (AmplifierFixedGain * CurrentShuntResistorOhms);
 
+        // Last resort if the limiter can't pull the current down in time, like a short. Checked against the mean of
+        // every ADC buffer, straight from the ADC interrupt.
         static constexpr uint16_t OutputOverCurrentTripMilliAmps = 7900;
 
+        static_assert(output::MaxOutputCurrentLimitMilliAmps < OutputOverCurrentTripMilliAmps);
+
+        // The limiter never scales an output below this, or it would read no current and have nothing to go on
+        static constexpr uint8_t MinOutputLimit = 8;
+
+        // How far an output's limit may rise per check. Falling is immediate, rising is slow, so the limiter
+        // doesn't chase fades and ripple into oscillation.
+        static constexpr uint8_t OutputLimitRiseStep = 16;
+
+        // Energy counters are only written to flash this often, since every save erases the whole save data sector
+        static constexpr uint64_t SaveEnergyEveryUs = 60ULL * 60 * 1000 * 1000;
+
+        // How long each step of the current model calibration sequence is held
+        static constexpr uint32_t CalibrationStepMs = 1500;
+
+        // Measured and predicted current have to be further apart than this, and than CurrentAnomalyPercent of the
+        // prediction, to count as an anomaly
+        static constexpr uint32_t CurrentAnomalyMinMilliAmps = 150;
+
+        static constexpr uint32_t CurrentAnomalyPercent = 20;
+
+        // Steady checks in a row it takes to raise or clear an anomaly, so a single noisy reading doesn't
+        static constexpr uint8_t CurrentAnomalyChecks = 20;
+
         CurrentMonitorSubsystem(mpf::core::SubsystemList * list,
+                                storage::StorageSubsystem * storageSubsystem,
                                 com::WifiSubsystem * wifiSubsystem,
-                                output::LightSubsystem * lightSubsystem);
+                                output::LightSubsystem * lightSubsystem,
+                                HistorySubsystem * historySubsystem);
 
         ~CurrentMonitorSubsystem() override = default;
 
@@ -41,24 +78,96 @@ namespace kilight::status {
 
         void work() override;
 
+        /**
+         * For each output, the more of its measured current and what its calibrated current model predicts for the
+         * levels being written, which gets a head start on a current that's still ramping up. Then over the supply
+         * voltage.
+         *
+         * @return Power all the outputs together are drawing, or 0 if the supply voltage hasn't been configured
+         */
+        [[nodiscard]]
+        uint32_t outputPowerMilliWatts() const;
+
     private:
         static uint32_t calculateCurrent(uint32_t sampleValue);
 
+        static uint16_t calculateSampleValue(uint32_t milliAmps);
+
+        storage::StorageSubsystem * const m_storage;
+
         com::WifiSubsystem * const m_wifi;
 
         output::LightSubsystem * const m_lights;
 
-        uint32_t m_outputACurrent = 0;
+        HistorySubsystem * const m_history;
+
+        std::array<uint32_t, output::OutputCount> m_outputCurrents {};
+
+        // From the calibrated current model for the levels last written, 0 for outputs without one
+        std::array<uint32_t, output::OutputCount> m_predictedCurrents {};
+
+        std::array<uint8_t, output::OutputCount> m_outputLimits = makeFilledArray<uint8_t>(UINT8_MAX);
+
+        std::array<protocol::LimitingFactor, output::OutputCount> m_limitingFactors =
+            makeFilledArray<protocol::LimitingFactor>(protocol::LimitingFactor::None);
+
+        std::array<uint64_t, output::OutputCount> m_energyMicroJoules {};
 
-        #if KILIGHT_HAS_OUTPUT_B
-        uint32_t m_outputBCurrent = 0;
-        #endif
+        // What's left over below a whole microjoule, so low power over short windows still adds up
+        std::array<uint64_t, output::OutputCount> m_energyRemainderPicoJoules {};
+
+        uint64_t m_lastEnergyUpdateUs = 0;
+
+        uint64_t m_lastEnergySaveUs = 0;
+
+        std::array<ChannelCurrentModel, output::OutputCount> m_currentModels {};
+
+        // Levels at the last check, to tell whether they held steady over the window since
+        std::array<output::rgbcw_color_t, output::OutputCount> m_previousLevels {};
+
+        // When each output's calibration sequence will have finished, 0 if it isn't being calibrated
+        std::array<uint64_t, output::OutputCount> m_calibrationEndUs {};
+
+        std::array<uint8_t, output::OutputCount> m_anomalyChecks {};
+
+        std::array<bool, output::OutputCount> m_currentAnomalies {};
+
+        // Bit mask of the outputs whose over-current trip has been reported
+        uint32_t m_trippedOutputs = 0;
 
         core::Alarm m_alarm;
 
         bool volatile m_alarmFired = false;
 
+        template <typename ValueT>
+        static constexpr std::array<ValueT, output::OutputCount> makeFilledArray(ValueT const value) {
+            std::array<ValueT, output::OutputCount> result;
+            result.fill(value);
+            return result;
+        }
+
         void processData();
+
+        void integrateEnergy();
+
+        void updateCurrentModels();
+
+        void checkForAnomaly(uint8_t index, output::rgbcw_color_t const& levels);
+
+        void finishCalibration(uint8_t index);
+
+        void publishCurrentModel(uint8_t index) const;
+
+        void updateLimits();
+
+        void publishLimits() const;
+
+        void publishTrips();
+
+        protocol::CommandResult processConfigurePowerBudget(protocol::ConfigurePowerBudget const& configurePowerBudget);
+
+        protocol::CommandResult processCalibrateCurrentModel(
+            protocol::CalibrateCurrentModel const& calibrateCurrentModel);
     };
 
 }
@@ -0,0 +1,146 @@
+/**
+ * HistorySubsystem.cpp
+ *
+ * @author Patrick Lavigne
+ */
+
+#include "kilight/status/HistorySubsystem.h"
+
+#include <algorithm>
+#include <optional>
+
+#include "kilight/output/output_identifier.h"
+
+using kilight::core::Alarm;
+using kilight::protocol::FetchHistory;
+using kilight::protocol::HistoryPage;
+
+namespace kilight::status {
+    HistorySubsystem::HistorySubsystem(mpf::core::SubsystemList* const list,
+                                       com::WifiSubsystem* const wifiSubsystem) :
+        Subsystem(list),
+        m_wifi(wifiSubsystem) {
+    }
+
+    void HistorySubsystem::setUp() {
+        m_wifi->setFetchHistoryCallback([this](FetchHistory const& fetchHistory, HistoryPage& page) {
+            return processFetchHistory(fetchHistory, page);
+        });
+
+        m_alarm.setTimeout(SecondTierIntervalS * 1000,
+                           [this](Alarm const&) {
+                               m_alarmFired = true;
+                           });
+    }
+
+    bool HistorySubsystem::hasWork() const {
+        return m_alarmFired;
+    }
+
+    void HistorySubsystem::work() {
+        closeBuckets();
+
+        m_alarmFired = false;
+        m_alarm.setTimeout(SecondTierIntervalS * 1000,
+                           [this](Alarm const&) {
+                               m_alarmFired = true;
+                           });
+    }
+
+    void HistorySubsystem::record(HistorySeries const series, uint8_t const outputIndex, int32_t const value) {
+        if (outputIndex >= output::OutputCount) {
+            return;
+        }
+        // One below INT16_MIN, which marks an empty bucket
+        auto const clamped = static_cast<int16_t>(std::clamp<int32_t>(value, INT16_MIN + 1, INT16_MAX));
+        m_accumulators[0][historySlot(series, outputIndex)].add(clamped);
+    }
+
+    void HistorySubsystem::closeBuckets() {
+        history_row_t const seconds = closeBucket(0);
+        m_secondTier.push(seconds);
+
+        if (++m_bucketsSinceNextTier[0] < MinuteTierIntervalS / SecondTierIntervalS) {
+            return;
+        }
+        m_bucketsSinceNextTier[0] = 0;
+        history_row_t const minutes = closeBucket(1);
+        m_minuteTier.push(minutes);
+
+        if (++m_bucketsSinceNextTier[1] < TenMinuteTierIntervalS / MinuteTierIntervalS) {
+            return;
+        }
+        m_bucketsSinceNextTier[1] = 0;
+        m_tenMinuteTier.push(closeBucket(2));
+    }
+
+    history_row_t HistorySubsystem::closeBucket(uint8_t const tier) {
+        history_row_t row;
+        for (uint8_t slot = 0; slot < HistorySlotCount; ++slot) {
+            row[slot] = m_accumulators[tier][slot].take();
+            if (tier + 1 < TierCount) {
+                m_accumulators[tier + 1][slot].add(row[slot]);
+            }
+        }
+        return row;
+    }
+
+    bool HistorySubsystem::processFetchHistory(FetchHistory const& fetchHistory, HistoryPage& page) const {
+        auto const series = static_cast<HistorySeries>(fetchHistory.series());
+        if (series > HistorySeries::OutputCurrent) {
+            WARN("Invalid history series requested: {}", static_cast<uint32_t>(fetchHistory.series()));
+            return false;
+        }
+
+        uint8_t outputIndex = 0;
+        if (series == HistorySeries::OutputTemperature || series == HistorySeries::OutputCurrent) {
+            std::optional<uint8_t> const index = output::outputIndexFor(fetchHistory.output());
+            if (!index.has_value() || *index >= output::OutputCount) {
+                WARN("Invalid output requested for history");
+                return false;
+            }
+            outputIndex = *index;
+        }
+        uint8_t const slot = historySlot(series, outputIndex);
+
+        // Newest first, so bucket 0 is always the most recent complete one whenever the client asks
+        auto const fillPage = [&fetchHistory, &page, slot](auto const& ring, uint32_t const intervalS) {
+            size_t const first = fetchHistory.startBucket();
+            size_t const end = std::min<size_t>({ring.size(),
+                                                 first + fetchHistory.count(),
+                                                 first + BucketsPerPage});
+            page.set_intervalS(intervalS);
+            page.set_availableBuckets(static_cast<uint32_t>(ring.size()));
+            for (size_t age = first; age < end; ++age) {
+                history_bucket_t const& bucket = ring.at(age)[slot];
+                page.mutable_average().add(bucket.average);
+                page.mutable_minimum().add(bucket.minimum);
+                page.mutable_maximum().add(bucket.maximum);
+            }
+        };
+
+        page.set_series(fetchHistory.series());
+        page.set_output(fetchHistory.output());
+        page.set_tier(fetchHistory.tier());
+        page.set_startBucket(fetchHistory.startBucket());
+
+        switch (fetchHistory.tier()) {
+        case 0:
+            fillPage(m_secondTier, SecondTierIntervalS);
+            break;
+
+        case 1:
+            fillPage(m_minuteTier, MinuteTierIntervalS);
+            break;
+
+        case 2:
+            fillPage(m_tenMinuteTier, TenMinuteTierIntervalS);
+            break;
+
+        default:
+            WARN("Invalid history tier requested: {}", fetchHistory.tier());
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,115 @@
+/**
+ * HistorySubsystem.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <algorithm>
+
+#include <mpf/core/Logging.h>
+#include <mpf/core/Subsystem.h>
+
+#include <kilight/protocol/FetchHistory.h>
+#include <kilight/protocol/HistoryPage.h>
+
+#include "kilight/core/Alarm.h"
+#include "kilight/com/WifiSubsystem.h"
+#include "kilight/status/history_data.h"
+
+namespace kilight::status {
+
+    /**
+     * Keeps recent temperatures, fan speed and output currents in RAM at a few resolutions, each tier built up from
+     * the one before it, so a thermal event can be looked into after the fact without polling the state constantly.
+     */
+    class HistorySubsystem final : public mpf::core::Subsystem {
+        LOGGER(History);
+    public:
+        // RAM all of the tiers' rows together may take. Rows grow by two buckets with each output, so the second tier
+        // gives up what the coarser tiers need on boards with more outputs.
+        static constexpr size_t HistoryBudgetBytes = 48 * 1024;
+
+        static constexpr uint32_t MinuteTierIntervalS = 60;
+
+        // 4 hours
+        static constexpr size_t MinuteTierBuckets = 240;
+
+        static constexpr uint32_t TenMinuteTierIntervalS = 600;
+
+        // 24 hours
+        static constexpr size_t TenMinuteTierBuckets = 144;
+
+        static constexpr uint32_t SecondTierIntervalS = 1;
+
+        // 10 minutes where it fits, which it does up to two outputs, and what's left of the budget otherwise
+        static constexpr size_t SecondTierBuckets = std::min<size_t>(
+                600,
+                HistoryBudgetBytes / sizeof(history_row_t) - MinuteTierBuckets - TenMinuteTierBuckets);
+
+        static constexpr size_t HistoryStoreBytes =
+                (SecondTierBuckets + MinuteTierBuckets + TenMinuteTierBuckets) * sizeof(history_row_t);
+
+        static_assert(HistoryStoreBytes <= HistoryBudgetBytes, "History no longer fits in its RAM budget");
+
+        static_assert(SecondTierBuckets >= 2 * MinuteTierIntervalS / SecondTierIntervalS,
+                      "Too many outputs for the second tier to cover even a couple of minute buckets");
+
+        static constexpr uint8_t TierCount = 3;
+
+        // Most buckets in a single reply, which keeps it inside the one byte length prefix even when every value
+        // takes the longest encoding
+        static constexpr uint8_t BucketsPerPage = 20;
+
+        HistorySubsystem(mpf::core::SubsystemList * list, com::WifiSubsystem * wifiSubsystem);
+
+        ~HistorySubsystem() override = default;
+
+        void setUp() override;
+
+        [[nodiscard]]
+        bool hasWork() const override;
+
+        void work() override;
+
+        /**
+         * Adds a reading to the bucket currently being filled. Only call from the main loop.
+         *
+         * @param series What was read
+         * @param outputIndex Output it was read from, for the per-output series
+         * @param value Reading, in the series' units
+         */
+        void record(HistorySeries series, uint8_t outputIndex, int32_t value);
+
+        void record(HistorySeries const series, int32_t const value) {
+            record(series, 0, value);
+        }
+
+    private:
+        com::WifiSubsystem * const m_wifi;
+
+        HistoryRing<SecondTierBuckets> m_secondTier;
+
+        HistoryRing<MinuteTierBuckets> m_minuteTier;
+
+        HistoryRing<TenMinuteTierBuckets> m_tenMinuteTier;
+
+        // One per tier, each gathering the bucket that tier is filling
+        std::array<std::array<history_accumulator_t, HistorySlotCount>, TierCount> m_accumulators {};
+
+        // Buckets closed in each of the finer tiers since the coarser one after it last closed one
+        std::array<uint16_t, TierCount - 1> m_bucketsSinceNextTier {};
+
+        core::Alarm m_alarm;
+
+        bool volatile m_alarmFired = false;
+
+        void closeBuckets();
+
+        history_row_t closeBucket(uint8_t tier);
+
+        bool processFetchHistory(protocol::FetchHistory const& fetchHistory, protocol::HistoryPage& page) const;
+    };
+
+}
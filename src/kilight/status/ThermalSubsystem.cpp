@@ -6,37 +6,72 @@
 
 #include "kilight/status/ThermalSubsystem.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include <pico/time.h>
 
 #include <kilight/protocol/SystemState.h>
 
 #include "kilight/hw/SystemPins.h"
+#include "kilight/output/output_identifier.h"
 
 using kilight::protocol::SystemState;
-using kilight::protocol::OutputIdentifier;
 using kilight::protocol::OutputState;
+using kilight::protocol::CommandResult;
+using kilight::protocol::ConfigureThermalDerating;
+using kilight::protocol::ConfigureThermalModel;
+using kilight::protocol::ConfigureThermometerResolution;
+using kilight::protocol::ThermometerRole;
+using kilight::hw::DS18B20Driver;
 using kilight::hw::SystemPins;
-using kilight::hw::GPIOInterruptTrigger;
 using kilight::core::Alarm;
+using kilight::storage::save_data_t;
 
 namespace kilight::status {
     ThermalSubsystem::ThermalSubsystem(mpf::core::SubsystemList* const list,
+                                       storage::StorageSubsystem* const storage,
                                        hw::OneWireSubsystem* const oneWire,
                                        com::WifiSubsystem* const wifiSubsystem,
-                                       output::LightSubsystem* const lightSubsystem) :
-        Subsystem(list), m_oneWire(oneWire), m_wifi(wifiSubsystem), m_lights(lightSubsystem) {
+                                       output::LightSubsystem* const lightSubsystem,
+                                       CurrentMonitorSubsystem* const currentMonitor,
+                                       HistorySubsystem* const historySubsystem) :
+        Subsystem(list),
+        m_storage(storage),
+        m_oneWire(oneWire),
+        m_wifi(wifiSubsystem),
+        m_lights(lightSubsystem),
+        m_currentMonitor(currentMonitor),
+        m_history(historySubsystem) {
+        for (int16_t volatile& temperature : m_outputTemperatures) {
+            temperature = INT16_MIN;
+        }
     }
 
     void ThermalSubsystem::initialize() {
         SystemPins::FanPWM::enablePWM(FanPWMFrequency);
-        SystemPins::FanTacho::setDirection(false);
+        SystemPins::FanTacho::enableEdgeCounting();
     }
 
     void ThermalSubsystem::setUp() {
         SystemPins::FanPWM::writePerThou(1000 - m_fanOutputPerThou);
+        m_wifi->setConfigureThermalDeratingCallback([this](ConfigureThermalDerating const& configureThermalDerating) {
+            return processConfigureThermalDerating(configureThermalDerating);
+        });
+        m_wifi->setConfigureThermalModelCallback([this](ConfigureThermalModel const& configureThermalModel) {
+            return processConfigureThermalModel(configureThermalModel);
+        });
+        m_wifi->setConfigureThermometerResolutionCallback(
+            [this](ConfigureThermometerResolution const& configureThermometerResolution) {
+                return processConfigureThermometerResolution(configureThermometerResolution);
+            });
+
         m_wifi->updateStateData([this](SystemState& state) {
             state.mutable_fan().set_rpm(m_fanRPM);
+            state.mutable_fan().set_targetRpm(m_fanTargetRPM);
             state.mutable_fan().set_outputPerThou(m_fanOutputPerThou);
+            state.set_fanFault(m_fanFault);
+            state.set_thermalDerate(m_derate);
             state.mutable_temperatures().set_driver(m_driverTemperature);
             if (m_powerSupplyTemperature != INT16_MIN) {
                 state.mutable_temperatures().set_powerSupply(m_powerSupplyTemperature);
@@ -46,10 +81,8 @@ namespace kilight::status {
         });
 
         m_tachometerStartUs = time_us_64();
-        SystemPins::FanTacho::setInterrupt(GPIOInterruptTrigger::EdgeFalling,
-                                           [this](uint8_t, GPIOInterruptTrigger) {
-                                               m_tachometerCountSinceLastCheck = m_tachometerCountSinceLastCheck + 1;
-                                           });
+        m_lastThermalModelUpdateUs = m_tachometerStartUs;
+        m_tachometerCount = SystemPins::FanTacho::readCount();
 
         m_state = State::PreSleep;
     }
@@ -120,22 +153,25 @@ namespace kilight::status {
     }
 
     void ThermalSubsystem::measureFanState() {
-        m_criticalSection.enter();
+        uint64_t const nowUs = time_us_64();
+        uint16_t const count = SystemPins::FanTacho::readCount();
 
-        uint64_t const tachometerDeltaUs = time_us_64() - m_tachometerStartUs;
-        uint32_t const tachometerCount = m_tachometerCountSinceLastCheck;
+        // The counter wraps at 16 bits, which takes minutes at any speed a fan can turn
+        uint64_t const tachometerDeltaUs = nowUs - m_tachometerStartUs;
+        auto const tachometerCount = static_cast<uint16_t>(count - m_tachometerCount);
 
-        m_tachometerStartUs = time_us_64();
-        m_tachometerCountSinceLastCheck = 0;
-
-        // Exit the critical section early so we can do division without blocking everything else
-        m_criticalSection.exit();
+        m_tachometerStartUs = nowUs;
+        m_tachometerCount = count;
 
         double const tachometerDeltaMinutes = static_cast<double>(tachometerDeltaUs) / MicrosecondsPerMinute;
+        m_fanMeasurementSeconds = static_cast<float>(tachometerDeltaMinutes * 60);
+        m_previousFanRPM = m_fanRPM;
         m_fanRPM = static_cast<uint16_t>(static_cast<double>(tachometerCount) / FanTachometerTicksPerRevolution /
                                          tachometerDeltaMinutes);
 
-        TRACE("Fan RPM: {} / Level: {}", m_fanRPM, m_fanOutputPerThou);
+        m_history->record(HistorySeries::FanRPM, m_fanRPM);
+
+        TRACE("Fan RPM: {} / Target: {} / Level: {}", m_fanRPM, m_fanTargetRPM, m_fanOutputPerThou);
 
         m_wifi->updateStateData([this](SystemState& state) {
             state.mutable_fan().set_rpm(m_fanRPM);
@@ -145,10 +181,16 @@ namespace kilight::status {
     }
 
     void ThermalSubsystem::updateFanSpeedState() {
+        // Before the output changes, since the reading was taken with the output as it is now
+        checkFanStall();
+        updateThermalModel();
+        calculateFanTargetRPM();
         calculateFanOutput();
 
         SystemPins::FanPWM::writePerThou(1000 - m_fanOutputPerThou);
+        m_history->record(HistorySeries::FanOutput, m_fanOutputPerThou);
         m_wifi->updateStateData([this](SystemState& state) {
+            state.mutable_fan().set_targetRpm(m_fanTargetRPM);
             state.mutable_fan().set_outputPerThou(m_fanOutputPerThou);
         });
 
@@ -160,6 +202,7 @@ namespace kilight::status {
             bool const registered = m_oneWire->registerOnboardTemperatureUpdateCallback(
                 [this](int16_t const newTemperature) {
                     m_driverTemperature = newTemperature;
+                    m_history->record(HistorySeries::DriverTemperature, newTemperature);
                     m_wifi->updateStateData([newTemperature](SystemState& state) {
                         state.mutable_temperatures().set_driver(newTemperature);
                     });
@@ -175,6 +218,7 @@ namespace kilight::status {
             bool const registered = m_oneWire->registerPowerSupplyTemperatureUpdateCallback(
                 [this](int16_t const newTemperature) {
                     m_powerSupplyTemperature = newTemperature;
+                    m_history->record(HistorySeries::PowerSupplyTemperature, newTemperature);
                     m_wifi->updateStateData([newTemperature](SystemState& state) {
                         state.mutable_temperatures().set_powerSupply(newTemperature);
                     });
@@ -186,19 +230,26 @@ namespace kilight::status {
             }
         }
 
-        if (!m_outputACallbackRegistered) {
-            bool const registered = m_oneWire->registerOutputATemperatureUpdateCallback(
-                [this](int16_t const newTemperature) {
-                    m_outputATemperature = newTemperature;
-                    m_wifi->updateOutputStateData(OutputIdentifier::OutputA,
+        for (uint8_t index = 0; index < output::OutputCount; ++index) {
+            if (m_outputCallbacksRegistered[index]) {
+                continue;
+            }
+            bool const registered = m_oneWire->registerOutputTemperatureUpdateCallback(
+                index,
+                [this, index](int16_t const newTemperature) {
+                    m_outputTemperatures[index] = newTemperature;
+                    m_history->record(HistorySeries::OutputTemperature, index, newTemperature);
+                    m_wifi->updateOutputStateData(index,
                                                   [newTemperature](OutputState& state) {
                                                       state.set_temperature(newTemperature);
                                                   });
-                    TRACE("Output A temperature: {:.2f} °C", static_cast<float>(m_outputATemperature) / 100);
+                    TRACE("Output {} temperature: {:.2f} °C",
+                          output::outputName(index),
+                          static_cast<float>(m_outputTemperatures[index]) / 100);
                 });
             if (registered) {
-                m_outputACallbackRegistered = true;
-                DEBUG("Registered Output A thermometer callback");
+                m_outputCallbacksRegistered[index] = true;
+                DEBUG("Registered Output {} thermometer callback", output::outputName(index));
             }
         }
 
@@ -206,42 +257,265 @@ namespace kilight::status {
     }
 
     void ThermalSubsystem::checkOverheatState() {
+        uint8_t const previousDerate = m_derate;
+        calculateDerate();
+        if (m_derate != previousDerate) {
+            m_lights->setThermalDerate(m_derate);
+            m_wifi->updateStateData([this](SystemState& state) {
+                state.set_thermalDerate(m_derate);
+            });
+            if (previousDerate == UINT8_MAX) {
+                WARN("Thermal derating started at {} °C", currentMaxTemp());
+            } else if (m_derate == UINT8_MAX) {
+                INFO("Thermal derating ended");
+            }
+        }
+
         if (auto const maxSensedTemp = currentMaxTemp();
             maxSensedTemp >= OverheatTemperatureC) {
             WARN("Overheat trip! Current max sensed temp: {}", maxSensedTemp);
-            m_lights->powerOffOutputA();
-            #ifdef KILIGHT_HAS_OUTPUT_B
-            m_lights->powerOffOutputB();
-            #endif
+            m_lights->powerOffAllOutputs();
         }
         m_state = State::PreSleep;
     }
 
+    void ThermalSubsystem::updateThermalModel() {
+        uint64_t const now = time_us_64();
+        float const elapsedS = static_cast<float>(now - m_lastThermalModelUpdateUs) / 1000000.0f;
+        m_lastThermalModelUpdateUs = now;
+
+        auto const& model = m_storage->pendingData().thermalModel;
+        if (model.thermalResistanceCentiCPerWatt == 0 || model.timeConstantS == 0) {
+            m_modelledRiseC = 0.0f;
+            m_anticipatedRiseC = 0.0f;
+            return;
+        }
+
+        // First order: the rise heads for the steady state rise at this power, closing the gap exponentially
+        float const timeConstantS = model.timeConstantS;
+        float const steadyRiseC = static_cast<float>(model.thermalResistanceCentiCPerWatt) / 100.0f *
+                                  static_cast<float>(m_currentMonitor->outputPowerMilliWatts()) / 1000.0f;
+        m_modelledRiseC += (steadyRiseC - m_modelledRiseC) * (1.0f - std::exp(-elapsedS / timeConstantS));
+
+        // Only ever brings the fan up early. When the power drops the fan follows the thermometers back down, the
+        // same as it would without the model.
+        float const comingWithinLeadTime = 1.0f - std::exp(-static_cast<float>(model.leadTimeS) / timeConstantS);
+        m_anticipatedRiseC = std::max(0.0f, (steadyRiseC - m_modelledRiseC) * comingWithinLeadTime);
+
+        TRACE("Thermal model rise {:.2f} °C heading for {:.2f} °C, anticipating {:.2f} °C",
+              m_modelledRiseC,
+              steadyRiseC,
+              m_anticipatedRiseC);
+        m_wifi->updateStateData([this](SystemState& state) {
+            state.mutable_temperatures().set_anticipatedRise(static_cast<int32_t>(m_anticipatedRiseC * 100));
+        });
+    }
+
+    int16_t ThermalSubsystem::fanControlTemp() const {
+        auto const anticipatedDriverTemp = static_cast<int32_t>(
+            (static_cast<float>(m_driverTemperature) + m_anticipatedRiseC * 100) / 100);
+        return static_cast<int16_t>(std::max<int32_t>(currentMaxTemp(), anticipatedDriverTemp));
+    }
+
+    void ThermalSubsystem::calculateFanTargetRPM() {
+        if (!driverTempValid()) {
+            m_fanTargetRPM = 0;
+            return;
+        }
+
+        int16_t const controlTemp = fanControlTemp();
+        auto const tempOverTurnOnPoint = static_cast<int16_t>(controlTemp - FanTurnOnTemperatureC);
+
+        if (tempOverTurnOnPoint < 0) {
+            TRACE("Fan stopped for low temp: {}", controlTemp);
+            m_fanTargetRPM = 0;
+            return;
+        }
+
+        if (tempOverTurnOnPoint >= FanAdjustTemperatureRangeC) {
+            TRACE("Fan target to max for temp {}", controlTemp);
+            m_fanTargetRPM = FanMaxTargetRPM;
+            return;
+        }
+
+        float const fractionOfRange = static_cast<float>(tempOverTurnOnPoint) / FanAdjustTemperatureRangeC;
+        m_fanTargetRPM = FanMinTargetRPM + static_cast<uint16_t>(FanTargetRPMRange * fractionOfRange);
+        TRACE("Fan target for temp {} is {} RPM", controlTemp, m_fanTargetRPM);
+    }
+
     void ThermalSubsystem::calculateFanOutput() {
         if (!driverTempValid()) {
             DEBUG("Driver temperature not valid yet, setting fan output to safe default.");
+            m_fanIntegralPerThou = 0.0f;
             m_fanOutputPerThou = InitialFanOutputPerThou;
             return;
         }
 
-        int16_t const maxTempReading = currentMaxTemp();
-        auto const tempOverTurnOnPoint = static_cast<int16_t>(maxTempReading - FanTurnOnTemperatureC);
+        if (m_fanFault) {
+            // Flat out, which gives a blocked rotor the best chance of coming free
+            m_fanIntegralPerThou = 0.0f;
+            m_fanOutputPerThou = MaxFanOutputPerThou;
+            return;
+        }
 
-        if (tempOverTurnOnPoint < 0) {
-            TRACE("Fan stopped for low temp: {}", maxTempReading);
+        if (m_fanTargetRPM == 0) {
+            m_fanIntegralPerThou = 0.0f;
             m_fanOutputPerThou = 0;
             return;
         }
 
-        if (tempOverTurnOnPoint >= FanAdjustTemperatureRangeC) {
-            TRACE("Fan adjusting to max for temp {}", maxTempReading);
-            m_fanOutputPerThou = MaxFanOutputPerThou;
+        // Where the output would sit if the fan matched its expected curve, so the PID terms only make up for ageing,
+        // dust and supply sag rather than having to find the whole output by themselves
+        float const fractionOfRange = static_cast<float>(m_fanTargetRPM - FanMinTargetRPM) / FanTargetRPMRange;
+        float const feedForward = MinFanOutputPerThou + FanOutputRangePerThou * fractionOfRange;
+
+        float const error = static_cast<float>(m_fanTargetRPM) - static_cast<float>(m_fanRPM);
+
+        // On the measurement rather than the error, so a step in the target doesn't kick the output
+        float rpmPerSecond = 0.0f;
+        if (m_fanMeasurementSeconds > 0.0f) {
+            rpmPerSecond = (static_cast<float>(m_fanRPM) - static_cast<float>(m_previousFanRPM)) /
+                           m_fanMeasurementSeconds;
+        }
+
+        float const previousIntegral = m_fanIntegralPerThou;
+        m_fanIntegralPerThou = std::clamp(m_fanIntegralPerThou + FanIntegralGain * error * m_fanMeasurementSeconds,
+                                          -FanIntegralLimitPerThou,
+                                          FanIntegralLimitPerThou);
+
+        float const unclamped = feedForward
+                                + FanProportionalGain * error
+                                + m_fanIntegralPerThou
+                                - FanDerivativeGain * rpmPerSecond;
+
+        // Anti-windup: while the output is pinned at a limit, the integral isn't allowed to push further into it,
+        // otherwise it would take just as long to unwind once the fan could keep up again
+        if ((unclamped > MaxFanOutputPerThou && error > 0.0f) || (unclamped < MinFanOutputPerThou && error < 0.0f)) {
+            m_fanIntegralPerThou = previousIntegral;
+        }
+
+        float const output = std::clamp(unclamped,
+                                        static_cast<float>(MinFanOutputPerThou),
+                                        static_cast<float>(MaxFanOutputPerThou));
+        m_fanOutputPerThou = static_cast<uint16_t>(output + 0.5f);
+        TRACE("Fan output {} for target {} RPM (error {:.0f}, integral {:.1f})",
+              m_fanOutputPerThou,
+              m_fanTargetRPM,
+              error,
+              m_fanIntegralPerThou);
+    }
+
+    void ThermalSubsystem::checkFanStall() {
+        if (m_fanOutputPerThou > 0 && m_fanRPM == 0) {
+            m_fanRecoveredChecks = 0;
+            if (m_fanStalledChecks < FanStallChecks) {
+                ++m_fanStalledChecks;
+            }
+            if (!m_fanFault && m_fanStalledChecks >= FanStallChecks) {
+                m_fanFault = true;
+                WARN("Fan stalled or blocked, reading 0 RPM at output {}", m_fanOutputPerThou);
+                m_wifi->updateStateData([](SystemState& state) {
+                    state.set_fanFault(true);
+                });
+            }
             return;
         }
 
-        float const fractionOfRange = static_cast<float>(tempOverTurnOnPoint) / FanAdjustTemperatureRangeC;
-        m_fanOutputPerThou = MinFanOutputPerThou + static_cast<uint16_t>(FanOutputRangePerThou * fractionOfRange);
-        TRACE("Fan adjusting for temp {} to power {}", maxTempReading, m_fanOutputPerThou);
+        m_fanStalledChecks = 0;
+        if (!m_fanFault || m_fanRPM == 0) {
+            return;
+        }
+
+        if (++m_fanRecoveredChecks >= FanRecoveryChecks) {
+            m_fanFault = false;
+            m_fanRecoveredChecks = 0;
+            INFO("Fan turning again at {} RPM", m_fanRPM);
+            m_wifi->updateStateData([](SystemState& state) {
+                state.set_fanFault(false);
+            });
+        }
+    }
+
+    void ThermalSubsystem::calculateDerate() {
+        auto const& derating = m_storage->pendingData().thermalDerating;
+
+        // With the fan faulted the temperature readings can't be relied on to catch up in time, so brightness is held
+        // down to the configured ceiling on top of any temperature derating
+        uint8_t const fanLimit = m_fanFault && derating.fanFaultLimit > 0 ? derating.fanFaultLimit : UINT8_MAX;
+
+        if (!driverTempValid()) {
+            m_derate = fanLimit;
+            return;
+        }
+
+        // Worked in hundredths of a degree, so the ceiling moves smoothly rather than a whole degree at a time
+        int32_t const temperature = std::max(m_driverTemperature, m_powerSupplyTemperature);
+        int32_t const start = static_cast<int32_t>(derating.startTemperatureC) * 100;
+        int32_t const end = static_cast<int32_t>(OverheatTemperatureC) * 100;
+
+        if (start >= end || temperature <= start) {
+            m_derate = fanLimit;
+            return;
+        }
+
+        int32_t const range = UINT8_MAX - derating.minimumLimit;
+        int32_t const over = std::min(temperature, end) - start;
+        m_derate = std::min(fanLimit, static_cast<uint8_t>(UINT8_MAX - range * over / (end - start)));
+        TRACE("Thermal derate for temp {} to {}", currentMaxTemp(), m_derate);
+    }
+
+    CommandResult ThermalSubsystem::processConfigureThermalDerating(
+        ConfigureThermalDerating const& configureThermalDerating) {
+        m_storage->updatePendingData([&configureThermalDerating](save_data_t& saveData) {
+            saveData.thermalDerating = configureThermalDerating;
+        });
+        DEBUG("Updated thermal derating, starting at {} °C",
+              m_storage->pendingData().thermalDerating.startTemperatureC);
+        CommandResult response;
+        response.set_result(CommandResult::Result::OK);
+        return response;
+    }
+
+    CommandResult ThermalSubsystem::processConfigureThermalModel(ConfigureThermalModel const& configureThermalModel) {
+        m_storage->updatePendingData([&configureThermalModel](save_data_t& saveData) {
+            saveData.thermalModel = configureThermalModel;
+        });
+        DEBUG("Updated thermal model, {} °C/W with a {}s time constant",
+              static_cast<float>(m_storage->pendingData().thermalModel.thermalResistanceCentiCPerWatt) / 100,
+              m_storage->pendingData().thermalModel.timeConstantS);
+        CommandResult response;
+        response.set_result(CommandResult::Result::OK);
+        return response;
+    }
+
+    CommandResult ThermalSubsystem::processConfigureThermometerResolution(
+        ConfigureThermometerResolution const& configureThermometerResolution) {
+        CommandResult response;
+        uint32_t const bits = configureThermometerResolution.resolutionBits();
+        if (bits != 0 && (bits < DS18B20Driver::MinResolutionBits || bits > DS18B20Driver::MaxResolutionBits)) {
+            WARN("Invalid thermometer resolution: {} bits", bits);
+            response.set_result(CommandResult::Result::Error);
+            return response;
+        }
+
+        bool const powerSupply = configureThermometerResolution.role() == ThermometerRole::PowerSupply;
+        auto const outputIndex = output::outputIndexFor(configureThermometerResolution.output());
+        if (!powerSupply && (!outputIndex.has_value() || *outputIndex >= output::OutputCount)) {
+            WARN("Invalid thermometer for resolution configuration");
+            response.set_result(CommandResult::Result::Error);
+            return response;
+        }
+
+        m_storage->updatePendingData([powerSupply, &outputIndex, bits](save_data_t& saveData) {
+            auto& resolutions = saveData.thermometerResolutions;
+            uint8_t& resolution = powerSupply ? resolutions.powerSupply : resolutions.outputs[*outputIndex];
+            resolution = static_cast<uint8_t>(bits);
+        });
+        m_oneWire->applyThermometerResolutions();
+        DEBUG("Updated thermometer resolution to {} bits",
+              DS18B20Driver::resolutionBits(DS18B20Driver::resolutionFromBits(static_cast<uint8_t>(bits))));
+        response.set_result(CommandResult::Result::OK);
+        return response;
     }
 
     void ThermalSubsystem::wait(uint32_t const waitTimeMs, State const stateAfterWaiting) {
@@ -6,14 +6,22 @@
 
 #pragma once
 
+#include <array>
+
 #include <mpf/core/Logging.h>
 #include <mpf/core/Subsystem.h>
 
+#include <kilight/protocol/ConfigureThermalDerating.h>
+#include <kilight/protocol/ConfigureThermalModel.h>
+#include <kilight/protocol/ConfigureThermometerResolution.h>
+
 #include "kilight/core/Alarm.h"
-#include "kilight/core/CriticalSection.h"
 #include "kilight/com/WifiSubsystem.h"
 #include "kilight/hw/OneWireSubsystem.h"
 #include "kilight/output/LightSubsystem.h"
+#include "kilight/status/CurrentMonitorSubsystem.h"
+#include "kilight/status/HistorySubsystem.h"
+#include "kilight/storage/StorageSubsystem.h"
 
 namespace kilight::status {
 
@@ -55,12 +63,40 @@ namespace kilight::status {
 
         static constexpr uint8_t FanTachometerTicksPerRevolution = 2;
 
+        // Fan speed aimed for at the turn on temperature, rising linearly to the maximum at FanMaxTemperatureC
+        static constexpr uint16_t FanMinTargetRPM = 600;
+
+        static constexpr uint16_t FanMaxTargetRPM = 3000;
+
+        static constexpr uint16_t FanTargetRPMRange = FanMaxTargetRPM - FanMinTargetRPM;
+
+        // Fan speed PID gains, in per-thou of output per RPM of error (and per second of it, and per RPM/s of change).
+        // The output starts from a feed-forward guess taken from the target, so these only have to trim it.
+        static constexpr float FanProportionalGain = 0.05f;
+
+        static constexpr float FanIntegralGain = 0.02f;
+
+        static constexpr float FanDerivativeGain = 0.01f;
+
+        // Furthest the integral term can move the output from the feed-forward guess
+        static constexpr float FanIntegralLimitPerThou = 400.0f;
+
+        // Consecutive checks reading 0 RPM while the fan is driven before it's counted as stalled or blocked. Long
+        // enough for the fan to spin up from a standstill.
+        static constexpr uint8_t FanStallChecks = 5;
+
+        // Consecutive checks reading some RPM again before a stall fault clears
+        static constexpr uint8_t FanRecoveryChecks = 3;
+
         static constexpr uint32_t MicrosecondsPerMinute = 1000 * 1000 * 60;
 
         ThermalSubsystem(mpf::core::SubsystemList * list,
+                         storage::StorageSubsystem * storage,
                          hw::OneWireSubsystem * oneWire,
                          com::WifiSubsystem * wifiSubsystem,
-                         output::LightSubsystem *lightSubsystem);
+                         output::LightSubsystem *lightSubsystem,
+                         CurrentMonitorSubsystem * currentMonitor,
+                         HistorySubsystem * historySubsystem);
 
         ~ThermalSubsystem() override = default;
 
@@ -87,7 +123,7 @@ namespace kilight::status {
 
         State m_stateAfterWait = State::Invalid;
 
-        core::CriticalSection m_criticalSection;
+        storage::StorageSubsystem * const m_storage;
 
         hw::OneWireSubsystem * const m_oneWire;
 
@@ -95,27 +131,57 @@ namespace kilight::status {
 
         output::LightSubsystem * const m_lights;
 
+        CurrentMonitorSubsystem * const m_currentMonitor;
+
+        HistorySubsystem * const m_history;
+
         core::Alarm m_alarm;
 
-        uint32_t volatile m_tachometerCountSinceLastCheck = 0;
+        uint16_t m_tachometerCount = 0;
 
         uint64_t m_tachometerStartUs = 0;
 
         uint16_t m_fanRPM = 0;
 
+        uint16_t m_previousFanRPM = 0;
+
+        // Seconds the last RPM reading was measured over
+        float m_fanMeasurementSeconds = 0.0f;
+
+        uint16_t m_fanTargetRPM = 0;
+
+        float m_fanIntegralPerThou = 0.0f;
+
         uint16_t m_fanOutputPerThou = InitialFanOutputPerThou;
 
+        uint8_t m_fanStalledChecks = 0;
+
+        uint8_t m_fanRecoveredChecks = 0;
+
+        bool m_fanFault = false;
+
+        uint8_t m_derate = UINT8_MAX;
+
+        uint64_t m_lastThermalModelUpdateUs = 0;
+
+        // Where the thermal model has the driver's temperature rise from the outputs' power right now
+        float m_modelledRiseC = 0.0f;
+
+        // How much more the model expects the driver to warm up within the lead time, which the fan gets ahead of
+        float m_anticipatedRiseC = 0.0f;
+
         int16_t volatile m_driverTemperature = INT16_MIN;
 
         int16_t volatile m_powerSupplyTemperature = INT16_MIN;
 
-        int16_t volatile m_outputATemperature = INT16_MIN;
+        // INT16_MIN until a reading comes in
+        std::array<int16_t volatile, output::OutputCount> m_outputTemperatures {};
 
         bool m_driverCallbackRegistered = false;
 
         bool m_powerSupplyCallbackRegistered = false;
 
-        bool m_outputACallbackRegistered = false;
+        std::array<bool, output::OutputCount> m_outputCallbacksRegistered {};
 
         void preSleepState();
 
@@ -127,8 +193,28 @@ namespace kilight::status {
 
         void checkOverheatState();
 
+        void updateThermalModel();
+
+        [[nodiscard]]
+        int16_t fanControlTemp() const;
+
+        void calculateFanTargetRPM();
+
         void calculateFanOutput();
 
+        void checkFanStall();
+
+        void calculateDerate();
+
+        protocol::CommandResult processConfigureThermalDerating(
+            protocol::ConfigureThermalDerating const& configureThermalDerating);
+
+        protocol::CommandResult processConfigureThermalModel(
+            protocol::ConfigureThermalModel const& configureThermalModel);
+
+        protocol::CommandResult processConfigureThermometerResolution(
+            protocol::ConfigureThermometerResolution const& configureThermometerResolution);
+
         void wait(uint32_t waitTimeMs, State stateAfterWaiting);
 
     };
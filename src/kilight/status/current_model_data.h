@@ -0,0 +1,65 @@
+/**
+ * current_model_data.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+// ReSharper disable once CppUnusedIncludeDirective
+#include <compare>
+
+#include <mpf/util/macros.h>
+
+#include <kilight/protocol/ChannelCurrentModel.h>
+
+#include "kilight/output/rgbcw_color.h"
+
+namespace kilight::status {
+
+    static constexpr uint8_t ModelChannelCount = 5;
+
+    struct PACKED current_model_t {
+        // Drawn with every channel off
+        int16_t offsetMilliAmps = 0;
+
+        // Drawn by each channel at full duty, in the same order as colours everywhere else
+        std::array<uint16_t, ModelChannelCount> channelMilliAmps {};
+
+        // Fitted by the calibration routine, rather than never set
+        bool calibrated = false;
+
+        constexpr auto operator<=>(current_model_t const& other) const noexcept = default;
+
+        /**
+         * @param levels PWM levels actually written to the output
+         * @return Current the output should be drawing at those levels
+         */
+        [[nodiscard]]
+        uint32_t predict(output::rgbcw_color_t const& levels) const {
+            std::array<uint8_t, ModelChannelCount> const duties {
+                levels.red, levels.green, levels.blue, levels.coldWhite, levels.warmWhite
+            };
+            int32_t milliAmps = offsetMilliAmps;
+            for (uint8_t channel = 0; channel < ModelChannelCount; ++channel) {
+                milliAmps += static_cast<int32_t>(channelMilliAmps[channel]) * duties[channel] / UINT8_MAX;
+            }
+            return milliAmps > 0 ? static_cast<uint32_t>(milliAmps) : 0;
+        }
+
+        [[nodiscard]]
+        protocol::ChannelCurrentModel toChannelCurrentModel() const {
+            protocol::ChannelCurrentModel model;
+            model.set_offsetMilliAmps(offsetMilliAmps);
+            model.set_redMilliAmps(channelMilliAmps[0]);
+            model.set_greenMilliAmps(channelMilliAmps[1]);
+            model.set_blueMilliAmps(channelMilliAmps[2]);
+            model.set_coldWhiteMilliAmps(channelMilliAmps[3]);
+            model.set_warmWhiteMilliAmps(channelMilliAmps[4]);
+            model.set_calibrated(calibrated);
+            return model;
+        }
+    };
+}
@@ -0,0 +1,29 @@
+/**
+ * energy_data.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+// ReSharper disable once CppUnusedIncludeDirective
+#include <compare>
+
+#include <mpf/util/macros.h>
+
+#include "kilight/output/output_identifier.h"
+
+namespace kilight::status {
+
+    static constexpr uint64_t MicroJoulesPerMilliWattHour = 3600000;
+
+    struct PACKED energy_data_t {
+        // Energy each output has used since the counters were last cleared. Only checkpointed now and then, to keep
+        // flash wear down, so up to one checkpoint interval is lost on a reset.
+        std::array<uint64_t, output::OutputCount> outputMicroJoules {};
+
+        constexpr auto operator<=>(energy_data_t const& other) const noexcept = default;
+    };
+}
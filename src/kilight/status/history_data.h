@@ -0,0 +1,142 @@
+/**
+ * history_data.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <mpf/util/macros.h>
+
+#include "kilight/output/output_identifier.h"
+
+namespace kilight::status {
+
+    enum class HistorySeries : uint8_t {
+        // Hundredths of a degree
+        DriverTemperature,
+        PowerSupplyTemperature,
+        // RPM
+        FanRPM,
+        // Per-thou
+        FanOutput,
+        // One of each of these per output, hundredths of a degree and milliamps
+        OutputTemperature,
+        OutputCurrent
+    };
+
+    // Slots for every series, with the per-output series taking one slot per output
+    static constexpr uint8_t HistorySlotCount = 4 + 2 * output::OutputCount;
+
+    static constexpr uint8_t historySlot(HistorySeries const series, uint8_t const outputIndex) {
+        switch (series) {
+            using enum HistorySeries;
+        case OutputTemperature:
+            return static_cast<uint8_t>(OutputTemperature) + outputIndex;
+        case OutputCurrent:
+            return static_cast<uint8_t>(OutputTemperature) + output::OutputCount + outputIndex;
+        default:
+            return static_cast<uint8_t>(series);
+        }
+    }
+
+    struct PACKED history_bucket_t {
+        // Average of INT16_MIN marks a bucket nothing was recorded in
+        static constexpr int16_t NoData = INT16_MIN;
+
+        int16_t minimum = NoData;
+
+        int16_t maximum = NoData;
+
+        int16_t average = NoData;
+
+        [[nodiscard]]
+        constexpr bool empty() const {
+            return average == NoData;
+        }
+    };
+
+    using history_row_t = std::array<history_bucket_t, HistorySlotCount>;
+
+    /**
+     * Gathers values into a bucket. Either raw values, or the buckets of a finer tier, which are weighted evenly
+     * since they all cover the same length of time.
+     */
+    struct history_accumulator_t {
+        int32_t sum = 0;
+
+        uint16_t count = 0;
+
+        int16_t minimum = INT16_MAX;
+
+        int16_t maximum = INT16_MIN;
+
+        void add(int16_t const value) {
+            add(value, value, value);
+        }
+
+        void add(history_bucket_t const& bucket) {
+            if (!bucket.empty()) {
+                add(bucket.minimum, bucket.maximum, bucket.average);
+            }
+        }
+
+        [[nodiscard]]
+        history_bucket_t take() {
+            history_bucket_t bucket;
+            if (count > 0) {
+                bucket.minimum = minimum;
+                bucket.maximum = maximum;
+                bucket.average = static_cast<int16_t>(sum / count);
+            }
+            *this = {};
+            return bucket;
+        }
+
+    private:
+        void add(int16_t const low, int16_t const high, int16_t const average) {
+            sum += average;
+            ++count;
+            minimum = std::min(minimum, low);
+            maximum = std::max(maximum, high);
+        }
+    };
+
+    /**
+     * Fixed number of rows, where the newest overwrites the oldest once it's full.
+     */
+    template <size_t Capacity>
+    class HistoryRing {
+    public:
+        void push(history_row_t const& row) {
+            m_rows[m_next] = row;
+            m_next = (m_next + 1) % Capacity;
+            m_size = std::min(m_size + 1, Capacity);
+        }
+
+        /**
+         * @param age 0 for the newest row, counting back from there. Must be less than size().
+         */
+        [[nodiscard]]
+        history_row_t const& at(size_t const age) const {
+            return m_rows[(m_next + Capacity - 1 - age) % Capacity];
+        }
+
+        [[nodiscard]]
+        size_t size() const {
+            return m_size;
+        }
+
+    private:
+        std::array<history_row_t, Capacity> m_rows {};
+
+        size_t m_next = 0;
+
+        size_t m_size = 0;
+    };
+}
@@ -0,0 +1,38 @@
+/**
+ * power_budget.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+// ReSharper disable once CppUnusedIncludeDirective
+#include <compare>
+
+#include <mpf/util/macros.h>
+
+#include <kilight/protocol/ConfigurePowerBudget.h>
+
+namespace kilight::status {
+
+    struct PACKED power_budget_t {
+        // Most current all the outputs together may draw from the supply, 0 if only the per-output limits apply
+        uint16_t totalCurrentLimitMilliAmps = 0;
+
+        // Voltage of the supply the outputs run from, for energy metering. 0 if it hasn't been configured, in which
+        // case no energy is metered.
+        uint16_t supplyMilliVolts = 0;
+
+        constexpr auto operator<=>(power_budget_t const& other) const noexcept = default;
+
+        power_budget_t& operator=(protocol::ConfigurePowerBudget const& configurePowerBudget) {
+            totalCurrentLimitMilliAmps = static_cast<uint16_t>(
+                std::min<uint32_t>(configurePowerBudget.totalCurrentLimitMilliAmps(), UINT16_MAX));
+            supplyMilliVolts = static_cast<uint16_t>(
+                std::min<uint32_t>(configurePowerBudget.supplyMilliVolts(), UINT16_MAX));
+            return *this;
+        }
+    };
+}
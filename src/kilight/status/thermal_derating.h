@@ -0,0 +1,44 @@
+/**
+ * thermal_derating.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+// ReSharper disable once CppUnusedIncludeDirective
+#include <compare>
+
+#include <mpf/util/macros.h>
+
+#include <kilight/protocol/ConfigureThermalDerating.h>
+
+namespace kilight::status {
+
+    struct PACKED thermal_derating_t {
+        // Brightness starts coming down at this temperature, and reaches minimumLimit at the overheat trip point.
+        // At or above the trip point there's no curve left, so derating is off.
+        int8_t startTemperatureC = 65;
+
+        // Brightness ceiling just before the overheat trip, where 255 is full brightness
+        uint8_t minimumLimit = 64;
+
+        // Brightness ceiling while the fan is faulted, or 0 to leave brightness alone when it is
+        uint8_t fanFaultLimit = 128;
+
+        constexpr auto operator<=>(thermal_derating_t const& other) const noexcept = default;
+
+        thermal_derating_t& operator=(protocol::ConfigureThermalDerating const& configureThermalDerating) {
+            startTemperatureC = static_cast<int8_t>(std::clamp<int32_t>(configureThermalDerating.startTemperatureC(),
+                                                                        INT8_MIN,
+                                                                        INT8_MAX));
+            minimumLimit = static_cast<uint8_t>(std::min<uint32_t>(configureThermalDerating.minimumLimit(),
+                                                                   UINT8_MAX));
+            fanFaultLimit = static_cast<uint8_t>(std::min<uint32_t>(configureThermalDerating.fanFaultLimit(),
+                                                                    UINT8_MAX));
+            return *this;
+        }
+    };
+}
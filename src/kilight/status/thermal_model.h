@@ -0,0 +1,42 @@
+/**
+ * thermal_model.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+// ReSharper disable once CppUnusedIncludeDirective
+#include <compare>
+
+#include <mpf/util/macros.h>
+
+#include <kilight/protocol/ConfigureThermalModel.h>
+
+namespace kilight::status {
+
+    struct PACKED thermal_model_t {
+        // How far the driver ends up above where it started for each watt the outputs draw, in hundredths of a
+        // degree. 0 turns the model off, so the fan only follows the thermometers.
+        uint16_t thermalResistanceCentiCPerWatt = 150;
+
+        // How long the driver takes to get most of the way (63%) to its new temperature after the power changes
+        uint16_t timeConstantS = 240;
+
+        // How far ahead the fan plans for the heat that's on its way
+        uint16_t leadTimeS = 30;
+
+        constexpr auto operator<=>(thermal_model_t const& other) const noexcept = default;
+
+        thermal_model_t& operator=(protocol::ConfigureThermalModel const& configureThermalModel) {
+            thermalResistanceCentiCPerWatt = static_cast<uint16_t>(
+                std::min<uint32_t>(configureThermalModel.thermalResistanceCentiCPerWatt(), UINT16_MAX));
+            timeConstantS = static_cast<uint16_t>(
+                std::min<uint32_t>(configureThermalModel.timeConstantS(), UINT16_MAX));
+            leadTimeS = static_cast<uint16_t>(std::min<uint32_t>(configureThermalModel.leadTimeS(), UINT16_MAX));
+            return *this;
+        }
+    };
+}
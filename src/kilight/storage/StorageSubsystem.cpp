@@ -28,7 +28,9 @@ namespace kilight::storage {
 
     static constexpr size_t SaveDataTotalAvailableSize = FLASH_SECTOR_SIZE;
 
-    static constexpr size_t SaveDataWriteSize = FLASH_PAGE_SIZE;
+    // Flash can only be programmed a whole page at a time, so round the save data (plus its CRC) up to the next page
+    static constexpr size_t SaveDataWriteSize =
+        (sizeof(save_data_t) + sizeof(uint16_t) + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE * FLASH_PAGE_SIZE;
 
     static constexpr uintptr_t SaveDataFlashOffset = PICO_FLASH_SIZE_BYTES - SaveDataTotalAvailableSize;
 
@@ -50,6 +52,10 @@ namespace kilight::storage {
         return SaveDataPtr->data;
     }
 
+    save_data_t const& StorageSubsystem::pendingData() const {
+        return m_pendingSaveData;
+    }
+
     bool StorageSubsystem::saveDataValid() {
         uint16_t const calculatedCRC = MathUtil::crc16(SaveDataPtr->data);
         return SaveDataPtr->crc == calculatedCRC;
@@ -63,8 +69,7 @@ namespace kilight::storage {
         if (!saveDataValid()) {
             INFO("No valid save data found, initializing with defaults");
             m_pendingSaveData = save_data_t{
-                .wifi = com::wifi_data_t(getWifiConfig()),
-                .outputA = output::output_data_t{}
+                .wifi = com::wifi_data_t(getWifiConfig())
             };
             writePendingData();
         } else {
@@ -117,21 +122,20 @@ namespace kilight::storage {
     }
 
     void StorageSubsystem::writePendingData() {
-        save_data_wrapper_t dataToWrite;
+        // Save data spans several pages now, which is too much to keep on the stack
+        static save_data_wrapper_t dataToWrite;
         m_criticalSection.enter();
         dataToWrite.data = m_pendingSaveData;
         m_criticalSection.exit();
         dataToWrite.crc = MathUtil::crc16(dataToWrite.data);
 
-        auto buff = std::bit_cast<array<uint8_t, SaveDataWriteSize>>(dataToWrite);
-
         // ReSharper disable once CppParameterMayBeConstPtrOrRef
         flash_safe_execute([](void * context) {
-                               auto const innerBuff = static_cast<array<uint8_t, SaveDataWriteSize> const*>(context);
+                               auto const innerBuff = static_cast<uint8_t const*>(context);
                                flash_range_erase(SaveDataFlashOffset, SaveDataTotalAvailableSize);
-                               flash_range_program(SaveDataFlashOffset, innerBuff->data(), SaveDataWriteSize);
+                               flash_range_program(SaveDataFlashOffset, innerBuff, SaveDataWriteSize);
                            },
-                           &buff,
+                           reinterpret_cast<uint8_t *>(&dataToWrite),
                            UINT32_MAX);
     }
 }
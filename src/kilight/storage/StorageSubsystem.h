@@ -9,8 +9,6 @@
 #include <mpf/core/Logging.h>
 #include <mpf/core/Subsystem.h>
 
-#include <kilight/protocol/OutputIdentifier.h>
-
 #include "kilight/core/Alarm.h"
 #include "kilight/storage/save_data.h"
 #include "kilight/core/CriticalSection.h"
@@ -39,19 +37,25 @@ namespace kilight::storage {
 
         void work() override;
 
+        [[nodiscard]]
+        save_data_t const & pendingData() const;
+
         template<typename FuncT>
         void updatePendingData(FuncT && updateFunction) {
             updateFunction(m_pendingSaveData);
         }
 
         template <typename UpdateFuncT>
-        void updatePendingOutputData(protocol::OutputIdentifier const outputId, UpdateFuncT&& updateFunc) {
-            if (outputId == protocol::OutputIdentifier::OutputA) {
-                updateFunc(m_pendingSaveData.outputA);
-            } else if (outputId == protocol::OutputIdentifier::OutputB) {
-                #ifdef KILIGHT_HAS_OUTPUT_B
-                updateFunc(m_pendingSaveData.outputB);
-                #endif
+        void updatePendingOutputData(uint8_t const outputIndex, UpdateFuncT&& updateFunc) {
+            if (outputIndex < m_pendingSaveData.outputs.size()) {
+                updateFunc(m_pendingSaveData.outputs[outputIndex]);
+            }
+        }
+
+        template <typename UpdateFuncT>
+        void updatePendingOutputConfig(uint8_t const outputIndex, UpdateFuncT&& updateFunc) {
+            if (outputIndex < m_pendingSaveData.outputConfigs.size()) {
+                updateFunc(m_pendingSaveData.outputConfigs[outputIndex]);
             }
         }
 
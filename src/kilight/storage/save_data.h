@@ -8,9 +8,21 @@
 
 #include <mpf/util/macros.h>
 
+#include <array>
+
+#include "kilight/output/effect_data.h"
+#include "kilight/output/output_config.h"
 #include "kilight/output/output_data.h"
+#include "kilight/output/output_identifier.h"
+#include "kilight/output/preset_data.h"
+#include "kilight/output/schedule_data.h"
 #include "kilight/com/wifi_data.h"
 #include "kilight/hw/onewire_address.h"
+#include "kilight/status/current_model_data.h"
+#include "kilight/status/energy_data.h"
+#include "kilight/status/power_budget.h"
+#include "kilight/status/thermal_derating.h"
+#include "kilight/status/thermal_model.h"
 
 namespace kilight::storage {
 
@@ -18,24 +30,45 @@ namespace kilight::storage {
         struct PACKED thermometer_addresses_t {
             hw::onewire_address_t powerSupply = {};
 
-            hw::onewire_address_t outputA = {};
-
-            #ifdef KILIGHT_HAS_OUTPUT_B
-            hw::onewire_address_t outputB = {};
-            #endif
+            std::array<hw::onewire_address_t, output::OutputCount> outputs = {};
 
             constexpr auto operator<=>(thermometer_addresses_t const &other) const noexcept = default;
         };
 
+        // Bits of resolution for the thermometer in each role, 9 to 12, or 0 for the default
+        struct PACKED thermometer_resolutions_t {
+            uint8_t powerSupply = 0;
+
+            std::array<uint8_t, output::OutputCount> outputs = {};
+
+            constexpr auto operator<=>(thermometer_resolutions_t const &other) const noexcept = default;
+        };
+
         com::wifi_data_t wifi = {};
 
         thermometer_addresses_t thermometerAddresses = {};
 
-        output::output_data_t outputA = {};
+        thermometer_resolutions_t thermometerResolutions = {};
+
+        std::array<output::output_data_t, output::OutputCount> outputs = {};
+
+        std::array<output::output_config_t, output::OutputCount> outputConfigs = {};
+
+        std::array<output::effect_program_t, output::MaxEffectPrograms> effects = {};
+
+        std::array<output::preset_t, output::MaxPresets> presets = {};
+
+        output::schedule_t schedule = {};
+
+        status::power_budget_t powerBudget = {};
+
+        status::thermal_derating_t thermalDerating = {};
+
+        status::thermal_model_t thermalModel = {};
+
+        status::energy_data_t energy = {};
 
-        #ifdef KILIGHT_HAS_OUTPUT_B
-        output::output_data_t outputB = {};
-        #endif
+        std::array<status::current_model_t, output::OutputCount> currentModels = {};
 
         constexpr auto operator<=>(save_data_t const &other) const noexcept = default;
     };
@@ -12,6 +12,8 @@
 #include <cstring>
 #include <span>
 
+#include <pico/platform.h>
+
 namespace kilight::util {
 
     class MathUtil {
@@ -20,9 +22,8 @@ namespace kilight::util {
 
         template<typename DataT>
         static uint16_t crc16(DataT const & data) {
-            std::array<std::byte, sizeof(DataT)> buffer;
-            memcpy(buffer.begin(), &data, sizeof(DataT));
-            return crc16(std::span<std::byte const>{buffer});
+            // The CRC is calculated by DMA straight out of memory, so there's no need to copy the data first
+            return crc16(std::span<std::byte const>{reinterpret_cast<std::byte const *>(&data), sizeof(DataT)});
         }
 
         static uint8_t crc8(std::span<std::byte const> data);
@@ -45,21 +46,81 @@ namespace kilight::util {
          * @return If first is equal to second, returns 0. If first is greater than second, returns 1. Otherwise, returns -1
          */
         template<typename NumberT>
-        static int8_t deltaDirection(NumberT const first, NumberT const second) {
-            if (first == second) {
-                return 0;
-            }
-            if (first > second) {
-                return 1;
-            }
-            return -1;
+        static constexpr __force_inline int8_t deltaDirection(NumberT const first, NumberT const second) {
+            // Comparisons give 0 or 1, so this compiles down to flag-setting instructions rather than branches
+            return static_cast<int8_t>(static_cast<int8_t>(first > second) - static_cast<int8_t>(first < second));
         }
 
         template<typename NumberT>
-        static NumberT incrementBetween(NumberT const from, NumberT const to) {
+        static constexpr __force_inline NumberT incrementBetween(NumberT const from, NumberT const to) {
             return static_cast<NumberT>(from + deltaDirection(to, from));
         }
 
+        /**
+         * Divides the product of two 8-bit values by 255, rounded to the nearest integer, using a multiply-free
+         * shift-and-add instead of a divide.
+         *
+         * @param value Product of two numbers from 0 to 255
+         * @return value / 255, rounded to nearest
+         */
+        static constexpr __force_inline uint32_t divideBy255Rounded(uint32_t const value) {
+            uint32_t const biased = value + 128U;
+            return (biased + (biased >> 8U)) >> 8U;
+        }
+
+        /**
+         * Scales four 8-bit values at once by scale / 255, rounded to nearest. Each value sits in the low byte of
+         * its own 16-bit lane, which leaves room for the full 16-bit product, so one 64-bit multiply and a few
+         * shifts and masks do the work of four divideBy255Rounded() calls.
+         *
+         * @param lanes Four 8-bit values, one in the low byte of each 16-bit lane
+         * @param scale Scale to apply, where 255 leaves the values unchanged
+         * @return The scaled values, in the same lanes
+         */
+        static constexpr __force_inline uint64_t scaleLanesBy255(uint64_t const lanes, uint8_t const scale) {
+            constexpr uint64_t LowByteMask = 0x00FF00FF00FF00FFULL;
+            constexpr uint64_t RoundingBias = 0x0080008000800080ULL;
+            uint64_t const biased = lanes * scale + RoundingBias;
+            return ((biased + ((biased >> 8U) & LowByteMask)) >> 8U) & LowByteMask;
+        }
+
+        /**
+         * Linearly interpolates between two numbers.
+         *
+         * @tparam NumberT Type of numbers to interpolate between
+         * @param from Value at the start of the range
+         * @param to Value at the end of the range
+         * @param position How far along the range to interpolate
+         * @param length Total length of the range
+         * @return from when position is 0, to when position is at or past length, otherwise a value in between
+         */
+        template<typename NumberT>
+        static __force_inline NumberT interpolate(NumberT const from,
+                                                  NumberT const to,
+                                                  uint32_t const position,
+                                                  uint32_t const length) {
+            if (position >= length) {
+                return to;
+            }
+            auto const delta = static_cast<int64_t>(to) - static_cast<int64_t>(from);
+            return static_cast<NumberT>(static_cast<int64_t>(from) +
+                                        delta * static_cast<int64_t>(position) / static_cast<int64_t>(length));
+        }
+
+        /**
+         * Advances a xorshift32 pseudo-random number generator. Not suitable for anything that needs real
+         * randomness, but cheap enough to call from interrupt handlers.
+         *
+         * @param state Generator state, must never be 0
+         * @return The next pseudo-random number
+         */
+        static constexpr __force_inline uint32_t xorshift32(uint32_t & state) {
+            state ^= state << 13U;
+            state ^= state >> 17U;
+            state ^= state << 5U;
+            return state;
+        }
+
         MathUtil() = delete;
 
         ~MathUtil() = delete;
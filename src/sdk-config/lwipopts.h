@@ -53,6 +53,10 @@
 #define LWIP_DNS                    1
 #define LWIP_TCP_KEEPALIVE          1
 #define LWIP_MDNS_RESPONDER         1
+#define SNTP_SERVER_DNS             1
+// The always-on timer keeps good enough time that once a day is plenty
+#define SNTP_UPDATE_DELAY           (24 * 60 * 60 * 1000)
+#define SNTP_SET_SYSTEM_TIME(sec)   kilight_sntp_set_system_time(sec)
 #define LWIP_NETIF_TX_SINGLE_PBUF   1
 #define DHCP_DOES_ARP_CHECK         0
 #define LWIP_DHCP_DOES_ACD_CHECK    0
@@ -95,3 +99,10 @@
 
 // We only have one IF and so don't need routing etc. code
 #define LWIP_SINGLE_NETIF 1
+
+// Implemented by ScheduleSubsystem
+#include <stdint.h>
+#ifdef __cplusplus
+extern "C"
+#endif
+void kilight_sntp_set_system_time(uint32_t seconds);
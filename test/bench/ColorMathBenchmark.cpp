@@ -0,0 +1,146 @@
+/**
+ * ColorMathBenchmark.cpp
+ *
+ * Compares the colour math on the fade tick and PWM write paths against the divide and branch based versions it
+ * replaced. Only a guide to the relative cost, since the host's divider and branch predictor are nothing like the
+ * Cortex-M33's.
+ *
+ * @author Patrick Lavigne
+ */
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+#include <benchmark/benchmark.h>
+
+#include "kilight/output/rgbcw_color.h"
+#include "kilight/util/MathUtil.h"
+
+using kilight::output::rgbcw_color_t;
+using kilight::output::rgbcw_color_volatile_t;
+using kilight::util::MathUtil;
+
+namespace {
+    // The versions replaced by the fixed-point ones, kept here to measure against
+    namespace previous {
+        template <typename NumberT>
+        int8_t deltaDirection(NumberT const first, NumberT const second) {
+            if (first == second) {
+                return 0;
+            }
+            if (first > second) {
+                return 1;
+            }
+            return -1;
+        }
+
+        template <typename NumberT>
+        NumberT incrementBetween(NumberT const from, NumberT const to) {
+            return static_cast<NumberT>(from + deltaDirection(to, from));
+        }
+
+        template <typename ColorT, typename OtherColorT>
+        void incrementTowards(ColorT& color, OtherColorT const& other) {
+            color.red = incrementBetween(color.red, other.red);
+            color.green = incrementBetween(color.green, other.green);
+            color.blue = incrementBetween(color.blue, other.blue);
+            color.coldWhite = incrementBetween(color.coldWhite, other.coldWhite);
+            color.warmWhite = incrementBetween(color.warmWhite, other.warmWhite);
+        }
+
+        template <typename ColorT>
+        rgbcw_color_t scaledBy(ColorT const& color, uint8_t const scaleFactor) {
+            constexpr uint32_t Max = std::numeric_limits<uint8_t>::max();
+            return rgbcw_color_t{
+                    static_cast<uint8_t>(static_cast<uint32_t>(color.red) * scaleFactor / Max),
+                    static_cast<uint8_t>(static_cast<uint32_t>(color.green) * scaleFactor / Max),
+                    static_cast<uint8_t>(static_cast<uint32_t>(color.blue) * scaleFactor / Max),
+                    static_cast<uint8_t>(static_cast<uint32_t>(color.coldWhite) * scaleFactor / Max),
+                    static_cast<uint8_t>(static_cast<uint32_t>(color.warmWhite) * scaleFactor / Max)
+                };
+        }
+    }
+
+    constexpr size_t InputCount = 1024;
+
+    struct inputs_t {
+        std::array<rgbcw_color_t, InputCount> colors {};
+
+        std::array<uint8_t, InputCount> scales {};
+    };
+
+    inputs_t const& inputs() {
+        static inputs_t const generated = [] {
+            inputs_t result;
+            uint32_t state = 0x12345678;
+            for (size_t index = 0; index < InputCount; ++index) {
+                uint32_t const bits = MathUtil::xorshift32(state);
+                result.colors[index] = rgbcw_color_t{
+                        static_cast<uint8_t>(bits),
+                        static_cast<uint8_t>(bits >> 8U),
+                        static_cast<uint8_t>(bits >> 16U),
+                        static_cast<uint8_t>(bits >> 24U),
+                        static_cast<uint8_t>(MathUtil::xorshift32(state))
+                    };
+                result.scales[index] = static_cast<uint8_t>(MathUtil::xorshift32(state));
+            }
+            return result;
+        }();
+        return generated;
+    }
+
+    // Scaling a volatile colour by the output's brightness, like every PWM write does
+
+    void scaledByDivide(benchmark::State& state) {
+        inputs_t const& in = inputs();
+        rgbcw_color_volatile_t color {};
+        size_t index = 0;
+        for (auto _ : state) {
+            color = in.colors[index];
+            benchmark::DoNotOptimize(previous::scaledBy(color, in.scales[index]));
+            index = (index + 1) % InputCount;
+        }
+    }
+    BENCHMARK(scaledByDivide);
+
+    void scaledBySWAR(benchmark::State& state) {
+        inputs_t const& in = inputs();
+        rgbcw_color_volatile_t color {};
+        size_t index = 0;
+        for (auto _ : state) {
+            color = in.colors[index];
+            benchmark::DoNotOptimize(color.scaledBy<rgbcw_color_t>(in.scales[index]));
+            index = (index + 1) % InputCount;
+        }
+    }
+    BENCHMARK(scaledBySWAR);
+
+    // One fade tick step of a volatile colour towards a target
+
+    void incrementTowardsBranching(benchmark::State& state) {
+        inputs_t const& in = inputs();
+        rgbcw_color_volatile_t color {};
+        size_t index = 0;
+        for (auto _ : state) {
+            previous::incrementTowards(color, in.colors[index]);
+            index = (index + 1) % InputCount;
+        }
+        benchmark::DoNotOptimize(rgbcw_color_t{color});
+    }
+    BENCHMARK(incrementTowardsBranching);
+
+    void incrementTowardsBranchFree(benchmark::State& state) {
+        inputs_t const& in = inputs();
+        rgbcw_color_volatile_t color {};
+        size_t index = 0;
+        for (auto _ : state) {
+            color.incrementTowards(in.colors[index]);
+            index = (index + 1) % InputCount;
+        }
+        benchmark::DoNotOptimize(rgbcw_color_t{color});
+    }
+    BENCHMARK(incrementTowardsBranchFree);
+}
+
+BENCHMARK_MAIN();
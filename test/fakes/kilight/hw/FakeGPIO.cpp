@@ -0,0 +1,95 @@
+/**
+ * FakeGPIO.cpp
+ *
+ * GPIOWrapper, backed by FakeGPIO instead of the Pico SDK.
+ *
+ * @author Patrick Lavigne
+ */
+
+#include "kilight/hw/FakeGPIO.h"
+
+namespace kilight::hw {
+
+    void GPIOWrapper::initPin(uint8_t const gpioNumber, PinFunction const pinFunction) {
+        FakeGPIO::pins.at(gpioNumber).function = pinFunction;
+    }
+
+    void GPIOWrapper::setDirection(uint8_t const gpioNumber, bool const output) {
+        FakeGPIO::pins.at(gpioNumber).output = output;
+    }
+
+    void GPIOWrapper::setPull(uint8_t, GPIOPullDirection) {
+    }
+
+    void GPIOWrapper::write(uint8_t const gpioNumber, bool const val) {
+        FakeGPIO::pins.at(gpioNumber).value = val;
+    }
+
+    bool GPIOWrapper::read(uint8_t const gpioNumber) {
+        return FakeGPIO::pins.at(gpioNumber).value;
+    }
+
+    void GPIOWrapper::toggle(uint8_t const gpioNumber) {
+        FakeGPIO::pins.at(gpioNumber).value = !FakeGPIO::pins.at(gpioNumber).value;
+    }
+
+    void GPIOWrapper::enablePWM(uint8_t const gpioNumber, uint32_t const frequencyHz, uint16_t const top) {
+        configurePWM(gpioNumber, frequencyHz, top, 0);
+        FakeGPIO::pins.at(gpioNumber).pwmLevel = 0;
+        FakeGPIO::startedPWMSlices |= pwmSliceMask(gpioNumber);
+    }
+
+    void GPIOWrapper::configurePWM(uint8_t const gpioNumber,
+                                   uint32_t const frequencyHz,
+                                   uint16_t const top,
+                                   uint16_t const counter) {
+        FakeGPIO::pwm_slice_state_t& slice = FakeGPIO::pwmSlices.at(pwmSliceFor(gpioNumber));
+        slice.frequencyHz = frequencyHz;
+        slice.top = top;
+        slice.counter = counter;
+        FakeGPIO::startedPWMSlices &= ~pwmSliceMask(gpioNumber);
+    }
+
+    uint32_t GPIOWrapper::pwmSliceMask(uint8_t const gpioNumber) {
+        return 1U << pwmSliceFor(gpioNumber);
+    }
+
+    void GPIOWrapper::startPWMSlices(uint32_t const sliceMask) {
+        FakeGPIO::startedPWMSlices |= sliceMask;
+    }
+
+    void GPIOWrapper::writePWM(uint8_t const gpioNumber, uint16_t const value) {
+        FakeGPIO::pins.at(gpioNumber).pwmLevel = value;
+        ++FakeGPIO::pwmWrites;
+    }
+
+    void GPIOWrapper::enablePWMEdgeCounting(uint8_t const gpioNumber) {
+        FakeGPIO::pwmSlices.at(pwmSliceFor(gpioNumber)).counter = 0;
+        FakeGPIO::startedPWMSlices |= pwmSliceMask(gpioNumber);
+    }
+
+    uint16_t GPIOWrapper::readPWMCounter(uint8_t const gpioNumber) {
+        return FakeGPIO::pwmSlices.at(pwmSliceFor(gpioNumber)).counter;
+    }
+
+    void GPIOWrapper::interruptWrapper(unsigned int const gpio, uint32_t const trigger) {
+        if (interrupts[gpio]) {
+            interrupts[gpio](static_cast<uint8_t>(gpio), static_cast<GPIOInterruptTrigger>(trigger));
+        }
+    }
+
+    void GPIOWrapper::setInterrupt(uint8_t const gpioNumber,
+                                   GPIOInterruptTrigger,
+                                   GPIOInterruptCallback const& callback) {
+        interrupts[gpioNumber] = callback;
+    }
+
+    void GPIOWrapper::enableADC(uint8_t const gpioNumber) {
+        FakeGPIO::pins.at(gpioNumber).adc = true;
+    }
+
+    uint16_t GPIOWrapper::readADC(uint8_t) {
+        return 0;
+    }
+
+}
@@ -0,0 +1,72 @@
+/**
+ * FakeGPIO.h
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "kilight/hw/Pin.h"
+
+namespace kilight::hw {
+
+    struct fake_pin_state_t {
+        PinFunction function = PinFunction::None;
+
+        bool adc = false;
+
+        bool output = false;
+
+        bool value = false;
+
+        uint16_t pwmLevel = 0;
+    };
+
+    // Both of a slice's pins run off its one counter, so everything but the level is kept per slice
+    struct fake_pwm_slice_state_t {
+        uint32_t frequencyHz = 0;
+
+        uint16_t top = 0;
+
+        uint16_t counter = 0;
+    };
+
+    /**
+     * Stands in for the hardware behind GPIOWrapper on the host, keeping what was last done to each pin so tests can
+     * check it.
+     */
+    class FakeGPIO final {
+    public:
+        using pin_state_t = fake_pin_state_t;
+
+        using pwm_slice_state_t = fake_pwm_slice_state_t;
+
+        static inline std::array<pin_state_t, NUM_BANK0_GPIOS> pins {};
+
+        static inline std::array<pwm_slice_state_t, NUM_PWM_SLICES> pwmSlices {};
+
+        // Slices started together through GPIOWrapper::startPWMSlices()
+        static inline uint32_t startedPWMSlices = 0;
+
+        static inline uint32_t pwmWrites = 0;
+
+        static void reset() {
+            pins = {};
+            pwmSlices = {};
+            startedPWMSlices = 0;
+            pwmWrites = 0;
+        }
+
+        static pwm_slice_state_t const& pwmSliceFor(uint8_t const gpioNumber) {
+            return pwmSlices.at(GPIOWrapper::pwmSliceFor(gpioNumber));
+        }
+
+        FakeGPIO() = delete;
+
+        ~FakeGPIO() = delete;
+    };
+
+}
@@ -0,0 +1,83 @@
+/**
+ * OverCurrentGuardTest.cpp
+ *
+ * @author Patrick Lavigne
+ */
+
+#include <gtest/gtest.h>
+
+#include "kilight/hw/FakeGPIO.h"
+#include "kilight/hw/OverCurrentGuard.h"
+#include "kilight/hw/SystemPins.h"
+
+namespace kilight::hw {
+
+    namespace {
+        class OverCurrentGuardTest : public testing::Test {
+        protected:
+            void SetUp() override {
+                FakeGPIO::reset();
+                for (uint8_t index = 0; index < SystemPins::OutputCount; ++index) {
+                    OverCurrentGuard::reset(index);
+                }
+                SystemPins::forEachOutput([]<typename PinGroupT>(uint8_t) {
+                    PinGroupT::writePWM({255, 255, 255, 255, 255});
+                });
+            }
+
+            static std::array<uint16_t, 5> levels(uint8_t const outputIndex) {
+                std::array<uint16_t, 5> result {};
+                SystemPins::withOutput(outputIndex, [&result]<typename PinGroupT>(uint8_t) {
+                    result = {
+                        FakeGPIO::pins[PinGroupT::Red::Number].pwmLevel,
+                        FakeGPIO::pins[PinGroupT::Green::Number].pwmLevel,
+                        FakeGPIO::pins[PinGroupT::Blue::Number].pwmLevel,
+                        FakeGPIO::pins[PinGroupT::ColdWhite::Number].pwmLevel,
+                        FakeGPIO::pins[PinGroupT::WarmWhite::Number].pwmLevel
+                    };
+                });
+                return result;
+            }
+        };
+    }
+
+    TEST_F(OverCurrentGuardTest, TripZeroesOnlyThatOutput) {
+        for (uint8_t tripped = 0; tripped < SystemPins::OutputCount; ++tripped) {
+            SetUp();
+            OverCurrentGuard::trip(tripped);
+
+            EXPECT_EQ(OverCurrentGuard::trippedOutputs(), 1U << tripped);
+            for (uint8_t index = 0; index < SystemPins::OutputCount; ++index) {
+                EXPECT_EQ(OverCurrentGuard::tripped(index), index == tripped);
+                std::array<uint16_t, 5> const expected = index == tripped
+                                                             ? std::array<uint16_t, 5> {}
+                                                             : std::array<uint16_t, 5> {255, 255, 255, 255, 255};
+                EXPECT_EQ(levels(index), expected) << "output " << static_cast<int>(index);
+            }
+        }
+    }
+
+    TEST_F(OverCurrentGuardTest, EnforceUndoesAWriteAfterATrip) {
+        uint8_t const last = SystemPins::OutputCount - 1;
+        OverCurrentGuard::trip(last);
+        SystemPins::withOutput(last, []<typename PinGroupT>(uint8_t) {
+            PinGroupT::writePWM({1, 2, 3, 4, 5});
+        });
+
+        EXPECT_TRUE(OverCurrentGuard::enforce(last));
+        EXPECT_EQ(levels(last), (std::array<uint16_t, 5> {}));
+    }
+
+    TEST_F(OverCurrentGuardTest, ResetClearsTheLatch) {
+        OverCurrentGuard::trip(0);
+        OverCurrentGuard::reset(0);
+
+        EXPECT_FALSE(OverCurrentGuard::tripped(0));
+        EXPECT_EQ(OverCurrentGuard::trippedOutputs(), 0U);
+        SystemPins::withOutput(0, []<typename PinGroupT>(uint8_t) {
+            PinGroupT::writePWM({1, 2, 3, 4, 5});
+        });
+        EXPECT_FALSE(OverCurrentGuard::enforce(0));
+        EXPECT_EQ(levels(0), (std::array<uint16_t, 5> {1, 2, 3, 4, 5}));
+    }
+}
@@ -0,0 +1,207 @@
+/**
+ * SystemPinsTest.cpp
+ *
+ * @author Patrick Lavigne
+ */
+
+#include <bit>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kilight/hw/FakeGPIO.h"
+#include "kilight/hw/SystemPins.h"
+
+namespace kilight::hw {
+
+    namespace {
+        struct output_pins_t {
+            std::array<uint8_t, 5> pwm;
+
+            uint8_t currentSense;
+        };
+
+        std::vector<output_pins_t> outputPins() {
+            std::vector<output_pins_t> result;
+            SystemPins::forEachOutput([&result]<typename PinGroupT>(uint8_t) {
+                result.push_back({
+                    {
+                        PinGroupT::Red::Number,
+                        PinGroupT::Green::Number,
+                        PinGroupT::Blue::Number,
+                        PinGroupT::ColdWhite::Number,
+                        PinGroupT::WarmWhite::Number
+                    },
+                    PinGroupT::CurrentSense::Number
+                });
+            });
+            return result;
+        }
+
+        class SystemPinsTest : public testing::Test {
+        protected:
+            void SetUp() override {
+                FakeGPIO::reset();
+            }
+        };
+    }
+
+    TEST_F(SystemPinsTest, HasOutputCountFromTheBoard) {
+        EXPECT_EQ(SystemPins::OutputCount, KILIGHT_NUMBER_OF_OUTPUTS);
+
+        std::vector<uint8_t> visited;
+        SystemPins::forEachOutput([&visited]<typename PinGroupT>(uint8_t const outputIndex) {
+            visited.push_back(outputIndex);
+        });
+        ASSERT_EQ(visited.size(), SystemPins::OutputCount);
+        for (uint8_t index = 0; index < SystemPins::OutputCount; ++index) {
+            EXPECT_EQ(visited[index], index);
+        }
+    }
+
+    TEST_F(SystemPinsTest, WithOutputOnlyWritesThatOutput) {
+        std::vector<output_pins_t> const pins = outputPins();
+        for (uint8_t target = 0; target < SystemPins::OutputCount; ++target) {
+            FakeGPIO::reset();
+            SystemPins::withOutput(target, []<typename PinGroupT>(uint8_t) {
+                PinGroupT::writePWM({10, 20, 30, 40, 50});
+            });
+
+            for (uint8_t index = 0; index < SystemPins::OutputCount; ++index) {
+                for (uint8_t channel = 0; channel < 5; ++channel) {
+                    uint16_t const expected = index == target ? 10 * (channel + 1) : 0;
+                    EXPECT_EQ(FakeGPIO::pins[pins[index].pwm[channel]].pwmLevel, expected)
+                        << "output " << static_cast<int>(index) << " channel " << static_cast<int>(channel);
+                }
+            }
+            EXPECT_EQ(FakeGPIO::pwmWrites, 5U);
+        }
+    }
+
+    TEST_F(SystemPinsTest, OutputsDontShareAPinOrPWMChannel) {
+        std::set<uint8_t> usedPins {
+            SystemPins::FanTacho::Number,
+            SystemPins::FanPWM::Number,
+            SystemPins::ClearButton::Number,
+            SystemPins::DebugUARTTxD::Number,
+            SystemPins::DebugUARTRxD::Number,
+            SystemPins::ActivityLED::Number,
+            SystemPins::StatusLED::Number,
+            SystemPins::SDA::Number,
+            SystemPins::SCL::Number
+        };
+        // Two pins on the same slice and the same A or B channel always show the same level
+        std::set<std::pair<uint8_t, uint8_t>> usedPWMChannels {
+            {SystemPins::FanPWM::PWMSlice, SystemPins::FanPWM::Number % 2}
+        };
+
+        for (output_pins_t const& output : outputPins()) {
+            for (uint8_t const pin : output.pwm) {
+                EXPECT_LT(pin, NUM_BANK0_GPIOS);
+                EXPECT_TRUE(usedPins.insert(pin).second) << "pin " << static_cast<int>(pin) << " used twice";
+                EXPECT_TRUE(usedPWMChannels.insert({GPIOWrapper::pwmSliceFor(pin), pin % 2}).second)
+                    << "PWM channel of pin " << static_cast<int>(pin) << " used twice";
+            }
+            EXPECT_GE(output.currentSense, ADC_BASE_PIN);
+            EXPECT_LT(output.currentSense, NUM_BANK0_GPIOS);
+            EXPECT_TRUE(usedPins.insert(output.currentSense).second)
+                << "pin " << static_cast<int>(output.currentSense) << " used twice";
+        }
+    }
+
+    TEST_F(SystemPinsTest, SlicesMatchTheSDKMapping) {
+        EXPECT_EQ(GPIOWrapper::pwmSliceFor(0), 0);
+        EXPECT_EQ(GPIOWrapper::pwmSliceFor(9), 4);
+        EXPECT_EQ(GPIOWrapper::pwmSliceFor(16), 0);
+        EXPECT_EQ(GPIOWrapper::pwmSliceFor(31), 7);
+        EXPECT_EQ(GPIOWrapper::pwmSliceFor(32), 8);
+        EXPECT_EQ(GPIOWrapper::pwmSliceFor(39), 11);
+        EXPECT_EQ(GPIOWrapper::pwmSliceFor(40), 8);
+        EXPECT_EQ(GPIOWrapper::pwmSliceFor(47), 11);
+    }
+
+    TEST_F(SystemPinsTest, CurrentSenseMaskHasOneChannelPerOutput) {
+        EXPECT_EQ(std::popcount(SystemPins::CurrentSenseADCMask), SystemPins::OutputCount);
+        SystemPins::forEachOutput([]<typename PinGroupT>(uint8_t) {
+            EXPECT_NE(SystemPins::CurrentSenseADCMask & (1U << PinGroupT::CurrentSense::ADCChannel), 0U);
+        });
+    }
+
+    TEST_F(SystemPinsTest, ADCPacingSliceIsFree) {
+        if (!SystemPins::HasADCPacingPWMSlice) {
+            EXPECT_FALSE(KILIGHT_ADC_PWM_SYNCHRONOUS);
+            return;
+        }
+        EXPECT_LT(SystemPins::ADCPacingPWMSlice, NUM_PWM_SLICES);
+        EXPECT_EQ(SystemPins::UsedPWMSliceMask & (1U << SystemPins::ADCPacingPWMSlice), 0U);
+    }
+
+    TEST_F(SystemPinsTest, InitPinsSetsUpEveryChannel) {
+        SystemPins::forEachOutput([]<typename PinGroupT>(uint8_t) {
+            PinGroupT::initPins();
+        });
+        for (output_pins_t const& output : outputPins()) {
+            for (uint8_t const pin : output.pwm) {
+                EXPECT_EQ(FakeGPIO::pins[pin].function, PinFunction::PWM);
+            }
+            EXPECT_TRUE(FakeGPIO::pins[output.currentSense].adc);
+        }
+    }
+
+    TEST_F(SystemPinsTest, StaggeredPWMSpreadsChannelsThroughThePeriod) {
+        SystemPins::forEachOutput([]<typename PinGroupT>(uint8_t) {
+            PinGroupT::enablePWM(PWMPhaseMode::Staggered);
+        });
+
+        uint16_t const phaseStep = SystemPins::Output<0>::Red::PWMCount / 5;
+        for (output_pins_t const& output : outputPins()) {
+            for (uint8_t channel = 0; channel < 5; ++channel) {
+                FakeGPIO::pwm_slice_state_t const& slice = FakeGPIO::pwmSliceFor(output.pwm[channel]);
+                EXPECT_EQ(slice.counter, channel * phaseStep);
+                EXPECT_EQ(slice.top, SystemPins::Output<0>::Red::PWMTop);
+                EXPECT_NE(FakeGPIO::startedPWMSlices & (1U << GPIOWrapper::pwmSliceFor(output.pwm[channel])), 0U);
+            }
+        }
+        EXPECT_EQ(FakeGPIO::startedPWMSlices, SystemPins::OutputPWMSliceMask);
+    }
+
+    TEST_F(SystemPinsTest, OutputsOnTheSameSlicesShareAPhaseMode) {
+        std::array<uint32_t, SystemPins::OutputCount> sliceMasks {};
+        SystemPins::forEachOutput([&sliceMasks]<typename PinGroupT>(uint8_t const index) {
+            sliceMasks[index] = PinGroupT::PWMSliceMask;
+        });
+
+        for (uint8_t first = 0; first < SystemPins::OutputCount; ++first) {
+            for (uint8_t second = 0; second < SystemPins::OutputCount; ++second) {
+                EXPECT_EQ(SystemPins::sharePWMSlices(first, second), (sliceMasks[first] & sliceMasks[second]) != 0)
+                    << "outputs " << static_cast<int>(first) << " and " << static_cast<int>(second);
+            }
+        }
+    }
+
+    TEST_F(SystemPinsTest, EnablingOneOutputSetsThePhaseModeOfItsWholeGroup) {
+        // Output A aligned, then Output B staggered, on boards that have it
+        uint8_t const other = SystemPins::OutputCount > 1 ? 1 : 0;
+        for (uint8_t index = 0; index < SystemPins::OutputCount; ++index) {
+            SystemPins::enablePWM(index, PWMPhaseMode::Aligned);
+        }
+        SystemPins::enablePWM(other, PWMPhaseMode::Staggered);
+
+        uint16_t const phaseStep = SystemPins::Output<0>::Red::PWMCount / 5;
+        std::vector<output_pins_t> const pins = outputPins();
+        for (uint8_t index = 0; index < SystemPins::OutputCount; ++index) {
+            bool const staggered = SystemPins::sharePWMSlices(index, other);
+            EXPECT_EQ(SystemPins::pwmPhaseMode(index), staggered ? PWMPhaseMode::Staggered : PWMPhaseMode::Aligned)
+                << "output " << static_cast<int>(index);
+            for (uint8_t channel = 0; channel < 5; ++channel) {
+                EXPECT_EQ(FakeGPIO::pwmSliceFor(pins[index].pwm[channel]).counter, staggered ? channel * phaseStep : 0)
+                    << "output " << static_cast<int>(index) << " channel " << static_cast<int>(channel);
+            }
+        }
+        if (SystemPins::OutputCount >= 2) {
+            EXPECT_EQ(SystemPins::pwmPhaseMode(0), PWMPhaseMode::Staggered);
+        }
+    }
+}
@@ -0,0 +1,137 @@
+/**
+ * ColorConverterTest.cpp
+ *
+ * @author Patrick Lavigne
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#include <gtest/gtest.h>
+
+#include "kilight/output/ColorConverter.h"
+
+namespace kilight::output {
+
+    namespace {
+        // Kim et al. Planckian locus at 6500K and 2700K, the default calibration's white points
+        constexpr float ColdWhiteX = 0.31350f;
+        constexpr float ColdWhiteY = 0.32365f;
+
+        constexpr float WarmWhiteX = 0.45980f;
+        constexpr float WarmWhiteY = 0.41049f;
+
+        int channelDifference(uint8_t const first, uint8_t const second) {
+            return std::abs(static_cast<int>(first) - static_cast<int>(second));
+        }
+    }
+
+    TEST(ColorConverterTest, HSVSectorEdgesAreContinuous) {
+        for (uint32_t sector = 1; sector <= 6; ++sector) {
+            uint32_t const edge = sector * 60;
+            EXPECT_EQ(ColorConverter::fromHSV(edge - 1, 255, 255), ColorConverter::fromHSV(edge, 255, 255))
+                << "edge " << edge;
+        }
+    }
+
+    TEST(ColorConverterTest, HSVSectorEdgesArePrimariesAndSecondaries) {
+        EXPECT_EQ(ColorConverter::fromHSV(0, 255, 255), (rgbcw_color_t {255, 0, 0, 0, 0}));
+        EXPECT_EQ(ColorConverter::fromHSV(60, 255, 255), (rgbcw_color_t {255, 255, 0, 0, 0}));
+        EXPECT_EQ(ColorConverter::fromHSV(120, 255, 255), (rgbcw_color_t {0, 255, 0, 0, 0}));
+        EXPECT_EQ(ColorConverter::fromHSV(180, 255, 255), (rgbcw_color_t {0, 255, 255, 0, 0}));
+        EXPECT_EQ(ColorConverter::fromHSV(240, 255, 255), (rgbcw_color_t {0, 0, 255, 0, 0}));
+        EXPECT_EQ(ColorConverter::fromHSV(300, 255, 255), (rgbcw_color_t {255, 0, 255, 0, 0}));
+        EXPECT_EQ(ColorConverter::fromHSV(360, 255, 255), ColorConverter::fromHSV(0, 255, 255));
+        EXPECT_EQ(ColorConverter::fromHSV(30, 255, 255), (rgbcw_color_t {255, 129, 0, 0, 0}));
+    }
+
+    TEST(ColorConverterTest, ColorTemperatureMixesBetweenTheWhites) {
+        ColorConverter const converter;
+
+        EXPECT_EQ(converter.fromColorTemperature(6500), (rgbcw_color_t {0, 0, 0, 255, 0}));
+        EXPECT_EQ(converter.fromColorTemperature(2700), (rgbcw_color_t {0, 0, 0, 0, 255}));
+
+        rgbcw_color_t const middle = converter.fromColorTemperature(4000);
+        EXPECT_EQ(middle.red, 0);
+        EXPECT_EQ(middle.green, 0);
+        EXPECT_EQ(middle.blue, 0);
+        EXPECT_GT(middle.coldWhite, 0);
+        EXPECT_GT(middle.warmWhite, 0);
+        EXPECT_EQ(std::max(middle.coldWhite, middle.warmWhite), 255);
+
+        // Warmer temperatures only ever take more of the warm white
+        rgbcw_color_t previous = converter.fromColorTemperature(6500);
+        for (uint32_t kelvin = 6400; kelvin >= 2700; kelvin -= 100) {
+            rgbcw_color_t const mix = converter.fromColorTemperature(kelvin);
+            EXPECT_TRUE(mix.warmWhite >= previous.warmWhite && mix.coldWhite <= previous.coldWhite)
+                << kelvin << "K";
+            previous = mix;
+        }
+    }
+
+    TEST(ColorConverterTest, ColorTemperatureClampsToTheWhites) {
+        ColorConverter const converter;
+
+        EXPECT_EQ(converter.fromColorTemperature(10000), converter.fromColorTemperature(6500));
+        EXPECT_EQ(converter.fromColorTemperature(1000), converter.fromColorTemperature(2700));
+    }
+
+    TEST(ColorConverterTest, XYOnAWhitePointOnlyUsesThatWhite) {
+        ColorConverter const converter;
+
+        rgbcw_color_t const cold = converter.fromXY(ColdWhiteX, ColdWhiteY);
+        EXPECT_EQ(cold.coldWhite, 255);
+        EXPECT_LE(cold.warmWhite, 1);
+        EXPECT_LE(std::max({cold.red, cold.green, cold.blue}), 1);
+
+        rgbcw_color_t const warm = converter.fromXY(WarmWhiteX, WarmWhiteY);
+        EXPECT_EQ(warm.warmWhite, 255);
+        EXPECT_LE(warm.coldWhite, 1);
+        EXPECT_LE(std::max({warm.red, warm.green, warm.blue}), 1);
+    }
+
+    TEST(ColorConverterTest, XYAtAColorTemperatureMatchesIt) {
+        ColorConverter const converter;
+
+        rgbcw_color_t const fromXY = converter.fromXY(ColdWhiteX, ColdWhiteY);
+        rgbcw_color_t const fromKelvin = converter.fromColorTemperature(6500);
+        EXPECT_LE(channelDifference(fromXY.red, fromKelvin.red), 1);
+        EXPECT_LE(channelDifference(fromXY.green, fromKelvin.green), 1);
+        EXPECT_LE(channelDifference(fromXY.blue, fromKelvin.blue), 1);
+        EXPECT_LE(channelDifference(fromXY.coldWhite, fromKelvin.coldWhite), 1);
+        EXPECT_LE(channelDifference(fromXY.warmWhite, fromKelvin.warmWhite), 1);
+    }
+
+    TEST(ColorConverterTest, XYOffTheWhitesUsesTheColorChannels) {
+        ColorConverter const converter;
+
+        // The default calibration's red primary
+        rgbcw_color_t const red = converter.fromXY(0.69f, 0.30f);
+        EXPECT_EQ(red, (rgbcw_color_t {255, 0, 0, 0, 0}));
+    }
+
+    TEST(ColorConverterTest, InvalidXYIsRejected) {
+        float const nan = std::numeric_limits<float>::quiet_NaN();
+
+        EXPECT_TRUE(ColorConverter::validXY(ColdWhiteX, ColdWhiteY));
+        EXPECT_TRUE(ColorConverter::validXY(0.0f, 1.0f));
+        EXPECT_FALSE(ColorConverter::validXY(0.3f, 0.0f));
+        EXPECT_FALSE(ColorConverter::validXY(-0.1f, 0.3f));
+        EXPECT_FALSE(ColorConverter::validXY(0.7f, 0.4f));
+        EXPECT_FALSE(ColorConverter::validXY(nan, 0.3f));
+        EXPECT_FALSE(ColorConverter::validXY(0.3f, nan));
+    }
+
+    TEST(ColorConverterTest, WhitePointsBelowThePlanckianFitAreInvalid) {
+        fixture_calibration_t calibration;
+        calibration.warmWhiteKelvin = MinWhiteKelvin;
+        EXPECT_TRUE(calibration.valid());
+
+        calibration.warmWhiteKelvin = MinWhiteKelvin - 1;
+        EXPECT_FALSE(calibration.valid());
+
+        calibration.warmWhiteKelvin = 1000;
+        EXPECT_FALSE(calibration.valid());
+    }
+}
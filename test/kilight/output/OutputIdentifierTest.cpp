@@ -0,0 +1,30 @@
+/**
+ * OutputIdentifierTest.cpp
+ *
+ * @author Patrick Lavigne
+ */
+
+#include <gtest/gtest.h>
+
+#include "kilight/output/output_identifier.h"
+
+namespace kilight::output {
+
+    TEST(OutputIdentifierTest, OnlyFittedOutputsHaveAnIndex) {
+        for (uint8_t index = 0; index < conf::HardwareConfig::MaxOutputCount; ++index) {
+            std::optional<uint8_t> const found = outputIndexFor(OutputIdentifiers[index]);
+            if (index < OutputCount) {
+                ASSERT_TRUE(found.has_value());
+                EXPECT_EQ(*found, index);
+                EXPECT_EQ(outputIdentifierFor(index), OutputIdentifiers[index]);
+            } else {
+                EXPECT_FALSE(found.has_value());
+            }
+        }
+    }
+
+    TEST(OutputIdentifierTest, NamesFollowTheBoardLabels) {
+        EXPECT_EQ(outputName(0), 'A');
+        EXPECT_EQ(outputName(OutputCount - 1), 'A' + OutputCount - 1);
+    }
+}
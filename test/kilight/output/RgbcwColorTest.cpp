@@ -0,0 +1,92 @@
+/**
+ * RgbcwColorTest.cpp
+ *
+ * @author Patrick Lavigne
+ */
+
+#include <gtest/gtest.h>
+
+#include "kilight/output/rgbcw_color.h"
+
+namespace kilight::output {
+
+    TEST(RgbcwColorTest, ScaledByRoundsEveryChannelToNearest) {
+        for (uint32_t value = 0; value <= UINT8_MAX; ++value) {
+            // Every channel different, so one bleeding into the next would show up
+            rgbcw_color_t const color {
+                static_cast<uint8_t>(value),
+                static_cast<uint8_t>(UINT8_MAX - value),
+                static_cast<uint8_t>(value ^ 0x55U),
+                static_cast<uint8_t>(value ^ 0xAAU),
+                static_cast<uint8_t>(value * 7U)
+            };
+            for (uint32_t scale = 0; scale <= UINT8_MAX; ++scale) {
+                auto const expected = [scale](uint8_t const channel) {
+                    return static_cast<uint8_t>((channel * scale + 127) / 255);
+                };
+                rgbcw_color_t const scaled = color.scaledBy(static_cast<uint8_t>(scale));
+                ASSERT_EQ(scaled, (rgbcw_color_t {
+                              expected(color.red),
+                              expected(color.green),
+                              expected(color.blue),
+                              expected(color.coldWhite),
+                              expected(color.warmWhite)
+                          }))
+                    << "value " << value << " scale " << scale;
+            }
+        }
+    }
+
+    TEST(RgbcwColorTest, VolatileColorScalesTheSame) {
+        rgbcw_color_volatile_t color {};
+        color.red = 200;
+        color.green = 100;
+        color.blue = 50;
+        color.coldWhite = 25;
+        color.warmWhite = 255;
+
+        EXPECT_EQ(color.scaledBy<rgbcw_color_t>(128), (rgbcw_color_t {100, 50, 25, 13, 128}));
+    }
+
+    TEST(RgbcwColorTest, IncrementTowardsMovesEveryChannelOneStep) {
+        rgbcw_color_volatile_t color {};
+        color.red = 10;
+        color.green = 10;
+        color.blue = 10;
+        color.coldWhite = 0;
+        color.warmWhite = 255;
+        rgbcw_color_t const target {20, 0, 10, 255, 0};
+
+        color.incrementTowards(target);
+
+        EXPECT_EQ(rgbcw_color_t {color}, (rgbcw_color_t {11, 9, 10, 1, 254}));
+    }
+
+    TEST(RgbcwColorTest, IncrementTowardsSettlesOnTheTarget) {
+        rgbcw_color_t color {0, 255, 128, 3, 77};
+        rgbcw_color_t const target {255, 0, 128, 200, 76};
+
+        for (int step = 0; step < UINT8_MAX; ++step) {
+            color.incrementTowards(target);
+        }
+
+        EXPECT_EQ(color, target);
+    }
+
+    TEST(RgbcwColorTest, UnscaledByUndoesScaledBy) {
+        for (uint32_t scale = 0; scale <= UINT8_MAX; ++scale) {
+            for (uint32_t value = 0; value <= UINT8_MAX; ++value) {
+                rgbcw_color_t const scaled = rgbcw_color_t::singleChannel(static_cast<uint8_t>(value % 5),
+                                                                          static_cast<uint8_t>(value))
+                    .scaledBy(static_cast<uint8_t>(scale));
+                ASSERT_EQ(scaled.unscaledBy(static_cast<uint8_t>(scale)).scaledBy(static_cast<uint8_t>(scale)), scaled)
+                    << "value " << value << " scale " << scale;
+            }
+        }
+    }
+
+    TEST(RgbcwColorTest, UnscaledByClampsChannelsAboveTheFactor) {
+        EXPECT_EQ((rgbcw_color_t {200, 50, 0, 100, 255}.unscaledBy(100)), (rgbcw_color_t {255, 128, 0, 255, 255}));
+        EXPECT_EQ((rgbcw_color_t {200, 50, 0, 100, 255}.unscaledBy(0)), rgbcw_color_t {});
+    }
+}
@@ -0,0 +1,103 @@
+/**
+ * ChannelCurrentModelTest.cpp
+ *
+ * @author Patrick Lavigne
+ */
+
+#include <cstdlib>
+
+#include <gtest/gtest.h>
+
+#include "kilight/status/ChannelCurrentModel.h"
+
+namespace kilight::status {
+
+    namespace {
+        using output::rgbcw_color_t;
+
+        // Readings taken at each step of the calibration sequence, about what a step's worth of monitor ticks gives
+        constexpr uint32_t SamplesPerStep = 20;
+
+        constexpr current_model_t Actual {120, {1500, 1800, 1200, 2500, 2300}};
+
+        // Same steps as LightSubsystem::playCalibrationSequence(): each channel alone at full duty, then all off
+        void addCalibrationSamples(ChannelCurrentModel& model, current_model_t const& actual) {
+            for (uint8_t step = 0; step <= rgbcw_color_t::ChannelCount; ++step) {
+                rgbcw_color_t const levels = step < rgbcw_color_t::ChannelCount
+                                                 ? rgbcw_color_t::singleChannel(step, UINT8_MAX)
+                                                 : rgbcw_color_t {};
+                for (uint32_t sample = 0; sample < SamplesPerStep; ++sample) {
+                    model.addSample(levels, actual.predict(levels));
+                }
+            }
+        }
+    }
+
+    TEST(ChannelCurrentModelTest, CalibrationSamplesFitTheModelExactly) {
+        ChannelCurrentModel model;
+        addCalibrationSamples(model, Actual);
+
+        current_model_t const fitted = model.fit(ChannelCurrentModel::CalibrationPriorWeight);
+        EXPECT_EQ(fitted.offsetMilliAmps, Actual.offsetMilliAmps);
+        for (uint8_t channel = 0; channel < ModelChannelCount; ++channel) {
+            EXPECT_EQ(fitted.channelMilliAmps[channel], Actual.channelMilliAmps[channel])
+                << "channel " << static_cast<int>(channel);
+        }
+        EXPECT_EQ(model.sampleCount(), (rgbcw_color_t::ChannelCount + 1) * SamplesPerStep);
+    }
+
+    TEST(ChannelCurrentModelTest, SceneThatNeverChangesKeepsThePrior) {
+        ChannelCurrentModel model;
+        model.setPrior(Actual);
+
+        // Only red and cold white are lit, and the output draws more than the prior says it should
+        rgbcw_color_t const scene {128, 0, 0, 64, 0};
+        uint32_t const measured = Actual.predict(scene) + 300;
+        for (uint32_t sample = 0; sample < 500; ++sample) {
+            model.addSample(scene, measured);
+        }
+
+        current_model_t const fitted = model.fit();
+        // Nothing was learned about the channels that were off
+        EXPECT_EQ(fitted.channelMilliAmps[1], Actual.channelMilliAmps[1]);
+        EXPECT_EQ(fitted.channelMilliAmps[2], Actual.channelMilliAmps[2]);
+        EXPECT_EQ(fitted.channelMilliAmps[4], Actual.channelMilliAmps[4]);
+        // What was measured is spread over the lit terms, which now predict the scene closely
+        EXPECT_LT(std::abs(static_cast<int32_t>(fitted.predict(scene)) - static_cast<int32_t>(measured)), 15);
+        EXPECT_GT(fitted.channelMilliAmps[0], Actual.channelMilliAmps[0]);
+        EXPECT_GT(fitted.channelMilliAmps[3], Actual.channelMilliAmps[3]);
+    }
+
+    TEST(ChannelCurrentModelTest, ResetForgetsSamplesButNotThePrior) {
+        ChannelCurrentModel model;
+        model.setPrior(Actual);
+        addCalibrationSamples(model, current_model_t {0, {100, 100, 100, 100, 100}});
+
+        model.reset();
+
+        EXPECT_EQ(model.sampleCount(), 0U);
+        current_model_t const fitted = model.fit();
+        EXPECT_EQ(fitted.offsetMilliAmps, Actual.offsetMilliAmps);
+        EXPECT_EQ(fitted.channelMilliAmps, Actual.channelMilliAmps);
+    }
+
+    TEST(ChannelCurrentModelTest, NegativeChannelCurrentIsClampedToZero) {
+        ChannelCurrentModel model;
+
+        // The output draws less with green on than with everything off, as if green gave current back
+        for (uint8_t step = 0; step <= rgbcw_color_t::ChannelCount; ++step) {
+            rgbcw_color_t const levels = step < rgbcw_color_t::ChannelCount
+                                             ? rgbcw_color_t::singleChannel(step, UINT8_MAX)
+                                             : rgbcw_color_t {};
+            uint32_t const milliAmps = step == 1 ? 200 : step == rgbcw_color_t::ChannelCount ? 500 : 1500;
+            for (uint32_t sample = 0; sample < SamplesPerStep; ++sample) {
+                model.addSample(levels, milliAmps);
+            }
+        }
+
+        current_model_t const fitted = model.fit(ChannelCurrentModel::CalibrationPriorWeight);
+        EXPECT_EQ(fitted.channelMilliAmps[1], 0);
+        EXPECT_EQ(fitted.offsetMilliAmps, 500);
+        EXPECT_EQ(fitted.channelMilliAmps[0], 1000);
+    }
+}
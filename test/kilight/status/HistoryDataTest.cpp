@@ -0,0 +1,62 @@
+/**
+ * HistoryDataTest.cpp
+ *
+ * @author Patrick Lavigne
+ */
+
+#include <bitset>
+
+#include <gtest/gtest.h>
+
+#include "kilight/status/history_data.h"
+
+namespace kilight::status {
+
+    TEST(HistoryDataTest, EverySeriesHasItsOwnSlot) {
+        std::bitset<HistorySlotCount> used;
+        auto const claim = [&used](uint8_t const slot) {
+            ASSERT_LT(slot, HistorySlotCount);
+            EXPECT_FALSE(used.test(slot)) << "slot " << static_cast<int>(slot);
+            used.set(slot);
+        };
+
+        claim(historySlot(HistorySeries::DriverTemperature, 0));
+        claim(historySlot(HistorySeries::PowerSupplyTemperature, 0));
+        claim(historySlot(HistorySeries::FanRPM, 0));
+        claim(historySlot(HistorySeries::FanOutput, 0));
+        for (uint8_t index = 0; index < output::OutputCount; ++index) {
+            claim(historySlot(HistorySeries::OutputTemperature, index));
+            claim(historySlot(HistorySeries::OutputCurrent, index));
+        }
+
+        EXPECT_TRUE(used.all());
+    }
+
+    TEST(HistoryDataTest, AccumulatorAveragesFinerBucketsAndSkipsEmptyOnes) {
+        history_accumulator_t accumulator;
+        accumulator.add(history_bucket_t{10, 30, 20});
+        accumulator.add(history_bucket_t{});
+        accumulator.add(history_bucket_t{-5, 50, 40});
+
+        history_bucket_t const bucket = accumulator.take();
+        EXPECT_EQ(bucket.minimum, -5);
+        EXPECT_EQ(bucket.maximum, 50);
+        EXPECT_EQ(bucket.average, 30);
+
+        EXPECT_TRUE(accumulator.take().empty());
+    }
+
+    TEST(HistoryDataTest, RingKeepsTheNewestRows) {
+        HistoryRing<3> ring;
+        for (int16_t value = 1; value <= 5; ++value) {
+            history_row_t row;
+            row[0].average = value;
+            ring.push(row);
+        }
+
+        ASSERT_EQ(ring.size(), 3U);
+        EXPECT_EQ(ring.at(0)[0].average, 5);
+        EXPECT_EQ(ring.at(1)[0].average, 4);
+        EXPECT_EQ(ring.at(2)[0].average, 3);
+    }
+}
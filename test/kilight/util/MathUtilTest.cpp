@@ -0,0 +1,84 @@
+/**
+ * MathUtilTest.cpp
+ *
+ * @author Patrick Lavigne
+ */
+
+#include <gtest/gtest.h>
+
+#include "kilight/util/MathUtil.h"
+
+namespace kilight::util {
+
+    namespace {
+        // The fixed point colour math has to match real division for every possible input, and checking all of them
+        // is cheap enough to do at compile time
+
+        constexpr bool divideBy255RoundedIsExact() {
+            for (uint32_t first = 0; first <= UINT8_MAX; ++first) {
+                for (uint32_t second = 0; second <= UINT8_MAX; ++second) {
+                    uint32_t const product = first * second;
+                    if (MathUtil::divideBy255Rounded(product) != (product + 127) / 255) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        constexpr bool scaleLanesBy255IsExact() {
+            for (uint32_t value = 0; value <= UINT8_MAX; ++value) {
+                // Different values in every lane, so a carry between lanes would show up
+                uint64_t const lanes = static_cast<uint64_t>(value)
+                                       | static_cast<uint64_t>(UINT8_MAX - value) << 16U
+                                       | static_cast<uint64_t>(value ^ 0x55U) << 32U
+                                       | static_cast<uint64_t>(value ^ 0xAAU) << 48U;
+                for (uint32_t scale = 0; scale <= UINT8_MAX; ++scale) {
+                    uint64_t const scaled = MathUtil::scaleLanesBy255(lanes, static_cast<uint8_t>(scale));
+                    for (uint32_t lane = 0; lane < 4; ++lane) {
+                        uint32_t const input = (lanes >> (lane * 16U)) & 0xFFU;
+                        if (((scaled >> (lane * 16U)) & 0xFFFFU) != (input * scale + 127) / 255) {
+                            return false;
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+    }
+
+    static_assert(divideBy255RoundedIsExact(), "divideBy255Rounded doesn't match rounded division");
+
+    static_assert(scaleLanesBy255IsExact(), "scaleLanesBy255 doesn't match rounded division");
+
+    static_assert(MathUtil::incrementBetween<uint8_t>(0, 255) == 1);
+    static_assert(MathUtil::incrementBetween<uint8_t>(255, 0) == 254);
+    static_assert(MathUtil::incrementBetween<uint8_t>(7, 7) == 7);
+
+    TEST(MathUtilTest, DeltaDirectionMatchesComparison) {
+        for (int first = 0; first <= UINT8_MAX; ++first) {
+            for (int second = 0; second <= UINT8_MAX; ++second) {
+                int8_t const expected = first == second ? 0 : first > second ? 1 : -1;
+                ASSERT_EQ(MathUtil::deltaDirection<uint8_t>(static_cast<uint8_t>(first),
+                                                            static_cast<uint8_t>(second)),
+                          expected)
+                    << first << " vs " << second;
+            }
+        }
+    }
+
+    TEST(MathUtilTest, DeltaDirectionHandlesSignedAndWideTypes) {
+        EXPECT_EQ(MathUtil::deltaDirection<int32_t>(-5, 3), -1);
+        EXPECT_EQ(MathUtil::deltaDirection<int32_t>(3, -5), 1);
+        EXPECT_EQ(MathUtil::deltaDirection<uint32_t>(UINT32_MAX, 0), 1);
+        EXPECT_EQ(MathUtil::deltaDirection<uint16_t>(0, UINT16_MAX), -1);
+    }
+
+    TEST(MathUtilTest, IncrementBetweenStopsAtTheTarget) {
+        uint8_t value = 250;
+        for (int step = 0; step < 10; ++step) {
+            value = MathUtil::incrementBetween<uint8_t>(value, 255);
+        }
+        EXPECT_EQ(value, 255);
+    }
+}
@@ -0,0 +1,21 @@
+/**
+ * platform_defs.h
+ *
+ * Host stand-in for the RP2350's platform definitions, for whichever package the board header picks.
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include "pico/config.h"
+
+#if PICO_RP2350A
+#define NUM_BANK0_GPIOS 30
+#define ADC_BASE_PIN 26
+#else
+#define NUM_BANK0_GPIOS 48
+#define ADC_BASE_PIN 40
+#endif
+
+#define NUM_PWM_SLICES 12
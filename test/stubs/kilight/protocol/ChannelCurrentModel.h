@@ -0,0 +1,59 @@
+/**
+ * ChannelCurrentModel.h
+ *
+ * Host stand-in for the generated protocol message.
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace kilight::protocol {
+    class ChannelCurrentModel {
+    public:
+        [[nodiscard]] int32_t offsetMilliAmps() const { return m_offsetMilliAmps; }
+
+        [[nodiscard]] uint32_t redMilliAmps() const { return m_redMilliAmps; }
+
+        [[nodiscard]] uint32_t greenMilliAmps() const { return m_greenMilliAmps; }
+
+        [[nodiscard]] uint32_t blueMilliAmps() const { return m_blueMilliAmps; }
+
+        [[nodiscard]] uint32_t coldWhiteMilliAmps() const { return m_coldWhiteMilliAmps; }
+
+        [[nodiscard]] uint32_t warmWhiteMilliAmps() const { return m_warmWhiteMilliAmps; }
+
+        [[nodiscard]] bool calibrated() const { return m_calibrated; }
+
+        void set_offsetMilliAmps(int32_t const value) { m_offsetMilliAmps = value; }
+
+        void set_redMilliAmps(uint32_t const value) { m_redMilliAmps = value; }
+
+        void set_greenMilliAmps(uint32_t const value) { m_greenMilliAmps = value; }
+
+        void set_blueMilliAmps(uint32_t const value) { m_blueMilliAmps = value; }
+
+        void set_coldWhiteMilliAmps(uint32_t const value) { m_coldWhiteMilliAmps = value; }
+
+        void set_warmWhiteMilliAmps(uint32_t const value) { m_warmWhiteMilliAmps = value; }
+
+        void set_calibrated(bool const value) { m_calibrated = value; }
+
+    private:
+        int32_t m_offsetMilliAmps = 0;
+
+        uint32_t m_redMilliAmps = 0;
+
+        uint32_t m_greenMilliAmps = 0;
+
+        uint32_t m_blueMilliAmps = 0;
+
+        uint32_t m_coldWhiteMilliAmps = 0;
+
+        uint32_t m_warmWhiteMilliAmps = 0;
+
+        bool m_calibrated = false;
+    };
+}
@@ -0,0 +1,47 @@
+/**
+ * Color.h
+ *
+ * Host stand-in for the generated protocol message.
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace kilight::protocol {
+    class Color {
+    public:
+        [[nodiscard]] uint32_t red() const { return m_red; }
+
+        [[nodiscard]] uint32_t green() const { return m_green; }
+
+        [[nodiscard]] uint32_t blue() const { return m_blue; }
+
+        [[nodiscard]] uint32_t coldWhite() const { return m_coldWhite; }
+
+        [[nodiscard]] uint32_t warmWhite() const { return m_warmWhite; }
+
+        void set_red(uint32_t const value) { m_red = value; }
+
+        void set_green(uint32_t const value) { m_green = value; }
+
+        void set_blue(uint32_t const value) { m_blue = value; }
+
+        void set_coldWhite(uint32_t const value) { m_coldWhite = value; }
+
+        void set_warmWhite(uint32_t const value) { m_warmWhite = value; }
+
+    private:
+        uint32_t m_red = 0;
+
+        uint32_t m_green = 0;
+
+        uint32_t m_blue = 0;
+
+        uint32_t m_coldWhite = 0;
+
+        uint32_t m_warmWhite = 0;
+    };
+}
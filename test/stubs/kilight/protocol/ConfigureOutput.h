@@ -0,0 +1,49 @@
+/**
+ * ConfigureOutput.h
+ *
+ * Host stand-in for the generated protocol message.
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "kilight/protocol/FixtureCalibration.h"
+#include "kilight/protocol/OutputIdentifier.h"
+
+namespace kilight::protocol {
+    enum class PWMPhaseMode : uint32_t {
+        Aligned = 0,
+        Staggered = 1
+    };
+
+    class ConfigureOutput {
+    public:
+        [[nodiscard]] OutputIdentifier outputId() const { return m_outputId; }
+
+        [[nodiscard]] FixtureCalibration const& calibration() const { return m_calibration; }
+
+        [[nodiscard]] PWMPhaseMode pwmPhaseMode() const { return m_pwmPhaseMode; }
+
+        [[nodiscard]] uint32_t currentLimitMilliAmps() const { return m_currentLimitMilliAmps; }
+
+        void set_outputId(OutputIdentifier const value) { m_outputId = value; }
+
+        FixtureCalibration& mutable_calibration() { return m_calibration; }
+
+        void set_pwmPhaseMode(PWMPhaseMode const value) { m_pwmPhaseMode = value; }
+
+        void set_currentLimitMilliAmps(uint32_t const value) { m_currentLimitMilliAmps = value; }
+
+    private:
+        OutputIdentifier m_outputId = OutputIdentifier::OutputA;
+
+        FixtureCalibration m_calibration {};
+
+        PWMPhaseMode m_pwmPhaseMode = PWMPhaseMode::Aligned;
+
+        uint32_t m_currentLimitMilliAmps = 0;
+    };
+}
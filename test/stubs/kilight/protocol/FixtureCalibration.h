@@ -0,0 +1,95 @@
+/**
+ * FixtureCalibration.h
+ *
+ * Host stand-in for the generated protocol message.
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace kilight::protocol {
+    class FixtureCalibration {
+    public:
+        [[nodiscard]] uint32_t coldWhiteKelvin() const { return m_coldWhiteKelvin; }
+
+        [[nodiscard]] uint32_t warmWhiteKelvin() const { return m_warmWhiteKelvin; }
+
+        [[nodiscard]] uint32_t redLumens() const { return m_redLumens; }
+
+        [[nodiscard]] uint32_t greenLumens() const { return m_greenLumens; }
+
+        [[nodiscard]] uint32_t blueLumens() const { return m_blueLumens; }
+
+        [[nodiscard]] uint32_t coldWhiteLumens() const { return m_coldWhiteLumens; }
+
+        [[nodiscard]] uint32_t warmWhiteLumens() const { return m_warmWhiteLumens; }
+
+        [[nodiscard]] uint32_t redX() const { return m_redX; }
+
+        [[nodiscard]] uint32_t redY() const { return m_redY; }
+
+        [[nodiscard]] uint32_t greenX() const { return m_greenX; }
+
+        [[nodiscard]] uint32_t greenY() const { return m_greenY; }
+
+        [[nodiscard]] uint32_t blueX() const { return m_blueX; }
+
+        [[nodiscard]] uint32_t blueY() const { return m_blueY; }
+
+        void set_coldWhiteKelvin(uint32_t const value) { m_coldWhiteKelvin = value; }
+
+        void set_warmWhiteKelvin(uint32_t const value) { m_warmWhiteKelvin = value; }
+
+        void set_redLumens(uint32_t const value) { m_redLumens = value; }
+
+        void set_greenLumens(uint32_t const value) { m_greenLumens = value; }
+
+        void set_blueLumens(uint32_t const value) { m_blueLumens = value; }
+
+        void set_coldWhiteLumens(uint32_t const value) { m_coldWhiteLumens = value; }
+
+        void set_warmWhiteLumens(uint32_t const value) { m_warmWhiteLumens = value; }
+
+        void set_redX(uint32_t const value) { m_redX = value; }
+
+        void set_redY(uint32_t const value) { m_redY = value; }
+
+        void set_greenX(uint32_t const value) { m_greenX = value; }
+
+        void set_greenY(uint32_t const value) { m_greenY = value; }
+
+        void set_blueX(uint32_t const value) { m_blueX = value; }
+
+        void set_blueY(uint32_t const value) { m_blueY = value; }
+
+    private:
+        uint32_t m_coldWhiteKelvin = 0;
+
+        uint32_t m_warmWhiteKelvin = 0;
+
+        uint32_t m_redLumens = 0;
+
+        uint32_t m_greenLumens = 0;
+
+        uint32_t m_blueLumens = 0;
+
+        uint32_t m_coldWhiteLumens = 0;
+
+        uint32_t m_warmWhiteLumens = 0;
+
+        uint32_t m_redX = 0;
+
+        uint32_t m_redY = 0;
+
+        uint32_t m_greenX = 0;
+
+        uint32_t m_greenY = 0;
+
+        uint32_t m_blueX = 0;
+
+        uint32_t m_blueY = 0;
+    };
+}
@@ -0,0 +1,20 @@
+/**
+ * OutputIdentifier.h
+ *
+ * Host stand-in for the generated protocol enum.
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace kilight::protocol {
+    enum class OutputIdentifier : uint32_t {
+        OutputA = 0,
+        OutputB = 1,
+        OutputC = 2,
+        OutputD = 3
+    };
+}
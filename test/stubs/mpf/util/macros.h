@@ -0,0 +1,11 @@
+/**
+ * macros.h
+ *
+ * Host stand-in for the micro-program-framework macros the firmware headers use.
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#define PACKED __attribute__((packed))
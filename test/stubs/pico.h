@@ -0,0 +1,12 @@
+/**
+ * pico.h
+ *
+ * Host stand-in for the Pico SDK's top level header.
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include "pico/config.h"
+#include "pico/platform.h"
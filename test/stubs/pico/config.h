@@ -0,0 +1,11 @@
+/**
+ * config.h
+ *
+ * Host stand-in for the Pico SDK's generated config header, which pulls in the board header being built for.
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include KILIGHT_TEST_BOARD_HEADER
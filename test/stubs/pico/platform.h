@@ -0,0 +1,20 @@
+/**
+ * platform.h
+ *
+ * Host stand-in for the Pico SDK's platform macros. Nothing is placed in RAM on the host, so the placement macros
+ * only pass the name through.
+ *
+ * @author Patrick Lavigne
+ */
+
+#pragma once
+
+#include "hardware/platform_defs.h"
+
+#ifndef __force_inline
+#define __force_inline inline __attribute__((always_inline))
+#endif
+
+#define __not_in_flash_func(func_name) func_name
+
+#define tight_loop_contents() ((void) 0)